@@ -0,0 +1,50 @@
+#include "Fixtures.h"
+#include "core/DiagnosticRing.h"
+
+static DiagnosticRing ring( 1024 );
+
+// Record pushed by the hit path, thread 0 consumes like the main thread drain. Args: threads pushing at once
+static void BM_DiagnosticPush( benchmark::State& a_state )
+{
+	DiagnosticRecord record;
+	record.category = (uint16_t)a_state.thread_index();
+	record.SetText( "NPC Head [Head]" );
+
+	DiagnosticRecord popped;
+	uint64_t dropped = 0;
+	for( auto _ : a_state )
+	{
+		if( !ring.Push( record ) )
+			++dropped;
+
+		if( a_state.thread_index() == 0 )
+		{
+			while( ring.Pop( popped ) )
+				benchmark::DoNotOptimize( popped );
+		}
+	}
+
+	ring.TakeDropped( record.category );
+	a_state.counters[ "dropped" ] = benchmark::Counter( (double)dropped, benchmark::Counter::kAvgIterations );
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_DiagnosticPush )->ThreadRange( 1, 8 )->UseRealTime();
+
+// Consumer side of a flood, most records are over the rate limit
+static void BM_DiagnosticRateLimit( benchmark::State& a_state )
+{
+	DiagnosticRateLimit rateLimit;
+	rateLimit.SetLimit( 0, 20 );
+
+	double now = 0;
+	uint64_t shown = 0;
+	for( auto _ : a_state )
+	{
+		now += 1e-5;
+		shown += rateLimit.IsAllowed( 0, now );
+	}
+
+	benchmark::DoNotOptimize( shown + rateLimit.TakeSuppressed( 0, now ) );
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_DiagnosticRateLimit );
@@ -0,0 +1,591 @@
+#include "Fixtures.h"
+#include "core/SnapshotFilter.h"
+#include "core/FilterJIT.h"
+#include "core/HitEvaluator.h"
+#include "core/HitTrace.h"
+
+#include <cstdio>
+
+// Differential checks of the optimized hit paths against the reference semantic.
+//
+//   ArcheryLocationalDamageEquivalence [--iterations <n>] [--seed <s>] [--property <name>] [--max-failures <n>]
+//
+// Each property generates random rule sets, node names, actor facts and roll seeds from the iteration seed and asserts
+// that both sides decide the same:
+//   filter		FilterCode with SnapshotFacts against SnapshotFilter (std::regex and keyword string lookups),
+//   			and over a FilterSnapshot of the clauses of the filter as the batched hits capture it
+//   jit		FilterJIT against FilterCode::Interpret on every predicate entry, skipped in a build without ALD_FILTER_JIT
+//   location	HotRules against the LocationRule fields and its own std::regex
+//   decision	HitEvaluator on FilterCode against HitEvaluator on SnapshotFilter, same rolls
+//   batch		The frame batch, perk conditions applied after the scan, against the inline pipeline on the hits it accepts
+//   order		Decisions do not change once the adaptive predicate orders have moved
+//   node		NodeSearch over the flattened skeleton against the node tree
+//   trace		A record read back from a hit trace decides like the original
+// A failure prints the property and the seed, '--seed <seed> --iterations 1 --property <name>' runs that case alone.
+// A property that runs no case fails, as does '--property jit' in a build without the JIT.
+
+class Harness
+{
+public:
+	Harness( uint32_t a_maxFailures ) : maxFailures( a_maxFailures ) {}
+
+	bool Check( bool a_isEqual, const char* a_property, uint32_t a_seed, const std::string& a_detail )
+	{
+		++cases;
+		if( a_isEqual )
+			return true;
+
+		if( failures++ < maxFailures )
+			std::printf( "FAIL %s seed %u: %s\n", a_property, a_seed, a_detail.c_str() );
+
+		return false;
+	}
+
+	uint64_t	cases = 0;
+	uint64_t	failures = 0;
+
+private:
+	uint32_t	maxFailures;
+};
+
+// Facts the fixtures do not produce on their own: keywords in another case, bases without editor ID or without
+// base at all, unknown sex, projectiles without source.
+static void Mutate( ActorSnapshot& a_actor, std::mt19937& a_random )
+{
+	auto flipCase = []( std::string& a_keyword )
+	{
+		for( auto& c : a_keyword )
+			c = (char)( std::isupper( (unsigned char)c ) ? std::tolower( (unsigned char)c ) : std::toupper( (unsigned char)c ) );
+	};
+
+	if( a_random() % 4 == 0 && !a_actor.keywords.empty() )
+		flipCase( a_actor.keywords[ a_random() % a_actor.keywords.size() ] );
+
+	if( a_random() % 4 == 0 && !a_actor.wornArmors.empty() && !a_actor.wornArmors.front().empty() )
+		flipCase( a_actor.wornArmors.front().front() );
+
+	switch( a_random() % 12 )
+	{
+	case 0:
+		a_actor.baseID			= 0xFF000000 | ( a_random() & 0xFFFF );	// Not a loaded NPC with editor ID
+		a_actor.baseEditorID	= "";
+		break;
+
+	case 1:
+		a_actor.hasBase			= false;
+		break;
+
+	case 2:
+		a_actor.sex				= Sex::kNone;
+		break;
+	}
+}
+
+static void Mutate( ProjectileSnapshot& a_projectile, std::mt19937& a_random )
+{
+	if( a_random() % 10 == 0 )
+	{
+		a_projectile.hasSource = false;
+		a_projectile.weaponKeywords.clear();
+		a_projectile.ammoKeywords.clear();
+	}
+}
+
+struct RuleFixture
+{
+	RuleFixture( uint32_t a_seed ) :
+		random( a_seed ),
+		rules( Fixtures::MakeRules( 20 + a_seed % 150, a_seed ) )
+	{
+		code.Compile( rules->locations, Fixtures::GetWorld().GetForms() );
+	}
+
+	ActorSnapshot MakeActor()
+	{
+		auto actor = Fixtures::MakeActor( Fixtures::GetWorld(), 1 + random() % 40, random() % 8, random() % 16, random() );
+		Mutate( actor, random );
+		return actor;
+	}
+
+	ProjectileSnapshot MakeProjectile()
+	{
+		auto projectile = Fixtures::MakeProjectile( Fixtures::GetWorld(), random() );
+		projectile.shot = Fixtures::MakeShots( 1, random() )[ 0 ];
+		Mutate( projectile, random );
+		return projectile;
+	}
+
+	HitRecord MakeHit( const std::vector<SkeletonSnapshot>& a_skeletons )
+	{
+		HitRecord hit;
+		hit.skeleton	= a_skeletons[ random() % a_skeletons.size() ];
+		auto& node		= hit.skeleton.nodes[ random() % hit.skeleton.nodes.size() ];
+		hit.impact		= { node.position.x + (float)( random() % 9 ) - 4, node.position.y, node.position.z + (float)( random() % 9 ) - 4 };
+		hit.impactNode	= random() % 3 ? (int32_t)( &node - hit.skeleton.nodes.data() ) : -1;
+		hit.damage		= 1.0f + random() % 120;
+		hit.target		= MakeActor();
+		hit.hasShooter	= random() % 6 != 0;
+		hit.shooter		= MakeActor();
+		hit.projectile	= MakeProjectile();
+
+		hit.target.isPlayer		= random() % 8 == 0;
+		hit.shooter.isPlayer	= !hit.target.isPlayer && random() % 2;
+
+		for( uint32_t rule = 0; rule < rules->locations.size(); ++rule )
+		{
+			if( !rules->locations[ rule ].perkConditionCopy.empty() && random() % 2 )
+				hit.failedConditions.push_back( rule );
+		}
+
+		return hit;
+	}
+
+	std::mt19937				random;
+	std::unique_ptr<RuleData>	rules;
+	FilterCode					code;
+};
+
+static std::string FormatDecision( const HitDecision& a_decision )
+{
+	std::string text = "node " + std::to_string( a_decision.node ) + " rules";
+	for( auto rule : a_decision.rules )
+		text += " " + std::to_string( rule );
+
+	text += " effects";
+	for( auto [ rule, effect ] : a_decision.effects )
+		text += " " + std::to_string( rule ) + ":" + std::to_string( effect );
+
+	return text + " damage " + std::to_string( a_decision.damage ) + " exp " + std::to_string( a_decision.expMult );
+}
+
+static bool operator==( const HitDecision& a_left, const HitDecision& a_right )
+{
+	return a_left.node == a_right.node && a_left.rules == a_right.rules && a_left.effects == a_right.effects &&
+		a_left.damageMult == a_right.damageMult && a_left.damage == a_right.damage && a_left.expMult == a_right.expMult;
+}
+
+static const std::vector<SkeletonSnapshot>& GetSkeletons()
+{
+	static const auto skeletons = []()
+	{
+		std::vector<SkeletonSnapshot> result;
+		for( int type = 0; type < (int)Fixtures::SkeletonType::kTotal; ++type )
+			result.push_back( Fixtures::MakeSkeletonSnapshot( (Fixtures::SkeletonType)type ) );
+
+		return result;
+	}();
+
+	return skeletons;
+}
+
+static RuleCompiler::Options MakeOptions( std::mt19937& a_random )
+{
+	RuleCompiler::Options options;
+	options.ignoreHitboxCheck			= a_random() % 4 == 0;
+	options.enableDifficultyBonus		= a_random() % 2;
+	options.enableLocationMultiplier	= a_random() % 2;
+	options.effectChanceCap				= a_random() % 2;
+	options.hpFactor					= a_random() % 3 == 0 ? -0.25f : 0.25f;
+	return options;
+}
+
+static void CheckFilter( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	for( uint32_t i = 0; i < 16; ++i )
+	{
+		auto actor		= fixture.MakeActor();
+		auto projectile	= fixture.MakeProjectile();
+
+		// Shooters can be missing. Filters always run with the hit projectile, a projectile without source stands for a missing one.
+		const ActorSnapshot* actorPtr			= fixture.random() % 10 ? &actor : nullptr;
+		const ProjectileSnapshot* projectilePtr	= &projectile;
+
+		SnapshotFacts facts( fixture.code, actorPtr, projectilePtr );
+		for( uint32_t rule = 0; rule < fixture.rules->locations.size(); ++rule )
+		{
+			auto& location = fixture.rules->locations[ rule ];
+			for( auto filter : { &location.targetFilter, &location.shooterFilter } )
+			{
+				bool reference	= SnapshotFilter::IsVaild( *filter, actorPtr, projectilePtr );
+				bool compiled	= facts.Evaluate( *filter );
+
+				// Captured from facts that have not cached any clause yet, as the impact hook does
+				SnapshotFacts captureFacts( fixture.code, actorPtr, projectilePtr );
+				FilterSnapshot snapshot;
+				snapshot.Capture( captureFacts, fixture.code.GetClauses( rule, filter == &location.targetFilter ) );
+				bool captured = filter->predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+				{
+					return fixture.code.Interpret( filter->programEntries[ a_predicate ], snapshot );
+				});
+
+				a_harness.Check( captured == compiled, "filter", a_seed, "rule " + std::to_string( rule ) + " snapshot " + std::to_string( captured ) + ", compiled " + std::to_string( compiled ) );
+
+				if( reference == compiled )
+				{
+					a_harness.Check( true, "filter", a_seed, "" );
+					continue;
+				}
+
+				// Name the predicates that disagree
+				std::string detail = "rule " + std::to_string( rule );
+				detail += filter == &location.targetFilter ? " target, predicates" : " shooter, predicates";
+				for( uint32_t predicate = 0; predicate < ActorFilter::kPredicateCount; ++predicate )
+				{
+					bool referencePredicate	= SnapshotFilter::Test( *filter, (ActorFilter::Predicate)predicate, actorPtr, projectilePtr );
+					bool compiledPredicate	= fixture.code.Interpret( filter->programEntries[ predicate ], facts );
+					if( referencePredicate != compiledPredicate )
+						detail += ' ' + std::to_string( predicate );
+				}
+
+				a_harness.Check( false, "filter", a_seed, detail + ", reference " + std::to_string( reference ) + ", compiled " + std::to_string( compiled ) );
+			}
+		}
+	}
+}
+
+static void CheckJIT( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	auto jit = FilterJIT::Create<SnapshotFacts>( fixture.code );
+	for( uint32_t i = 0; i < 16; ++i )
+	{
+		auto actor		= fixture.MakeActor();
+		auto projectile	= fixture.MakeProjectile();
+
+		const ActorSnapshot* actorPtr = fixture.random() % 10 ? &actor : nullptr;
+
+		// Separate facts, a clause cached by one side must not hide a wrong call from the other
+		SnapshotFacts interpretedFacts( fixture.code, actorPtr, &projectile );
+		SnapshotFacts jitFacts( fixture.code, actorPtr, &projectile );
+		for( uint32_t rule = 0; rule < fixture.rules->locations.size(); ++rule )
+		{
+			auto& location = fixture.rules->locations[ rule ];
+			for( auto filter : { &location.targetFilter, &location.shooterFilter } )
+			{
+				for( uint32_t predicate = 0; predicate < ActorFilter::kPredicateCount; ++predicate )
+				{
+					auto entry			= filter->programEntries[ predicate ];
+					bool interpreted	= fixture.code.Interpret( entry, interpretedFacts );
+					bool compiled		= jit->Run( entry, jitFacts );
+					a_harness.Check( interpreted == compiled, "jit", a_seed,
+						"rule " + std::to_string( rule ) + " predicate " + std::to_string( predicate ) + " entry " + std::to_string( entry ) +
+						", interpreted " + std::to_string( interpreted ) + ", jit " + std::to_string( compiled ) );
+				}
+			}
+		}
+	}
+}
+
+static void CheckLocation( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	auto& rules		= *fixture.rules;
+	auto& hotRules	= rules.hotRules;
+
+	std::vector<std::string> names;
+	for( auto& skeleton : GetSkeletons() )
+	{
+		for( auto& node : skeleton.nodes )
+			names.push_back( node.name );
+	}
+
+	names.push_back( "" );
+	names.push_back( "SHIELD" );
+	names.push_back( "npc head [head]" );
+
+	if( !a_harness.Check( hotRules.size() == rules.locations.size(), "location", a_seed, "hot rule count" ) )
+		return;
+
+	for( auto& name : names )
+	{
+		auto& match = rules.MatchNode( name );
+		a_harness.Check( match.isExcluded == std::regex_match( name, rules.excludeRegexp.regex ) &&
+			match.isPlayerNode == std::regex_match( name, rules.playerNodes.regex ), "location", a_seed, "node patterns '" + name + "'" );
+	}
+
+	for( uint32_t rule = 0; rule < rules.locations.size(); ++rule )
+	{
+		auto& location = rules.locations[ rule ];
+		bool isFieldEqual =
+			hotRules.Has( rule, HotRules::kEnable ) == location.enable &&
+			hotRules.Has( rule, HotRules::kContinue ) == location.shouldContinue &&
+			hotRules.Has( rule, HotRules::kDeflect ) == location.deflectProjectile &&
+			hotRules.Has( rule, HotRules::kSuccessHPFactorCap ) == location.successHPFactorCap &&
+			hotRules.successChance[ rule ] == location.successChance &&
+			hotRules.successHPFactor[ rule ] == location.successHPFactor &&
+			hotRules.damageMult[ rule ] == location.damageMult &&
+			hotRules.difficulty[ rule ] == location.difficulty;
+
+		a_harness.Check( isFieldEqual, "location", a_seed, "rule " + std::to_string( rule ) + " hot fields" );
+
+		std::regex reference( location.regexp.pattern );
+		for( auto& name : names )
+		{
+			bool expected = location.enable && std::regex_match( name, reference );
+			a_harness.Check( hotRules.IsMatched( rule, name.c_str() ) == expected, "location", a_seed, "rule " + std::to_string( rule ) + " node '" + name + "'" );
+			a_harness.Check( rules.MatchNode( name ).IsRuleMatched( rule ) == expected, "location", a_seed, "rule " + std::to_string( rule ) + " cached node '" + name + "'" );
+		}
+	}
+}
+
+static void CheckDecision( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	auto options = MakeOptions( fixture.random );
+
+	HitEvaluator compiled( *fixture.rules, options, &fixture.code );
+	HitEvaluator reference( *fixture.rules, options );
+	for( uint32_t i = 0; i < 32; ++i )
+	{
+		auto hit = fixture.MakeHit( GetSkeletons() );
+		auto rollSeed = fixture.random();
+
+		std::minstd_rand compiledRandom( rollSeed ), referenceRandom( rollSeed );
+		auto compiledDecision	= compiled.Evaluate( hit, compiledRandom );
+		auto referenceDecision	= reference.Evaluate( hit, referenceRandom );
+		a_harness.Check( compiledDecision == referenceDecision, "decision", a_seed,
+			"hit " + std::to_string( i ) + ": compiled " + FormatDecision( compiledDecision ) + " / reference " + FormatDecision( referenceDecision ) );
+	}
+}
+
+static void CheckBatch( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	auto options = MakeOptions( fixture.random );
+
+	HitEvaluator evaluator( *fixture.rules, options, &fixture.code );
+	HitDecision inlineDecision, batchedDecision;
+	for( uint32_t i = 0; i < 32; ++i )
+	{
+		auto hit = fixture.MakeHit( GetSkeletons() );
+		auto scanSeed = fixture.random(), effectSeed = fixture.random();
+
+		// Hits the batch does not accept go inline, there is nothing to compare
+		std::minstd_rand batchedScanRandom( scanSeed ), batchedEffectRandom( effectSeed );
+		if( !evaluator.EvaluateBatched( hit, batchedScanRandom, batchedEffectRandom, batchedDecision ) )
+			continue;
+
+		std::minstd_rand inlineRandom( scanSeed ), inlineEffectRandom( effectSeed );
+		evaluator.Evaluate( hit, inlineRandom, inlineDecision, &inlineEffectRandom );
+		a_harness.Check( batchedDecision == inlineDecision, "batch", a_seed,
+			"hit " + std::to_string( i ) + ": batched " + FormatDecision( batchedDecision ) + " / inline " + FormatDecision( inlineDecision ) );
+	}
+
+	// A passed condition of a continuing rule triples the damage the HP factor of the next rule sees, the scan would roll
+	// that chance on the unscaled damage. The random rule sets rarely line it up, the batch must refuse such a hit.
+	RuleData conditionalDamage;
+	auto conditionalOptions = options;
+	RuleCompiler::Parse( "[Version]\nMajor = 2\n\n"
+		"[Location1]\nRegexp = .*\nMultiplier = 3\nContinue = true\nUsePerkCondition = BenchPerk0\n\n"
+		"[Location2]\nRegexp = .*\nSuccessHPFactor = " + std::to_string( 5 + a_seed % 60 ) + "\n", conditionalDamage, conditionalOptions );
+	conditionalDamage.CompilePatterns();
+
+	HitEvaluator conditionalEvaluator( conditionalDamage, conditionalOptions );
+	auto hit = fixture.MakeHit( GetSkeletons() );
+	hit.failedConditions.clear();
+
+	std::minstd_rand scanRandom( a_seed ), effectRandom( a_seed );
+	bool isAccepted = conditionalEvaluator.EvaluateBatched( hit, scanRandom, effectRandom, batchedDecision );
+	a_harness.Check( !isAccepted || batchedDecision.node < 0, "batch", a_seed, "hit with a continuing perk condition accepted: " + FormatDecision( batchedDecision ) );
+}
+
+static void CheckOrder( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	auto options = MakeOptions( fixture.random );
+
+	// A copy starts with the declared predicate order, the original is trained on many hits first
+	RuleData fresh = *fixture.rules;
+
+	std::vector<HitRecord> hits;
+	for( uint32_t i = 0; i < 16; ++i )
+		hits.push_back( fixture.MakeHit( GetSkeletons() ) );
+
+	HitEvaluator trained( *fixture.rules, options, &fixture.code );
+	HitEvaluator untrained( fresh, options, &fixture.code );
+	for( uint32_t pass = 0; pass < 64; ++pass )
+	{
+		for( auto& hit : hits )
+		{
+			std::minstd_rand random( pass + 1 );
+			trained.Evaluate( hit, random );
+		}
+	}
+
+	for( uint32_t i = 0; i < hits.size(); ++i )
+	{
+		std::minstd_rand trainedRandom( i + 1 ), untrainedRandom( i + 1 );
+		auto trainedDecision	= trained.Evaluate( hits[ i ], trainedRandom );
+		auto untrainedDecision	= untrained.Evaluate( hits[ i ], untrainedRandom );
+		a_harness.Check( trainedDecision == untrainedDecision, "order", a_seed,
+			"hit " + std::to_string( i ) + ": trained " + FormatDecision( trainedDecision ) + " / declared " + FormatDecision( untrainedDecision ) );
+	}
+}
+
+static void CheckNode( Harness& a_harness, uint32_t a_seed )
+{
+	std::mt19937 random( a_seed );
+	std::uniform_real_distribution<float> offset( -60, 60 );
+
+	auto type		= (Fixtures::SkeletonType)( random() % (uint32_t)Fixtures::SkeletonType::kTotal );
+	auto tree		= Fixtures::MakeSkeleton( type );
+	auto skeleton	= Fixtures::MakeSkeletonSnapshot( type );
+
+	auto rules		= Fixtures::MakeRules( 1, a_seed );
+
+	NodeSearch::PlayerNodes<Fixtures::Node> playerNodes;
+	NodeSearch::CollectPlayerNodes<Fixtures::NodeAdapter>( tree.get(), *rules, playerNodes );
+
+	for( uint32_t i = 0; i < 64; ++i )
+	{
+		auto& anchor		= skeleton.nodes[ random() % skeleton.nodes.size() ].position;
+		Point3 position		= { anchor.x + offset( random ), anchor.y + offset( random ), anchor.z + offset( random ) };
+		bool isPlayer		= random() % 4 == 0;
+		bool ignoreHitbox	= random() % 4 == 0;
+
+		float treeDistance, snapshotDistance;
+		auto treeNode		= NodeSearch::FindClosestHitNode<Fixtures::NodeAdapter>( tree.get(), position, treeDistance, isPlayer, *rules, ignoreHitbox );
+		auto snapshotNode	= NodeSearch::FindClosestHitNode<SkeletonAdapter>( skeleton.GetRoot(), position, snapshotDistance, isPlayer, *rules, ignoreHitbox );
+
+		std::string treeName		= treeNode ? treeNode->name : "<none>";
+		std::string snapshotName	= snapshotNode ? snapshotNode->name : "<none>";
+		a_harness.Check( treeName == snapshotName && treeDistance == snapshotDistance, "node", a_seed, "tree " + treeName + " / snapshot " + snapshotName );
+
+		// Player candidates gathered once, as the plugin keeps them per camera mode
+		if( isPlayer && !ignoreHitbox )
+		{
+			float cachedDistance;
+			auto cachedNode			= NodeSearch::FindClosestPlayerNode<Fixtures::NodeAdapter>( playerNodes, position, cachedDistance );
+			std::string cachedName	= cachedNode ? cachedNode->name : "<none>";
+			a_harness.Check( cachedNode == treeNode && cachedDistance == treeDistance, "node", a_seed, "tree " + treeName + " / player nodes " + cachedName );
+		}
+	}
+}
+
+static void CheckTrace( Harness& a_harness, uint32_t a_seed )
+{
+	RuleFixture fixture( a_seed );
+	auto options = MakeOptions( fixture.random );
+
+	std::vector<HitRecord> hits;
+	for( uint32_t i = 0; i < 8; ++i )
+		hits.push_back( fixture.MakeHit( GetSkeletons() ) );
+
+	auto path = std::filesystem::temp_directory_path() / ( "ald_equivalence_" + std::to_string( a_seed ) + ".aldtrace" );
+	HitTraceWriter writer;
+	if( !a_harness.Check( writer.Open( path, "ini" ), "trace", a_seed, "cannot write " + path.string() ) )
+		return;
+
+	for( auto& hit : hits )
+		writer.Write( hit );
+
+	writer.Close();
+
+	HitTraceReader reader;
+	bool isOpened = reader.Open( path );
+	a_harness.Check( isOpened && reader.GetIni() == "ini", "trace", a_seed, "header" );
+
+	HitEvaluator evaluator( *fixture.rules, options, &fixture.code );
+	for( uint32_t i = 0; i < hits.size(); ++i )
+	{
+		HitRecord read;
+		if( !a_harness.Check( isOpened && reader.Read( read ), "trace", a_seed, "record " + std::to_string( i ) + " missing" ) )
+			break;
+
+		// Same bytes through the plain archive, and the same decision
+		BinaryWriter original, roundTrip;
+		hits[ i ].Serialize( original );
+		read.Serialize( roundTrip );
+
+		std::minstd_rand originalRandom( i + 1 ), readRandom( i + 1 );
+		bool isEqual = original.GetBuffer() == roundTrip.GetBuffer() && evaluator.Evaluate( hits[ i ], originalRandom ) == evaluator.Evaluate( read, readRandom );
+		a_harness.Check( isEqual, "trace", a_seed, "record " + std::to_string( i ) + " differs" );
+	}
+
+	HitRecord extra;
+	a_harness.Check( !isOpened || !reader.Read( extra ), "trace", a_seed, "records past the end" );
+
+	std::error_code error;
+	std::filesystem::remove( path, error );
+}
+
+static int PrintUsage()
+{
+	std::printf( "usage: ArcheryLocationalDamageEquivalence [--iterations <n>] [--seed <s>] [--property <name>] [--max-failures <n>]\n" );
+	std::printf( "properties: filter, jit, location, decision, batch, order, node, trace\n" );
+	return 2;
+}
+
+int main( int a_argc, char** a_argv )
+{
+	using Property = void (*)( Harness&, uint32_t );
+	const std::pair<const char*, Property> properties[] = {
+		{ "filter", CheckFilter },
+		{ "jit", CheckJIT },
+		{ "location", CheckLocation },
+		{ "decision", CheckDecision },
+		{ "batch", CheckBatch },
+		{ "order", CheckOrder },
+		{ "node", CheckNode },
+		{ "trace", CheckTrace },
+	};
+
+	uint32_t iterations		= 50;
+	uint32_t seed			= 1;
+	uint32_t maxFailures	= 20;
+	std::string_view only;
+	for( int i = 1; i < a_argc; ++i )
+	{
+		std::string_view arg = a_argv[ i ];
+		if( i + 1 >= a_argc )
+			return PrintUsage();
+
+		if( arg == "--iterations" )
+			iterations = (uint32_t)std::strtoul( a_argv[ ++i ], nullptr, 10 );
+		else if( arg == "--seed" )
+			seed = (uint32_t)std::strtoul( a_argv[ ++i ], nullptr, 10 );
+		else if( arg == "--max-failures" )
+			maxFailures = (uint32_t)std::strtoul( a_argv[ ++i ], nullptr, 10 );
+		else if( arg == "--property" )
+			only = a_argv[ ++i ];
+		else
+			return PrintUsage();
+	}
+
+	Harness harness( maxFailures );
+	bool isKnown = only.empty();
+	for( auto& [ name, property ] : properties )
+	{
+		if( !only.empty() && only != name )
+			continue;
+
+		isKnown = true;
+		if( property == CheckJIT && !FilterJIT::IsAvailable() )
+		{
+			std::printf( "%-10s not built, configure with -DALD_FILTER_JIT=ON\n", name );
+			if( !only.empty() )
+				++harness.failures;
+
+			continue;
+		}
+
+		auto cases		= harness.cases;
+		auto failures	= harness.failures;
+		auto start		= std::chrono::steady_clock::now();
+		for( uint32_t i = 0; i < iterations; ++i )
+			property( harness, seed + i );
+
+		// A property that checks nothing must not pass silently
+		if( harness.cases == cases )
+			++harness.failures;
+
+		std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+		std::printf( "%-10s %10llu cases %6llu failures %8.2f s\n", name, (unsigned long long)( harness.cases - cases ), (unsigned long long)( harness.failures - failures ), elapsed.count() );
+	}
+
+	if( !isKnown )
+		return PrintUsage();
+
+	return harness.failures ? 1 : 0;
+}
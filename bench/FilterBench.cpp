@@ -0,0 +1,149 @@
+#include "Fixtures.h"
+#include "core/SnapshotFilter.h"
+#include "core/FilterJIT.h"
+#include "core/FilterMemo.h"
+
+// Target and shooter filters of every rule for one hit.
+// Args: rules, actor keywords, worn armors and active effects of the target.
+struct FilterFixture
+{
+	explicit FilterFixture( const benchmark::State& a_state ) :
+		rules( Fixtures::MakeRules( (uint32_t)a_state.range( 0 ), 1 ) ),
+		world( Fixtures::GetWorld() ),
+		target( Fixtures::MakeActor( world, (uint32_t)a_state.range( 1 ), (uint32_t)a_state.range( 2 ), (uint32_t)a_state.range( 3 ), 11 ) ),
+		shooter( Fixtures::MakeActor( world, 8, 4, 2, 12 ) ),
+		projectile( Fixtures::MakeProjectile( world, 13 ) )
+	{
+		code.Compile( rules->locations, world.GetForms() );
+	}
+
+	std::unique_ptr<RuleData>	rules;
+	const Fixtures::World&		world;
+	ActorSnapshot				target;
+	ActorSnapshot				shooter;
+	ProjectileSnapshot			projectile;
+	FilterCode					code;
+};
+
+static void BM_FilterReference( benchmark::State& a_state )
+{
+	FilterFixture fixture( a_state );
+	for( auto _ : a_state )
+	{
+		uint32_t passed = 0;
+		for( auto& location : fixture.rules->locations )
+		{
+			passed += SnapshotFilter::IsVaild( location.targetFilter, &fixture.target, &fixture.projectile );
+			passed += SnapshotFilter::IsVaild( location.shooterFilter, &fixture.shooter, &fixture.projectile );
+		}
+
+		benchmark::DoNotOptimize( passed );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() * fixture.rules->locations.size() * 2 );
+}
+
+static void BM_FilterCode( benchmark::State& a_state )
+{
+	FilterFixture fixture( a_state );
+	for( auto _ : a_state )
+	{
+		// Facts are gathered once per hit and shared by every rule
+		SnapshotFacts targetFacts( fixture.code, &fixture.target, &fixture.projectile );
+		SnapshotFacts shooterFacts( fixture.code, &fixture.shooter, &fixture.projectile );
+
+		uint32_t passed = 0;
+		for( auto& location : fixture.rules->locations )
+		{
+			passed += targetFacts.Evaluate( location.targetFilter );
+			passed += shooterFacts.Evaluate( location.shooterFilter );
+		}
+
+		benchmark::DoNotOptimize( passed );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() * fixture.rules->locations.size() * 2 );
+}
+
+// BM_FilterCode with the native code of FilterJIT instead of the interpreter, the pair decides '[Settings] FilterJIT'
+static void BM_FilterJIT( benchmark::State& a_state )
+{
+	if( !FilterJIT::IsAvailable() )
+	{
+		a_state.SkipWithError( "built without ALD_FILTER_JIT" );
+		return;
+	}
+
+	FilterFixture fixture( a_state );
+	auto jit = FilterJIT::Create<SnapshotFacts>( fixture.code );
+
+	auto evaluate = [ &jit ]( const ActorFilter& a_filter, SnapshotFacts& a_facts )
+	{
+		return a_filter.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+		{
+			return jit->Run( a_filter.programEntries[ a_predicate ], a_facts );
+		});
+	};
+
+	for( auto _ : a_state )
+	{
+		SnapshotFacts targetFacts( fixture.code, &fixture.target, &fixture.projectile );
+		SnapshotFacts shooterFacts( fixture.code, &fixture.shooter, &fixture.projectile );
+
+		uint32_t passed = 0;
+		for( auto& location : fixture.rules->locations )
+		{
+			passed += evaluate( location.targetFilter, targetFacts );
+			passed += evaluate( location.shooterFilter, shooterFacts );
+		}
+
+		benchmark::DoNotOptimize( passed );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() * fixture.rules->locations.size() * 2 );
+}
+
+// The next hits of a volley: the outcomes of BM_FilterCode read back from the memo of the thread.
+// Rules past FilterMemo::kSize collide in the direct mapped table, the miss rate is reported.
+static void BM_FilterMemo( benchmark::State& a_state )
+{
+	FilterFixture fixture( a_state );
+	auto& locations = fixture.rules->locations;
+	auto makeKey = []( uint32_t a_rule ) { return FilterMemo::Key{ 1, a_rule, 0x12, 0x11, 0x13, 0x14 }; };
+
+	// First hit of the pair evaluates the filters and stores the outcomes
+	{
+		SnapshotFacts targetFacts( fixture.code, &fixture.target, &fixture.projectile );
+		SnapshotFacts shooterFacts( fixture.code, &fixture.shooter, &fixture.projectile );
+		for( uint32_t rule = 0; rule < locations.size(); ++rule )
+		{
+			bool isPassed = targetFacts.Evaluate( locations[ rule ].targetFilter ) && shooterFacts.Evaluate( locations[ rule ].shooterFilter );
+			FilterMemo::Store( makeKey( rule ), isPassed, 3600 * 1000 );
+		}
+	}
+
+	uint64_t misses = 0;
+	for( auto _ : a_state )
+	{
+		uint32_t passed = 0;
+		for( uint32_t rule = 0; rule < locations.size(); ++rule )
+		{
+			auto result = FilterMemo::Find( makeKey( rule ) );
+			passed += result == FilterMemo::Result::kPassed;
+			misses += result == FilterMemo::Result::kUnknown;
+		}
+
+		benchmark::DoNotOptimize( passed );
+	}
+
+	// Both filters of a rule per lookup, items compare with BM_FilterCode
+	a_state.SetItemsProcessed( a_state.iterations() * locations.size() * 2 );
+	a_state.counters[ "miss_rate" ] = (double)misses / ( a_state.iterations() * locations.size() );
+}
+
+static const std::vector<std::vector<int64_t>> kFilterArgs = { { 10, 100, 1000 }, { 4, 64 }, { 0, 8 }, { 0, 32 } };
+
+BENCHMARK( BM_FilterReference )->ArgNames( { "rules", "keywords", "armors", "effects" } )->ArgsProduct( kFilterArgs );
+BENCHMARK( BM_FilterCode )->ArgNames( { "rules", "keywords", "armors", "effects" } )->ArgsProduct( kFilterArgs );
+BENCHMARK( BM_FilterJIT )->ArgNames( { "rules", "keywords", "armors", "effects" } )->ArgsProduct( kFilterArgs );
+BENCHMARK( BM_FilterMemo )->ArgNames( { "rules", "keywords", "armors", "effects" } )->ArgsProduct( kFilterArgs );
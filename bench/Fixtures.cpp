@@ -0,0 +1,472 @@
+#include "Fixtures.h"
+
+namespace Fixtures
+{
+	Node* Node::AddChild( std::string a_name, Point3 a_offset, bool a_hasCollision )
+	{
+		auto child = std::make_unique<Node>();
+		child->name			= std::move( a_name );
+		child->position		= { position.x + a_offset.x, position.y + a_offset.y, position.z + a_offset.z };
+		child->hasCollision	= a_hasCollision;
+
+		children.push_back( std::move( child ) );
+		return children.back().get();
+	}
+
+	const char* GetSkeletonName( SkeletonType a_type )
+	{
+		switch( a_type )
+		{
+		case SkeletonType::kHumanoid:	return "humanoid";
+		case SkeletonType::kDragon:		return "dragon";
+		case SkeletonType::kHorse:		return "horse";
+		default:						return "unknown";
+		}
+	}
+
+	static void AddHumanoidArm( Node* a_spine, bool a_isLeft )
+	{
+		std::string side	= a_isLeft ? "L" : "R";
+		float sign			= a_isLeft ? -1.0f : 1.0f;
+
+		auto clavicle	= a_spine->AddChild( "NPC " + side + " Clavicle [" + side + "Clv]", { sign * 4, 0, 8 }, false );
+		auto upperArm	= clavicle->AddChild( "NPC " + side + " UpperArm [" + side + "Uar]", { sign * 8, 0, -2 }, true );
+		upperArm->AddChild( "NPC " + side + " UpperarmTwist1 [" + side + "Ut1]", { sign * 5, 0, -1 }, false );
+		auto forearm	= upperArm->AddChild( "NPC " + side + " Forearm [" + side + "Lar]", { sign * 14, 0, -2 }, true );
+		forearm->AddChild( "NPC " + side + " ForearmTwist1 [" + side + "Lt1]", { sign * 6, 0, 0 }, false );
+		auto hand		= forearm->AddChild( "NPC " + side + " Hand [" + side + "Hnd]", { sign * 12, 0, 0 }, true );
+
+		for( int finger = 0; finger < 5; ++finger )
+		{
+			auto joint = hand;
+			for( int segment = 0; segment < 3; ++segment )
+			{
+				auto id = std::to_string( finger ) + std::to_string( segment );
+				joint = joint->AddChild( "NPC " + side + " Finger" + id + " [" + side + "F" + id + "]", { sign * 1.5f, finger - 2.0f, 0 }, false );
+			}
+		}
+
+		if( a_isLeft )
+			hand->AddChild( "SHIELD", { sign * 2, 0, 0 }, false )->AddChild( "ShieldNode", { 0, 0, 0 }, true );
+		else
+			hand->AddChild( "WEAPON", { sign * 2, 0, 0 }, false );
+	}
+
+	static void AddHumanoidLeg( Node* a_pelvis, bool a_isLeft )
+	{
+		std::string side	= a_isLeft ? "L" : "R";
+		float sign			= a_isLeft ? -1.0f : 1.0f;
+
+		auto thigh	= a_pelvis->AddChild( "NPC " + side + " Thigh [" + side + "Thg]", { sign * 6, 0, -4 }, true );
+		auto calf	= thigh->AddChild( "NPC " + side + " Calf [" + side + "Clf]", { 0, 0, -22 }, true );
+		auto foot	= calf->AddChild( "NPC " + side + " Foot [" + side + "ft ]", { 0, 0, -22 }, true );
+		foot->AddChild( "NPC " + side + " Toe0 [" + side + "Toe]", { 0, 6, -3 }, false );
+	}
+
+	static std::unique_ptr<Node> MakeHumanoid()
+	{
+		auto root = std::make_unique<Node>();
+		root->name = "NPC Root [Root]";
+
+		auto com	= root->AddChild( "NPC COM [COM ]", { 0, 0, 68 }, false );
+		auto pelvis	= com->AddChild( "NPC Pelvis [Pelv]", { 0, 0, 0 }, true );
+		AddHumanoidLeg( pelvis, true );
+		AddHumanoidLeg( pelvis, false );
+
+		auto spine = com->AddChild( "NPC Spine [Spn0]", { 0, 0, 6 }, true );
+		spine = spine->AddChild( "NPC Spine1 [Spn1]", { 0, 0, 8 }, true );
+		spine = spine->AddChild( "NPC Spine2 [Spn2]", { 0, 0, 8 }, true );
+		AddHumanoidArm( spine, true );
+		AddHumanoidArm( spine, false );
+
+		auto neck = spine->AddChild( "NPC Neck [Neck]", { 0, 0, 14 }, true );
+		auto head = neck->AddChild( "NPC Head [Head]", { 0, 0, 6 }, true );
+		head->AddChild( "NPCEyeBone", { 0, 4, 4 }, false );
+		head->AddChild( "NPC Head MagicNode [Hmag]", { 0, 8, 4 }, false );
+
+		spine->AddChild( "QUIVER", { 0, -6, 4 }, false );
+		spine->AddChild( "WeaponBack", { 0, -6, 0 }, false );
+		pelvis->AddChild( "WeaponSword", { -8, 0, 0 }, false );
+		pelvis->AddChild( "WeaponDagger", { 8, 0, 0 }, false );
+
+		return root;
+	}
+
+	static std::unique_ptr<Node> MakeDragon()
+	{
+		auto root = std::make_unique<Node>();
+		root->name = "NPC Root [Root]";
+
+		auto com	= root->AddChild( "NPC COM", { 0, 0, 180 }, false );
+		auto pelvis	= com->AddChild( "NPC Pelvis", { 0, -80, 0 }, true );
+
+		auto spine = com;
+		for( int i = 1; i <= 3; ++i )
+			spine = spine->AddChild( "NPC Spine" + std::to_string( i ), { 0, 60, 10 }, true );
+
+		auto neck = spine;
+		for( int i = 1; i <= 6; ++i )
+			neck = neck->AddChild( "NPC Neck" + std::to_string( i ), { 0, 40, 20 }, true );
+
+		auto head = neck->AddChild( "NPC Head", { 0, 50, 10 }, true );
+		head->AddChild( "NPC Jaw", { 0, 40, -10 }, true );
+		head->AddChild( "NPC Tongue1", { 0, 30, -5 }, false );
+
+		for( auto side : { "L", "R" } )
+		{
+			float sign = side[ 0 ] == 'L' ? -1.0f : 1.0f;
+
+			auto wing = spine->AddChild( std::string( "NPC " ) + side + "Wing1", { sign * 40, 0, 20 }, true );
+			for( int i = 2; i <= 4; ++i )
+				wing = wing->AddChild( std::string( "NPC " ) + side + "Wing" + std::to_string( i ), { sign * 80, 0, 0 }, true );
+
+			for( int finger = 1; finger <= 4; ++finger )
+			{
+				auto joint = wing;
+				for( int segment = 1; segment <= 3; ++segment )
+					joint = joint->AddChild( std::string( "NPC " ) + side + "WingFinger" + std::to_string( finger ) + std::to_string( segment ), { sign * 60, finger * -30.0f, 0 }, false );
+			}
+
+			for( auto [ leg, anchor ] : { std::pair{ "Front", spine }, std::pair{ "Rear", pelvis } } )
+			{
+				auto joint = anchor->AddChild( std::string( "NPC " ) + side + leg + "Thigh", { sign * 50, 0, -40 }, true );
+				joint = joint->AddChild( std::string( "NPC " ) + side + leg + "Calf", { 0, 0, -60 }, true );
+				joint = joint->AddChild( std::string( "NPC " ) + side + leg + "Foot", { 0, 10, -60 }, true );
+				for( int toe = 1; toe <= 3; ++toe )
+					joint->AddChild( std::string( "NPC " ) + side + leg + "Toe" + std::to_string( toe ), { toe * 5.0f, 15, 0 }, false );
+			}
+		}
+
+		auto tail = pelvis;
+		for( int i = 1; i <= 12; ++i )
+			tail = tail->AddChild( "NPC Tail" + std::to_string( i ), { 0, -50, -5 }, i <= 8 );
+
+		return root;
+	}
+
+	static std::unique_ptr<Node> MakeHorse()
+	{
+		auto root = std::make_unique<Node>();
+		root->name = "HorseRoot";
+
+		auto pelvis	= root->AddChild( "HorsePelvis", { 0, -40, 110 }, true );
+		auto spine	= pelvis;
+		for( int i = 1; i <= 3; ++i )
+			spine = spine->AddChild( "HorseSpine" + std::to_string( i ), { 0, 30, 5 }, true );
+
+		auto neck = spine;
+		for( int i = 1; i <= 4; ++i )
+			neck = neck->AddChild( "HorseNeck" + std::to_string( i ), { 0, 15, 15 }, true );
+
+		auto head = neck->AddChild( "HorseHead", { 0, 20, 10 }, true );
+		head->AddChild( "HorseJaw", { 0, 15, -8 }, false );
+		head->AddChild( "HorseLEar", { -4, 0, 10 }, false );
+		head->AddChild( "HorseREar", { 4, 0, 10 }, false );
+
+		for( auto side : { "L", "R" } )
+		{
+			float sign = side[ 0 ] == 'L' ? -1.0f : 1.0f;
+
+			for( auto [ leg, anchor ] : { std::pair{ "Front", spine }, std::pair{ "Back", pelvis } } )
+			{
+				auto joint = anchor->AddChild( std::string( "Horse" ) + leg + side + "LegUpper", { sign * 15, 0, -20 }, true );
+				joint = joint->AddChild( std::string( "Horse" ) + leg + side + "LegLower", { 0, 0, -30 }, true );
+				joint = joint->AddChild( std::string( "Horse" ) + leg + side + "LegAnkle", { 0, 0, -30 }, true );
+				joint = joint->AddChild( std::string( "Horse" ) + leg + side + "LegHoof", { 0, 2, -15 }, true );
+			}
+		}
+
+		spine->AddChild( "SaddleBone", { 0, -10, 15 }, false );
+
+		auto tail = pelvis;
+		for( int i = 1; i <= 5; ++i )
+			tail = tail->AddChild( "HorseTail" + std::to_string( i ), { 0, -10, -8 }, false );
+
+		return root;
+	}
+
+	std::unique_ptr<Node> MakeSkeleton( SkeletonType a_type )
+	{
+		switch( a_type )
+		{
+		case SkeletonType::kDragon:	return MakeDragon();
+		case SkeletonType::kHorse:	return MakeHorse();
+		default:					return MakeHumanoid();
+		}
+	}
+
+	std::vector<const Node*> GetNodes( const Node* a_root )
+	{
+		std::vector<const Node*> nodes;
+		std::vector<const Node*> pending = { a_root };
+		while( !pending.empty() )
+		{
+			auto node = pending.back();
+			pending.pop_back();
+			nodes.push_back( node );
+
+			for( auto iter = node->children.rbegin(); iter != node->children.rend(); ++iter )
+				pending.push_back( iter->get() );
+		}
+
+		return nodes;
+	}
+
+	static void Flatten( const Node* a_node, int32_t a_parent, SkeletonSnapshot& a_skeleton )
+	{
+		auto index = (int32_t)a_skeleton.nodes.size();
+		auto& node = a_skeleton.nodes.emplace_back();
+		node.name			= a_node->name;
+		node.position		= a_node->position;
+		node.parent			= a_parent;
+		node.hasCollision	= a_node->hasCollision;
+
+		for( auto& child : a_node->children )
+			Flatten( child.get(), index, a_skeleton );
+
+		a_skeleton.nodes[ index ].subtreeSize = (uint32_t)( a_skeleton.nodes.size() - index );
+	}
+
+	SkeletonSnapshot MakeSkeletonSnapshot( SkeletonType a_type )
+	{
+		SkeletonSnapshot skeleton;
+		Flatten( MakeSkeleton( a_type ).get(), -1, skeleton );
+		return skeleton;
+	}
+
+	FilterCode::Forms World::GetForms() const
+	{
+		FilterCode::Forms forms;
+		for( auto& [ formID, editorID ] : races )
+			forms.races.emplace_back( formID, editorID );
+
+		for( auto& [ formID, editorID ] : npcs )
+		{
+			if( !editorID.empty() )
+				forms.npcs.emplace_back( formID, editorID );
+		}
+
+		return forms;
+	}
+
+	static World MakeWorld()
+	{
+		World world;
+
+		const char* races[] = {
+			"NordRace", "ImperialRace", "BretonRace", "RedguardRace", "DarkElfRace", "HighElfRace", "WoodElfRace", "OrcRace",
+			"ArgonianRace", "KhajiitRace", "NordRaceVampire", "ImperialRaceVampire", "DarkElfRaceVampire", "ElderRace",
+			"DragonRace", "HorseRace", "WolfRace", "BearBlackRace", "SabreCatRace", "TrollRace", "SkeeverRace", "DraugrRace",
+			"FalmerRace", "GiantRace", "SprigganRace", "DwarvenCenturionRace", "ChaurusRace", "FrostbiteSpiderRace", "DeerRace",
+			"ElkRace", "MammothRace", "IceWraithRace" };
+
+		for( uint32_t i = 0; i < std::size( races ); ++i )
+			world.races.emplace_back( 0x13740 + i, races[ i ] );
+
+		const char* factions[] = { "EncBandit", "EncDraugr", "EncFalmer", "EncVampire", "EncForsworn", "EncThalmor", "EncSoldier", "EncHunter", "EncWolf", "Guard" };
+		const char* roles[] = { "Melee", "Missile", "Magic", "Boss" };
+		for( uint32_t i = 0; i < 2000; ++i )
+		{
+			// Every tenth NPC has no editor ID and is matched as an empty string
+			std::string editorID;
+			if( i % 10 != 9 )
+				editorID = std::string( factions[ i % std::size( factions ) ] ) + std::to_string( i / 40 ) + roles[ ( i / 10 ) % std::size( roles ) ];
+
+			world.npcs.emplace_back( 0x10000 + i * 7, std::move( editorID ) );
+		}
+
+		world.actorKeywords = {
+			"ActorTypeNPC", "ActorTypeUndead", "ActorTypeAnimal", "ActorTypeCreature", "ActorTypeDragon", "ActorTypeDaedra",
+			"ActorTypeDwarven", "ActorTypeGhost", "ActorTypeGiant", "ActorTypeTroll", "Vampire", "IsBeastRace", "ImmuneParalysis" };
+
+		world.armorKeywords = {
+			"ArmorHeavy", "ArmorLight", "ArmorHelmet", "ArmorCuirass", "ArmorGauntlets", "ArmorBoots", "ArmorShield", "ArmorJewelry",
+			"ArmorMaterialIron", "ArmorMaterialSteel", "ArmorMaterialElven", "ArmorMaterialGlass", "ArmorMaterialEbony", "ArmorMaterialDaedric",
+			"ClothingHead", "ClothingBody" };
+
+		world.magicKeywords = {
+			"MagicArmorSpell", "MagicInvisibility", "MagicSlow", "MagicParalysis", "MagicInfluenceFear", "MagicDamageFire",
+			"MagicDamageFrost", "MagicDamageShock", "MagicCloak", "MagicWard", "MagicRestoreHealth", "MagicSummonUndead" };
+
+		world.weaponKeywords = {
+			"WeapTypeBow", "WeapMaterialIron", "WeapMaterialSteel", "WeapMaterialElven", "WeapMaterialGlass", "WeapMaterialDaedric",
+			"VendorItemArrow", "DLC1WeapTypeCrossbow" };
+
+		return world;
+	}
+
+	const World& GetWorld()
+	{
+		static const World world = MakeWorld();
+		return world;
+	}
+
+	ActorSnapshot MakeActor( const World& a_world, uint32_t a_keywordCount, uint32_t a_armorCount, uint32_t a_effectCount, uint32_t a_seed )
+	{
+		std::mt19937 random( a_seed );
+		auto pick = [ &random ]( const std::vector<std::string>& a_pool ) -> const std::string& { return a_pool[ random() % a_pool.size() ]; };
+
+		ActorSnapshot actor;
+		auto& race			= a_world.races[ random() % a_world.races.size() ];
+		actor.raceID		= race.first;
+		actor.raceEditorID	= race.second;
+		auto& npc			= a_world.npcs[ random() % a_world.npcs.size() ];
+		actor.baseID		= npc.first;
+		actor.baseEditorID	= npc.second;
+		actor.sex			= random() % 2 ? Sex::kFemale : Sex::kMale;
+
+		// Real actors carry a few type keywords and many unrelated ones from their race and mods
+		for( uint32_t i = 0; i < a_keywordCount; ++i )
+			actor.keywords.push_back( i < 3 ? pick( a_world.actorKeywords ) : "ModKeyword" + std::to_string( random() % 1000 ) );
+
+		for( uint32_t i = 0; i < a_armorCount; ++i )
+			actor.wornArmors.push_back( { pick( a_world.armorKeywords ), pick( a_world.armorKeywords ), "VendorItemArmor" } );
+
+		for( uint32_t i = 0; i < a_effectCount; ++i )
+		{
+			auto& effect = actor.activeEffects.emplace_back();
+			effect.keywords		= { pick( a_world.magicKeywords ) };
+			effect.isInactive	= random() % 8 == 0;
+			if( random() % 2 )
+				effect.keywords.push_back( pick( a_world.magicKeywords ) );
+		}
+
+		actor.maxHealth	= (float)( 50 + random() % 450 );
+		actor.health	= actor.maxHealth;
+
+		return actor;
+	}
+
+	ProjectileSnapshot MakeProjectile( const World& a_world, uint32_t a_seed )
+	{
+		std::mt19937 random( a_seed );
+
+		ProjectileSnapshot projectile;
+		projectile.ammo				= random() % 4 ? AmmoType::Arrow : AmmoType::Bolt;
+		projectile.weaponKeywords	= { projectile.ammo == AmmoType::Bolt ? "DLC1WeapTypeCrossbow" : "WeapTypeBow", a_world.weaponKeywords[ 1 + random() % 5 ] };
+		projectile.ammoKeywords		= { "VendorItemArrow", a_world.weaponKeywords[ 1 + random() % 5 ] };
+
+		return projectile;
+	}
+
+	std::string MakeIni( uint32_t a_ruleCount, uint32_t a_seed )
+	{
+		std::mt19937 random( a_seed );
+		auto chance = [ &random ]( uint32_t a_percent ) { return random() % 100 < a_percent; };
+		auto& world = GetWorld();
+
+		// Own sequence for the keys added later, the rest of the rules stay the same for a seed
+		std::mt19937 extraRandom( a_seed ^ 0x9e3779b9 );
+		auto extraChance = [ &extraRandom ]( uint32_t a_percent ) { return extraRandom() % 100 < a_percent; };
+
+		const char* nodePatterns[] = {
+			".*Head.*", ".*Neck.*", "NPC Spine[0-2]? \\[Spn[0-2]\\]", "NPC (L|R) (Thigh|Calf) .*", "NPC (L|R) (UpperArm|Forearm) .*",
+			"NPC (L|R) Hand .*", "NPC (L|R) Foot .*", "NPC Pelvis.*", "SHIELD|ShieldNode", "NPC (L|R)Wing[0-9]", "NPC Tail[0-9]+",
+			"NPC (L|R)(Front|Rear)(Thigh|Calf|Foot)", "Horse(Front|Back)(L|R)Leg.*", "HorseHead|HorseNeck[1-4]", "HorseSpine[1-3]" };
+
+		const char* racePatterns[] = { "NordRace.*", ".*ElfRace.*", "(Dragon|Horse)Race", ".*Vampire", "(Argonian|Khajiit)Race", "Draugr.*|Falmer.*" };
+		const char* editorIDPatterns[] = { "EncBandit.*", ".*Boss", "EncDraugr[0-9]+Melee", "Guard.*|EncSoldier.*" };
+		const char* keywordTypes = "AEMW";
+
+		auto makeClauses = [ & ]()
+		{
+			std::string list;
+			uint32_t clauseCount = 1 + random() % 2;
+			for( uint32_t i = 0; i < clauseCount; ++i )
+			{
+				char type = keywordTypes[ random() % 4 ];
+				auto& pool = type == 'A' ? world.actorKeywords : type == 'E' ? world.armorKeywords : type == 'M' ? world.magicKeywords : world.weaponKeywords;
+
+				list += i ? ", " : "";
+				list += type;
+				list += ':';
+				list += pool[ random() % pool.size() ];
+				if( chance( 30 ) )
+					list += "+-" + pool[ random() % pool.size() ];
+			}
+
+			return list;
+		};
+
+		std::string ini = "[Version]\nMajor = 2\n\n[Settings]\nLocationExclude = NPC Root.*|NPC COM.*|HorseRoot\nPlayerNodeInclude = NPC (Head|Neck|Spine).*\n\n";
+		for( uint32_t i = 0; i < a_ruleCount; ++i )
+		{
+			ini += "[Location" + std::to_string( i + 1 ) + "]\n";
+			ini += "Regexp = " + std::string( chance( 95 ) ? nodePatterns[ random() % std::size( nodePatterns ) ] : "" ) + "\n";
+			ini += "Multiplier = " + std::to_string( 0.5 + ( random() % 30 ) / 10.0 ) + "\n";
+			ini += "SuccessChance = " + std::to_string( chance( 70 ) ? 100 : random() % 100 ) + "\n";
+			ini += "Continue = " + std::string( chance( 20 ) ? "true" : "false" ) + "\n";
+			ini += "Message = Location " + std::to_string( i + 1 ) + " hit\n";
+			ini += "MessageFloating = Hit " + std::to_string( i + 1 ) + "\n";
+			ini += "HitSound = UIHitSound" + std::to_string( i % 8 ) + "\n";
+
+			if( chance( 20 ) )
+				ini += "Effect = " + std::to_string( random() % 100 ) + "% BenchEffect" + std::to_string( i ) + "\n";
+
+			if( chance( 30 ) )
+				ini += "KeywordInclude = " + makeClauses() + "\n";
+			if( chance( 10 ) )
+				ini += "KeywordInclude = " + makeClauses() + "\n";
+			if( chance( 15 ) )
+				ini += "KeywordExclude = " + makeClauses() + "\n";
+			if( chance( 25 ) )
+				ini += "RaceInclude = " + std::string( racePatterns[ random() % std::size( racePatterns ) ] ) + "\n";
+			if( chance( 10 ) )
+				ini += "RaceExclude = " + std::string( racePatterns[ random() % std::size( racePatterns ) ] ) + "\n";
+			if( chance( 15 ) )
+				ini += "Sex = " + std::string( chance( 50 ) ? "M" : "F" ) + "\n";
+			if( chance( 10 ) )
+				ini += "EditorID = " + std::string( editorIDPatterns[ random() % std::size( editorIDPatterns ) ] ) + "\n";
+			if( chance( 10 ) )
+				ini += "AmmoType = " + std::to_string( 1 + random() % 2 ) + "\n";
+
+			if( chance( 10 ) )
+				ini += "ShooterKeywordInclude = " + makeClauses() + "\n";
+			if( chance( 10 ) )
+				ini += "ShooterRaceInclude = " + std::string( racePatterns[ random() % std::size( racePatterns ) ] ) + "\n";
+			if( chance( 5 ) )
+				ini += "ShooterEditorID = " + std::string( editorIDPatterns[ random() % std::size( editorIDPatterns ) ] ) + "\n";
+
+			if( extraChance( 15 ) )
+				ini += "UsePerkCondition = BenchPerk" + std::to_string( extraRandom() % 8 ) + "\n";
+			if( extraChance( 15 ) )
+				ini += "SuccessHPFactor = " + std::to_string( (int)( extraRandom() % 200 ) - 100 ) + "\n";
+
+			ini += "\n";
+		}
+
+		return ini;
+	}
+
+	std::unique_ptr<RuleData> MakeRules( uint32_t a_ruleCount, uint32_t a_seed )
+	{
+		auto rules = std::make_unique<RuleData>();
+		RuleCompiler::Options options;
+		RuleCompiler::Parse( MakeIni( a_ruleCount, a_seed ), *rules, options );
+		rules->CompilePatterns();
+
+		return rules;
+	}
+
+	std::vector<ShotDifficultyParams> MakeShots( uint32_t a_count, uint32_t a_seed )
+	{
+		std::mt19937 random( a_seed );
+		std::uniform_real_distribution<float> unit( 0, 1 );
+
+		std::vector<ShotDifficultyParams> shots( a_count );
+		for( auto& shot : shots )
+		{
+			shot.flightTime			= unit( random ) * 2.5f;
+			shot.projectileSpeed	= 3000 + unit( random ) * 2000;
+			shot.distanceMoved		= shot.flightTime * shot.projectileSpeed;
+			shot.targetSpeed		= unit( random ) < 0.4f ? 0 : unit( random ) * 400;
+			shot.crossFactor		= unit( random );
+			shot.hasBound			= unit( random ) < 0.95f;
+			shot.boundHeight		= 20 + unit( random ) * 200;
+			shot.boundWidth			= 10 + unit( random ) * 100;
+			shot.isFlying			= unit( random ) < 0.05f;
+		}
+
+		return shots;
+	}
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/Rules.h"
+#include "core/RuleCompiler.h"
+#include "core/FilterCode.h"
+#include "core/NodeSearch.h"
+#include "core/ShotDifficulty.h"
+#include "core/HitRecord.h"
+
+// Synthetic stand-ins for the game data the hit pipeline reads: skeletons, actors, projectiles and rule sets.
+// Everything is generated from a seed so two builds benchmark the same input.
+namespace Fixtures
+{
+	struct Node
+	{
+		std::string							name;
+		Point3								position;
+		bool								hasCollision = false;
+		std::vector<std::unique_ptr<Node>>	children;
+
+		Node* AddChild( std::string a_name, Point3 a_offset, bool a_hasCollision );
+	};
+
+	// NodeSearch adapter of the synthetic scene graph
+	struct NodeAdapter
+	{
+		static const char* GetName( const Node* a_node ) { return a_node->name.c_str(); }
+
+		static bool HasCollision( const Node* a_node ) { return a_node->hasCollision; }
+
+		static Point3 GetPosition( const Node* a_node ) { return a_node->position; }
+
+		template <class Callback>
+		static void ForEachChild( Node* a_node, Callback&& a_callback )
+		{
+			for( auto& child : a_node->children )
+				a_callback( child.get() );
+		}
+	};
+
+	enum class SkeletonType
+	{
+		kHumanoid,
+		kDragon,
+		kHorse,
+
+		kTotal
+	};
+
+	const char* GetSkeletonName( SkeletonType a_type );
+
+	// Node names and hierarchy follow the vanilla skeletons, positions are in game units around the origin
+	std::unique_ptr<Node> MakeSkeleton( SkeletonType a_type );
+
+	// Every node of the tree, depth first
+	std::vector<const Node*> GetNodes( const Node* a_root );
+
+	// Same skeleton flattened as the plugin captures it
+	SkeletonSnapshot MakeSkeletonSnapshot( SkeletonType a_type );
+
+	// Loaded forms of the synthetic load order
+	struct World
+	{
+		std::vector<std::pair<uint32_t, std::string>>	races;
+		std::vector<std::pair<uint32_t, std::string>>	npcs;
+		std::vector<std::string>						actorKeywords;
+		std::vector<std::string>						armorKeywords;
+		std::vector<std::string>						magicKeywords;
+		std::vector<std::string>						weaponKeywords;
+
+		FilterCode::Forms GetForms() const;
+	};
+
+	const World& GetWorld();
+
+	ActorSnapshot MakeActor( const World& a_world, uint32_t a_keywordCount, uint32_t a_armorCount, uint32_t a_effectCount, uint32_t a_seed );
+	ProjectileSnapshot MakeProjectile( const World& a_world, uint32_t a_seed );
+
+	// INI text with a_ruleCount [Location<number>] sections in the format of the shipped INI
+	std::string MakeIni( uint32_t a_ruleCount, uint32_t a_seed );
+
+	// Parsed and compiled rule set of MakeIni
+	std::unique_ptr<RuleData> MakeRules( uint32_t a_ruleCount, uint32_t a_seed );
+
+	std::vector<ShotDifficultyParams> MakeShots( uint32_t a_count, uint32_t a_seed );
+}
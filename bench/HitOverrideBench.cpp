@@ -0,0 +1,63 @@
+#include "Fixtures.h"
+#include "core/HitOverride.h"
+
+// Overrides of other hits waiting for their attack, as in a fight with several archers
+static HitOverrideList MakePending( int64_t a_count )
+{
+	static int references[ 256 ];
+
+	HitOverrideList list;
+	for( int64_t i = 0; i < a_count; ++i )
+	{
+		HitOverride hitOverride;
+		hitOverride.aggressor		= &references[ i % 256 ];
+		hitOverride.target			= &references[ ( i * 7 + 1 ) % 256 ];
+		hitOverride.location		= { (float)i, (float)i * 2, 100 };
+		hitOverride.expireTimestamp	= ~0ull;
+		list.Add( hitOverride );
+	}
+
+	return list;
+}
+
+// Record at impact and take back at attack, arg: overrides already pending
+static void BM_HitOverrideMatch( benchmark::State& a_state )
+{
+	auto list = MakePending( a_state.range( 0 ) );
+
+	int aggressor, target;
+	HitOverride hitOverride;
+	hitOverride.aggressor		= &aggressor;
+	hitOverride.target			= &target;
+	hitOverride.location		= { 1, 2, 3 };
+	hitOverride.damageMult		= 2;
+	hitOverride.expireTimestamp	= ~0ull;
+
+	for( auto _ : a_state )
+	{
+		list.Add( hitOverride );
+
+		HitOverride taken;
+		benchmark::DoNotOptimize( list.Take( &aggressor, &target, hitOverride.location, taken ) );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_HitOverrideMatch )->ArgName( "pending" )->Arg( 0 )->Arg( 8 )->Arg( 64 );
+
+// Attack of another reference, every pending override is compared
+static void BM_HitOverrideMiss( benchmark::State& a_state )
+{
+	auto list = MakePending( a_state.range( 0 ) );
+
+	int aggressor, target;
+	for( auto _ : a_state )
+	{
+		HitOverride taken;
+		benchmark::DoNotOptimize( list.Take( &aggressor, &target, { 1, 2, 3 }, taken ) );
+		list.Expire( 0 );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_HitOverrideMiss )->ArgName( "pending" )->Arg( 0 )->Arg( 8 )->Arg( 64 );
@@ -0,0 +1,73 @@
+#include "Fixtures.h"
+
+// Closest hit node of an impact point, args: skeleton type and whether the target is the player
+static void BM_FindClosestHitNode( benchmark::State& a_state )
+{
+	auto type		= (Fixtures::SkeletonType)a_state.range( 0 );
+	bool isPlayer	= a_state.range( 1 ) != 0;
+	auto skeleton	= Fixtures::MakeSkeleton( type );
+
+	RuleData rules;
+	rules.excludeRegexp = CreateRegex( "NPC Root.*|NPC COM.*|HorseRoot" );
+	rules.playerNodes = CreateRegex( "NPC (Head|Neck|Spine).*" );
+	rules.CompilePatterns();
+
+	// Impacts around the hit boxes, slightly off every node
+	std::mt19937 random( 42 );
+	std::uniform_real_distribution<float> jitter( -6, 6 );
+	std::vector<Point3> impacts;
+	for( auto node : Fixtures::GetNodes( skeleton.get() ) )
+	{
+		if( node->hasCollision )
+			impacts.push_back( { node->position.x + jitter( random ), node->position.y + jitter( random ), node->position.z + jitter( random ) } );
+	}
+
+	size_t index = 0;
+	for( auto _ : a_state )
+	{
+		float distance;
+		auto node = NodeSearch::FindClosestHitNode<Fixtures::NodeAdapter>( skeleton.get(), impacts[ index ], distance, isPlayer, rules );
+		benchmark::DoNotOptimize( node );
+
+		index = index + 1 < impacts.size() ? index + 1 : 0;
+	}
+
+	a_state.SetLabel( Fixtures::GetSkeletonName( type ) );
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_FindClosestHitNode )->ArgNames( { "skeleton", "player" } )->ArgsProduct( { { 0, 1, 2 }, { 0, 1 } } );
+
+// Player hit over the candidates gathered once per camera mode, arg: skeleton type
+static void BM_FindClosestPlayerNode( benchmark::State& a_state )
+{
+	auto type		= (Fixtures::SkeletonType)a_state.range( 0 );
+	auto skeleton	= Fixtures::MakeSkeleton( type );
+
+	RuleData rules;
+	rules.excludeRegexp = CreateRegex( "NPC Root.*|NPC COM.*|HorseRoot" );
+	rules.playerNodes = CreateRegex( "NPC (Head|Neck|Spine).*" );
+	rules.CompilePatterns();
+
+	NodeSearch::PlayerNodes<Fixtures::Node> candidates;
+	NodeSearch::CollectPlayerNodes<Fixtures::NodeAdapter>( skeleton.get(), rules, candidates );
+
+	std::mt19937 random( 42 );
+	std::uniform_real_distribution<float> jitter( -6, 6 );
+	std::vector<Point3> impacts;
+	for( auto node : Fixtures::GetNodes( skeleton.get() ) )
+		impacts.push_back( { node->position.x + jitter( random ), node->position.y + jitter( random ), node->position.z + jitter( random ) } );
+
+	size_t index = 0;
+	for( auto _ : a_state )
+	{
+		float distance;
+		auto node = NodeSearch::FindClosestPlayerNode<Fixtures::NodeAdapter>( candidates, impacts[ index ], distance );
+		benchmark::DoNotOptimize( node );
+
+		index = index + 1 < impacts.size() ? index + 1 : 0;
+	}
+
+	a_state.SetLabel( Fixtures::GetSkeletonName( type ) );
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_FindClosestPlayerNode )->ArgName( "skeleton" )->DenseRange( 0, 2 );
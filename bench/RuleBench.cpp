@@ -0,0 +1,155 @@
+#include "Fixtures.h"
+#include "core/BinaryArchive.h"
+
+// Names of every node with a hit box, the inputs of the rule scan
+static std::vector<std::string> GetHitNodeNames()
+{
+	std::vector<std::string> names;
+	for( int type = 0; type < (int)Fixtures::SkeletonType::kTotal; ++type )
+	{
+		auto skeleton = Fixtures::MakeSkeleton( (Fixtures::SkeletonType)type );
+		for( auto node : Fixtures::GetNodes( skeleton.get() ) )
+		{
+			if( node->hasCollision )
+				names.push_back( node->name );
+		}
+	}
+
+	return names;
+}
+
+// Rule scan of a hit over the LocationRule array, the layout before HotRules
+static void BM_RuleScanLocations( benchmark::State& a_state )
+{
+	auto rules = Fixtures::MakeRules( (uint32_t)a_state.range( 0 ), 1 );
+	for( auto& location : rules->locations )
+	{
+		if( !location.regexp.empty() )
+			location.regexp.Compile();
+	}
+
+	auto names = GetHitNodeNames();
+	size_t index = 0;
+	for( auto _ : a_state )
+	{
+		auto name = names[ index ].c_str();
+		uint32_t matched = 0;
+		for( auto& location : rules->locations )
+		{
+			if( location.enable && std::regex_match( name, location.regexp.regex ) )
+			{
+				++matched;
+				if( !location.shouldContinue )
+					break;
+			}
+		}
+
+		benchmark::DoNotOptimize( matched );
+		index = index + 1 < names.size() ? index + 1 : 0;
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_RuleScanLocations )->ArgName( "rules" )->Arg( 10 )->Arg( 100 )->Arg( 1000 );
+
+// Same scan over the hot rule table
+static void BM_RuleScanHot( benchmark::State& a_state )
+{
+	auto rules = Fixtures::MakeRules( (uint32_t)a_state.range( 0 ), 1 );
+	auto& hotRules = rules->hotRules;
+
+	auto names = GetHitNodeNames();
+	size_t index = 0;
+	for( auto _ : a_state )
+	{
+		auto name = names[ index ].c_str();
+		uint32_t matched = 0;
+		for( uint32_t rule = 0; rule < hotRules.size(); ++rule )
+		{
+			if( hotRules.IsMatched( rule, name ) )
+			{
+				++matched;
+				if( !hotRules.Has( rule, HotRules::kContinue ) )
+					break;
+			}
+		}
+
+		benchmark::DoNotOptimize( matched );
+		index = index + 1 < names.size() ? index + 1 : 0;
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_RuleScanHot )->ArgName( "rules" )->Arg( 10 )->Arg( 100 )->Arg( 1000 );
+
+// Same scan with the node name looked up in the node match cache
+static void BM_RuleScanCached( benchmark::State& a_state )
+{
+	auto rules = Fixtures::MakeRules( (uint32_t)a_state.range( 0 ), 1 );
+	auto& hotRules = rules->hotRules;
+
+	auto names = GetHitNodeNames();
+	size_t index = 0;
+	for( auto _ : a_state )
+	{
+		auto& match = rules->MatchNode( names[ index ] );
+		uint32_t matched = 0;
+		for( uint32_t rule = 0; rule < hotRules.size(); ++rule )
+		{
+			if( match.IsRuleMatched( rule ) )
+			{
+				++matched;
+				if( !hotRules.Has( rule, HotRules::kContinue ) )
+					break;
+			}
+		}
+
+		benchmark::DoNotOptimize( matched );
+		index = index + 1 < names.size() ? index + 1 : 0;
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() );
+}
+BENCHMARK( BM_RuleScanCached )->ArgName( "rules" )->Arg( 10 )->Arg( 100 )->Arg( 1000 );
+
+// Settings load from the INI: parse every section and compile the patterns
+static void BM_RuleLoadIni( benchmark::State& a_state )
+{
+	auto ini = Fixtures::MakeIni( (uint32_t)a_state.range( 0 ), 1 );
+	for( auto _ : a_state )
+	{
+		RuleData rules;
+		RuleCompiler::Options options;
+		RuleCompiler::Parse( ini, rules, options );
+		rules.CompilePatterns();
+
+		benchmark::DoNotOptimize( rules.hotRules.size() );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() * a_state.range( 0 ) );
+	a_state.SetBytesProcessed( a_state.iterations() * ini.size() );
+}
+BENCHMARK( BM_RuleLoadIni )->ArgName( "rules" )->Arg( 100 )->Arg( 5000 )->Unit( benchmark::kMillisecond )->UseRealTime();
+
+// Settings load from the cache: skips INI parsing only, the patterns are still compiled
+static void BM_RuleLoadCache( benchmark::State& a_state )
+{
+	auto rules = Fixtures::MakeRules( (uint32_t)a_state.range( 0 ), 1 );
+	BinaryWriter writer;
+	writer( *rules );
+	auto& buffer = writer.GetBuffer();
+
+	for( auto _ : a_state )
+	{
+		RuleData cached;
+		BinaryReader reader( buffer.data(), buffer.size() );
+		reader( cached );
+		cached.CompilePatterns();
+
+		benchmark::DoNotOptimize( cached.hotRules.size() );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() * a_state.range( 0 ) );
+	a_state.SetBytesProcessed( a_state.iterations() * buffer.size() );
+}
+BENCHMARK( BM_RuleLoadCache )->ArgName( "rules" )->Arg( 100 )->Arg( 5000 )->Unit( benchmark::kMillisecond )->UseRealTime();
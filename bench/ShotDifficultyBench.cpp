@@ -0,0 +1,16 @@
+#include "Fixtures.h"
+
+static constexpr uint32_t kShotCount = 4096;
+
+static void BM_ShotDifficulty( benchmark::State& a_state )
+{
+	auto shots = Fixtures::MakeShots( kShotCount, 7 );
+	for( auto _ : a_state )
+	{
+		for( auto& shot : shots )
+			benchmark::DoNotOptimize( ShotDifficulty::Compute( shot, 1, 1, 1 ) );
+	}
+
+	a_state.SetItemsProcessed( a_state.iterations() * shots.size() );
+}
+BENCHMARK( BM_ShotDifficulty );
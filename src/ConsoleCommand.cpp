@@ -0,0 +1,173 @@
+#include "ConsoleCommand.h"
+#include "LocationalDamage.h"
+#include "Profiler.h"
+#include "Settings.h"
+#include "HitCapture.h"
+
+static constexpr auto kReplacedCommand = "TestSeenData"sv;
+
+static RE::SCRIPT_PARAMETER commandParams[] = {
+	{ "Command", RE::SCRIPT_PARAM_TYPE::kChar, true },
+};
+
+void ConsoleCommand::Install()
+{
+	auto command = RE::SCRIPT_FUNCTION::LocateConsoleCommand( kReplacedCommand );
+	if( !command )
+	{
+		logger::warn( "Console command {} not found, ald command is not available.", kReplacedCommand );
+		return;
+	}
+
+	command->functionName		= "ArcheryLocationalDamage";
+	command->shortName			= "ald";
+	command->helpString			= "Archery Locational Damage. Use 'ald help' for a list of commands.";
+	command->referenceFunction	= false;
+	command->numParams			= (uint16_t)std::size( commandParams );
+	command->params				= commandParams;
+	command->executeFunction	= &Execute;
+	command->conditionFunction	= nullptr;
+}
+
+void ConsoleCommand::PrintHelp()
+{
+	auto console = RE::ConsoleLog::GetSingleton();
+	console->Print( "ald reload - Reload ArcheryLocationalDamage.ini" );
+	console->Print( "ald stats [reset] - Print or reset hit pipeline latency (p50/p99/max)" );
+	console->Print( "ald trace start|stop - Record hook and stage spans, stop writes a Chrome trace to the log directory" );
+	console->Print( "ald rules [reset] - Write or reset per rule match/filter counters and cost (CSV in the log directory)" );
+	console->Print( "ald capture start|stop - Record every hit to a trace in the log directory for the offline replay tool" );
+}
+
+void ConsoleCommand::WriteRuleStats()
+{
+	auto console = RE::ConsoleLog::GetSingleton();
+
+#ifdef ALD_ENABLE_PROFILING
+	auto path = logger::log_directory();
+	auto ruleSet = Settings::GetRuleSet();
+	if( !path || !ruleSet )
+		return;
+
+	*path /= fmt::format( "{}_rules.csv"sv, Plugin::NAME );
+
+	std::vector<std::string> ruleIDs;
+	for( auto& location : ruleSet->locations )
+		ruleIDs.push_back( location.id );
+
+	if( Profiler::WriteRuleCSV( *path, ruleIDs ) )
+		console->Print( "Archery Locational Damage: %d rules written to %s", (int)ruleIDs.size(), path->string().c_str() );
+	else
+		console->Print( "Archery Locational Damage: Failed to write %s", path->string().c_str() );
+#else
+	console->Print( "Profiling is not enabled in this build (ALD_ENABLE_PROFILING)." );
+#endif
+}
+
+void ConsoleCommand::Trace( const std::string& a_action )
+{
+	auto console = RE::ConsoleLog::GetSingleton();
+
+#ifdef ALD_ENABLE_PROFILING
+	if( _stricmp( a_action.c_str(), "start" ) == 0 )
+	{
+		Profiler::StartTrace();
+		console->Print( "Archery Locational Damage: Tracing started." );
+	}
+	else if( _stricmp( a_action.c_str(), "stop" ) == 0 )
+	{
+		auto path = logger::log_directory();
+		if( !path )
+			return;
+
+		*path /= fmt::format( "{}_trace.json"sv, Plugin::NAME );
+
+		size_t spanCount;
+		if( Profiler::StopTrace( *path, spanCount ) )
+			console->Print( "Archery Locational Damage: %d spans written to %s", (int)spanCount, path->string().c_str() );
+		else
+			console->Print( "Archery Locational Damage: Failed to write %s", path->string().c_str() );
+	}
+	else
+		PrintHelp();
+#else
+	_CRT_UNUSED( a_action );
+	console->Print( "Profiling is not enabled in this build (ALD_ENABLE_PROFILING)." );
+#endif
+}
+
+void ConsoleCommand::Capture( const std::string& a_action )
+{
+	auto console = RE::ConsoleLog::GetSingleton();
+	if( _stricmp( a_action.c_str(), "start" ) == 0 )
+	{
+		if( HitCapture::Start() )
+			console->Print( "Archery Locational Damage: Capturing hits to %s", HitCapture::GetPath().string().c_str() );
+		else
+			console->Print( "Archery Locational Damage: Failed to open %s", HitCapture::GetPath().string().c_str() );
+	}
+	else if( _stricmp( a_action.c_str(), "stop" ) == 0 )
+	{
+		auto hitCount = HitCapture::Stop();
+		console->Print( "Archery Locational Damage: %d hits written to %s", (int)hitCount, HitCapture::GetPath().string().c_str() );
+	}
+	else
+		PrintHelp();
+}
+
+void ConsoleCommand::PrintStats()
+{
+	auto console = RE::ConsoleLog::GetSingleton();
+
+#ifdef ALD_ENABLE_PROFILING
+	console->Print( "%-24s %10s %10s %10s %10s", "Stage", "Count", "p50 (us)", "p99 (us)", "Max (us)" );
+	for( uint32_t i = 0; i < (uint32_t)Profiler::Stage::kTotal; ++i )
+	{
+		auto summary = Profiler::GetSummary( (Profiler::Stage)i );
+		console->Print( "%-24s %10llu %10.2f %10.2f %10.2f", Profiler::kStageNames[ i ], summary.count, summary.p50 / 1000.0, summary.p99 / 1000.0, summary.max / 1000.0 );
+	}
+#else
+	console->Print( "Profiling is not enabled in this build (ALD_ENABLE_PROFILING)." );
+#endif
+}
+
+bool ConsoleCommand::Execute( const RE::SCRIPT_PARAMETER*, RE::SCRIPT_FUNCTION::ScriptData*, RE::TESObjectREFR*, RE::TESObjectREFR*, RE::Script* a_scriptObj, RE::ScriptLocals*, double&, std::uint32_t& )
+{
+	if( !a_scriptObj )
+		return false;
+
+	// Full command line, first token is the command name itself
+	std::vector<std::string> args;
+	std::istringstream stream( a_scriptObj->GetCommand() );
+	for( std::string token; stream >> token; )
+		args.push_back( token );
+
+	auto subCommand = args.size() > 1 ? args[ 1 ] : "help"s;
+	if( _stricmp( subCommand.c_str(), "reload" ) == 0 )
+	{
+		RE::ConsoleLog::GetSingleton()->Print( "Archery Locational Damage: Reloading settings..." );
+		LocationalDamage::ReloadSettings();
+	}
+	else if( _stricmp( subCommand.c_str(), "stats" ) == 0 )
+	{
+		if( args.size() > 2 && _stricmp( args[ 2 ].c_str(), "reset" ) == 0 )
+			Profiler::Reset();
+		else
+			PrintStats();
+	}
+	else if( _stricmp( subCommand.c_str(), "rules" ) == 0 )
+	{
+		if( args.size() > 2 && _stricmp( args[ 2 ].c_str(), "reset" ) == 0 )
+			Profiler::ResetRules();
+		else
+			WriteRuleStats();
+	}
+	else if( _stricmp( subCommand.c_str(), "trace" ) == 0 )
+		Trace( args.size() > 2 ? args[ 2 ] : "" );
+	else if( _stricmp( subCommand.c_str(), "capture" ) == 0 )
+		Capture( args.size() > 2 ? args[ 2 ] : "" );
+	else
+		PrintHelp();
+
+	return true;
+}
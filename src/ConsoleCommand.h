@@ -0,0 +1,16 @@
+#pragma once
+
+// "ArcheryLocationalDamage <command>" console command (short name "ald").
+// Replaces an unused debug command of the game.
+struct ConsoleCommand
+{
+	static void Install();
+
+	static bool Execute( const RE::SCRIPT_PARAMETER* a_paramInfo, RE::SCRIPT_FUNCTION::ScriptData* a_scriptData, RE::TESObjectREFR* a_thisObj, RE::TESObjectREFR* a_containingObj, RE::Script* a_scriptObj, RE::ScriptLocals* a_locals, double& a_result, std::uint32_t& a_opcodeOffsetPtr );
+
+	static void PrintHelp();
+	static void PrintStats();
+	static void WriteRuleStats();
+	static void Trace( const std::string& a_action );
+	static void Capture( const std::string& a_action );
+};
@@ -0,0 +1,116 @@
+#include "Diagnostics.h"
+#include "Utils.h"
+
+// Category of every event
+static constexpr std::array<Diagnostics::Category, Diagnostics::kEventCount> eventCategories =
+{
+	Diagnostics::kHitNode,	// kArrowHits
+	Diagnostics::kHitNode,	// kEnemyHits
+	Diagnostics::kRule,		// kRuleTriggered
+	Diagnostics::kShot,		// kShotDifficulty
+	Diagnostics::kCheck,	// kFilterMismatch
+	Diagnostics::kCheck,	// kJITMismatch
+	Diagnostics::kCheck,	// kConditionMismatch
+	Diagnostics::kSpell,	// kSpellOnPlayer
+};
+
+// Records shown per second, a screen notification per hit floods the HUD queue long before the console
+static constexpr std::array<uint32_t, Diagnostics::kCategoryCount> categoryLimits = { 4, 20, 10, 5, 10 };
+
+static constexpr std::array<const char*, Diagnostics::kCategoryCount> categoryNames = { "hit node", "rule", "shot", "check", "spell" };
+
+static DiagnosticRing		ring( Diagnostics::kRingCapacity );
+static DiagnosticRateLimit	rateLimit;		// Main thread
+static std::atomic<bool>	isDrainScheduled = false;
+
+void Diagnostics::Push( Event a_event, uint32_t a_id, std::string_view a_text, std::initializer_list<float> a_values )
+{
+	DiagnosticRecord record;
+	record.category	= eventCategories[ a_event ];
+	record.event	= a_event;
+	record.id		= a_id;
+	record.SetText( a_text );
+	std::copy_n( a_values.begin(), std::min<size_t>( a_values.size(), DiagnosticRecord::kMaxValues ), record.values.begin() );
+
+	ring.Push( record );
+
+	// One task for everything pushed until it runs
+	if( !isDrainScheduled.exchange( true, std::memory_order_acq_rel ) )
+		SKSE::GetTaskInterface()->AddTask( []() { Drain(); } );
+}
+
+void Diagnostics::Drain()
+{
+	// Records pushed from now on schedule the next run
+	isDrainScheduled.store( false, std::memory_order_release );
+
+	static bool isLimitSet = false;
+	if( !isLimitSet )
+	{
+		isLimitSet = true;
+		for( uint16_t category = 0; category < kCategoryCount; ++category )
+			rateLimit.SetLimit( category, categoryLimits[ category ] );
+	}
+
+	auto now = std::chrono::duration<double>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+
+	DiagnosticRecord record;
+	while( ring.Pop( record ) )
+	{
+		if( rateLimit.IsAllowed( record.category, now ) )
+			Show( record );
+	}
+
+	for( uint16_t category = 0; category < kCategoryCount; ++category )
+	{
+		auto missed = ring.TakeDropped( category ) + rateLimit.TakeSuppressed( category, now );
+		if( missed > 0 )
+		{
+			RE::ConsoleLog::GetSingleton()->Print( "ALD: %llu %s diagnostics dropped", missed, categoryNames[ category ] );
+			logger::info( "{} {} diagnostics dropped", missed, categoryNames[ category ] );
+		}
+	}
+}
+
+void Diagnostics::Show( const DiagnosticRecord& a_record )
+{
+	auto console	= RE::ConsoleLog::GetSingleton();
+	auto& values	= a_record.values;
+
+	char buffer[ 128 ];
+	switch( a_record.event )
+	{
+	case kArrowHits:
+		RE::DebugNotification( FormatTo( buffer, "Arrow hits {}", a_record.GetText() ) );
+		break;
+
+	case kEnemyHits:
+		console->Print( "Enemy hits your '%s'", a_record.GetText() );
+		break;
+
+	case kRuleTriggered:
+		console->Print( "ALD: %s triggered", a_record.GetText() );
+		break;
+
+	case kShotDifficulty:
+		console->Print( "Time: %0.2f, Dist: %0.1f, CFactor: %0.2f, Spd: %0.1f, Height: %0.1f, Width: %0.1f, Diff: %0.4f",
+			values[ 0 ], values[ 1 ], values[ 2 ], values[ 3 ], values[ 4 ], values[ 5 ], values[ 6 ] );
+		break;
+
+	case kFilterMismatch:
+		console->Print( "ALD: compiled filter differs from EngineFilter::IsVaild" );
+		break;
+
+	case kJITMismatch:
+		logger::error( "Filter JIT and interpreter disagree at entry {}", a_record.id );
+		break;
+
+	case kConditionMismatch:
+		logger::error( "Native condition {} differs from the engine", a_record.GetText() );
+		break;
+
+	case kSpellOnPlayer:
+		console->Print( "Spell %s (%08X) casted on player", a_record.GetText(), a_record.id );
+		break;
+	}
+}
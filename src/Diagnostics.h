@@ -0,0 +1,45 @@
+#pragma once
+
+#include "core/DiagnosticRing.h"
+
+// Diagnostics of the hit path: hit nodes of '[Settings] DebugNotification' and the checks of debug builds.
+// The hit path pushes compact records without formatting or locking, from any thread. An SKSE task formats them on
+// the main thread with a rate limit per category, records over the limit or dropped by a full ring are counted and
+// reported on one line per category.
+struct Diagnostics
+{
+	enum Category : uint16_t
+	{
+		kHitNode,		// Node hit by or on the player
+		kRule,			// Triggered rules
+		kShot,			// Shot difficulty parameters
+		kCheck,			// Optimized path disagreeing with the engine
+		kSpell,			// Spells cast on the player
+
+		kCategoryCount
+	};
+
+	enum Event : uint16_t
+	{
+		kArrowHits,			// text: node
+		kEnemyHits,			// text: node
+		kRuleTriggered,		// id: rule, text: rule ID
+		kShotDifficulty,	// values: time, distance, cross factor, speed, height, width, difficulty
+		kFilterMismatch,
+		kJITMismatch,		// id: entry
+		kConditionMismatch,	// text: function
+		kSpellOnPlayer,		// id: form ID, text: name
+
+		kEventCount
+	};
+
+	static constexpr size_t kRingCapacity = 1024;
+
+	static void Push( Event a_event, uint32_t a_id = 0, std::string_view a_text = {}, std::initializer_list<float> a_values = {} );
+
+private:
+	// Main thread, scheduled by the first record pushed since the last run
+	static void Drain();
+
+	static void Show( const DiagnosticRecord& a_record );
+};
@@ -0,0 +1,39 @@
+#include "FilterMemoEvents.h"
+
+class FilterMemoEventSink :
+	public RE::BSTEventSink<RE::TESEquipEvent>,
+	public RE::BSTEventSink<RE::TESActiveEffectApplyRemoveEvent>
+{
+public:
+	static FilterMemoEventSink* GetSingleton()
+	{
+		static FilterMemoEventSink singleton;
+		return &singleton;
+	}
+
+	RE::BSEventNotifyControl ProcessEvent( const RE::TESEquipEvent* a_event, RE::BSTEventSource<RE::TESEquipEvent>* ) override
+	{
+		if( a_event && a_event->actor )
+			FilterMemo::Invalidate( a_event->actor->GetFormID() );
+
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+	RE::BSEventNotifyControl ProcessEvent( const RE::TESActiveEffectApplyRemoveEvent* a_event, RE::BSTEventSource<RE::TESActiveEffectApplyRemoveEvent>* ) override
+	{
+		if( a_event && a_event->target )
+			FilterMemo::Invalidate( a_event->target->GetFormID() );
+
+		return RE::BSEventNotifyControl::kContinue;
+	}
+};
+
+void FilterMemoEvents::Register()
+{
+	auto eventSource = RE::ScriptEventSourceHolder::GetSingleton();
+	if( !eventSource )
+		return;
+
+	eventSource->AddEventSink<RE::TESEquipEvent>( FilterMemoEventSink::GetSingleton() );
+	eventSource->AddEventSink<RE::TESActiveEffectApplyRemoveEvent>( FilterMemoEventSink::GetSingleton() );
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "core/FilterMemo.h"
+
+// Game events that change the filter outcome of an actor, they invalidate its FilterMemo entries
+struct FilterMemoEvents
+{
+	// Event sources are available once data is loaded
+	static void Register();
+};
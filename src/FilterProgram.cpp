@@ -0,0 +1,166 @@
+#include "FilterProgram.h"
+
+FilterFacts::FilterFacts( const FilterProgram& a_program, RE::Actor* a_actor, RE::Projectile* a_source ) :
+	program( a_program ), actor( a_actor ), source( a_source )
+{
+	fields.actor = a_actor;
+
+	if( a_actor )
+	{
+		auto race = a_actor->GetRace();
+		if( race )
+			fields.raceIndex = program.GetRaceIndex( race->GetFormID() );
+
+		auto base = a_actor->GetActorBase();
+		if( base )
+		{
+			auto targetSex = base->GetSex();
+			fields.sex		= targetSex == RE::SEX::kNone ? FilterFields::kNoSex : (uint8_t)targetSex;
+			fields.baseID	= base->GetRootFaceNPC()->GetFormID();
+			fields.hasBase	= true;
+		}
+	}
+
+	if( a_source && a_source->ammoSource )
+		fields.ammo = (uint8_t)( a_source->ammoSource->IsBolt() ? AmmoType::Bolt : AmmoType::Arrow );
+}
+
+bool FilterFacts::TestClause( uint32_t a_clause )
+{
+	if( a_clause >= kCachedClauses )
+		return EvaluateClause( program.clauses[ a_clause ] );
+
+	auto word	= a_clause / 64;
+	auto bit	= 1ull << ( a_clause % 64 );
+	if( !( clauseKnown[ word ] & bit ) )
+	{
+		clauseKnown[ word ] |= bit;
+		if( EvaluateClause( program.clauses[ a_clause ] ) )
+			clauseValue[ word ] |= bit;
+	}
+
+	return clauseValue[ word ] & bit;
+}
+
+// A clause is a StringFilter: every keyword of it must be on the same form
+bool FilterFacts::EvaluateClause( const StringFilter& a_clause )
+{
+	if( a_clause.type == StringFilter::Type::kWeaponKeyword )
+	{
+		auto weapon = source ? source->weaponSource : nullptr;
+		auto ammo	= source ? source->ammoSource : nullptr;
+		if( !weapon || !ammo )
+			return false;
+
+		return EngineFilter::FormHasKeywords( weapon, a_clause ) || EngineFilter::FormHasKeywords( ammo, a_clause );
+	}
+
+	if( !actor )
+		return false;
+
+	switch( a_clause.type )
+	{
+	case StringFilter::Type::kActorKeyword:
+		for( auto& keyword : a_clause.data )
+		{
+			bool hasKeyword = actor->HasKeywordString( keyword.str );
+			if( keyword.isNegate )
+				hasKeyword = !hasKeyword;
+
+			if( !hasKeyword )
+				return false;
+		}
+
+		return true;
+
+	case StringFilter::Type::kEquipKeyword:
+		if( !isWornArmorsKnown )
+		{
+			isWornArmorsKnown = true;
+
+			ForEachWornArmor( actor, [ this ]( RE::TESObjectARMO* a_armor )
+			{
+				wornArmors.push_back( a_armor );
+				return true;
+			});
+		}
+
+		for( auto armor : wornArmors )
+		{
+			if( EngineFilter::FormHasKeywords( armor, a_clause ) )
+				return true;
+		}
+
+		return false;
+
+	case StringFilter::Type::kMagicKeyword:
+		{
+			// Effect must active to count for keyword matching
+			auto activeEffects = actor->GetActiveEffectList();
+			for( auto activeEffect : *activeEffects )
+			{
+				if( activeEffect->flags.none( RE::ActiveEffect::Flag::kInactive ) &&
+					EngineFilter::FormHasKeywords( activeEffect->effect->baseEffect, a_clause ) )
+					return true;
+			}
+
+			return false;
+		}
+	}
+
+	return false;
+}
+
+std::shared_ptr<const FilterProgram> FilterProgram::Compile( Settings::RuleSet& a_ruleSet, const std::unordered_map<RE::FormID,std::string>& a_editorIDMap, bool a_useJIT )
+{
+	auto start = std::chrono::steady_clock::now();
+	auto program = std::make_shared<FilterProgram>();
+
+	// Editor IDs of the loaded forms, race index is the position in the race array
+	FilterCode::Forms forms;
+	auto dataHandler = RE::TESDataHandler::GetSingleton();
+	for( auto race : dataHandler->GetFormArray<RE::TESRace>() )
+		forms.races.emplace_back( race->GetFormID(), race->GetFormEditorID() );
+
+	for( auto npc : dataHandler->GetFormArray<RE::TESNPC>() )
+	{
+		auto iter = a_editorIDMap.find( npc->GetFormID() );
+		if( iter != a_editorIDMap.end() )
+			forms.npcs.emplace_back( npc->GetFormID(), iter->second );
+	}
+
+	program->FilterCode::Compile( a_ruleSet.locations, forms );
+
+	if( a_useJIT )
+	{
+		try
+		{
+			program->jit = FilterJIT::Create<FilterFacts>( *program );
+		}
+		catch( std::exception& e )
+		{
+			logger::warn( "Filter JIT failed ({}), using the interpreter", e.what() );
+		}
+	}
+
+	std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - start;
+	logger::info( "Filters compiled in {:0.1f} ms: {} instructions, {} keyword clauses, {} editor ID sets, JIT {}",
+		duration.count(), program->code.size(), program->clauses.size(), program->baseSets.size(), program->jit ? "enabled" : "disabled" );
+
+	return program;
+}
+
+bool FilterProgram::Run( uint32_t a_entry, FilterFacts& a_facts ) const
+{
+	if( !jit )
+		return Interpret( a_entry, a_facts );
+
+	bool result = jit->Run( a_entry, a_facts );
+
+#ifndef NDEBUG
+	if( result != Interpret( a_entry, a_facts ) )
+		Diagnostics::Push( Diagnostics::kJITMismatch, a_entry );
+#endif
+
+	return result;
+}
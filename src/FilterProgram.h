@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Utils.h"
+#include "Settings.h"
+#include "core/FilterCode.h"
+#include "core/FilterJIT.h"
+
+class FilterProgram;
+
+// Facts of one actor for one hit, gathered once and shared by every rule.
+// Keyword clauses need game lookups and are evaluated on first use.
+class FilterFacts
+{
+public:
+	static constexpr uint32_t	kCachedClauses = 256;	// Clauses past this index are evaluated every time
+
+	FilterFacts( const FilterProgram& a_program, RE::Actor* a_actor, RE::Projectile* a_source );
+
+	bool TestClause( uint32_t a_clause );
+
+	FilterFields	fields;
+
+private:
+	bool EvaluateClause( const StringFilter& a_clause );
+
+	const FilterProgram&							program;
+	RE::Actor*										actor;
+	RE::Projectile*									source;
+	std::array<uint64_t, kCachedClauses / 64>		clauseKnown{};
+	std::array<uint64_t, kCachedClauses / 64>		clauseValue{};
+	ArenaVector<RE::TESObjectARMO*>					wornArmors;		// From the arena of the HitFilters scope
+	bool											isWornArmorsKnown = false;
+};
+
+// FilterCode of the rule set over the loaded forms, with native code for every segment when '[Settings] FilterJIT' is set
+class FilterProgram : public FilterCode
+{
+public:
+	// Compile every filter of the rule set, forms must be loaded
+	static std::shared_ptr<const FilterProgram> Compile( Settings::RuleSet& a_ruleSet, const std::unordered_map<RE::FormID,std::string>& a_editorIDMap, bool a_useJIT );
+
+	bool Evaluate( const ActorFilter& a_filter, FilterFacts& a_facts ) const
+	{
+		return a_filter.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+		{
+			return Run( a_filter.programEntries[ a_predicate ], a_facts );
+		});
+	}
+
+	bool Run( uint32_t a_entry, FilterFacts& a_facts ) const;
+
+	bool IsJITEnabled() const { return jit != nullptr; }
+
+private:
+	std::unique_ptr<FilterJIT>	jit;
+};
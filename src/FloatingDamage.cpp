@@ -1,4 +1,5 @@
 #include "FloatingDamage.h"
+#include "Profiler.h"
 
 static RE::GMatrix3D* worldToCamMatrix;
 static bool initialized = false;
@@ -25,13 +26,13 @@ RE::GFxMovie* FloatingDamage::GetMenu()
 	return nullptr;
 }
 
-bool FloatingDamage::AddText( const char* a_text, uint32_t a_color, uint32_t a_size )
+bool FloatingDamage::AddText( const char* a_text, uint32_t a_color, uint32_t a_size, bool a_isBorrowed )
 {
 	auto menu = GetMenu();
 	if( menu == nullptr || worldToCamMatrix == nullptr )
 		return false;
 
-	data.push_back( { a_text, a_color, a_size } );
+	data.push_back( { a_text, a_color, a_size, a_isBorrowed } );
 
 	return true;
 }
@@ -67,7 +68,11 @@ void FloatingDamage::Draw( RE::TESObjectREFR* a_target, RE::NiPoint3* a_location
 	scale = min( max( 75, scale ), 150 );
 
 	// Floating damage UI invocation cannot be done simutaneously from multiple threads.
-	std::lock_guard<std::mutex> lock( mutex );
+	std::unique_lock<std::mutex> lock( mutex, std::defer_lock );
+	{
+		ALD_TRACE_SCOPE( "Wait FloatingDamage mutex" );
+		lock.lock();
+	}
 
 	RE::GFxValue args[ 8 ];
 	menu->CreateArray( &args[ 0 ] );
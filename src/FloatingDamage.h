@@ -12,18 +12,24 @@ class FloatingDamage
 
 		bool			ownString = false;
 
-		void _Init( const char* a_text, uint32_t a_color, uint32_t a_size )
+		void _Init( const char* a_text, uint32_t a_color, uint32_t a_size, bool a_isBorrowed = false )
 		{
 			if( ownString )
 				free( (void*)text.GetString() );
 
-			ownString = true;
+			ownString = !a_isBorrowed;
 
-			auto len = strlen( a_text );
-			char* buffer = (char*)malloc( len + 1 );
-			strcpy_s( buffer, len + 1, a_text );
+			if( a_isBorrowed )
+				text = a_text;
+			else
+			{
+				auto len = strlen( a_text );
+				char* buffer = (char*)malloc( len + 1 );
+				strcpy_s( buffer, len + 1, a_text );
+
+				text = buffer;
+			}
 
-			text = buffer;
 			color = a_color;
 			size = a_size;
 		}
@@ -45,9 +51,9 @@ class FloatingDamage
 			a_other.text.SetNull();
 		}
 
-		DisplayText( const char* a_text, uint32_t a_color, uint32_t a_size )
+		DisplayText( const char* a_text, uint32_t a_color, uint32_t a_size, bool a_isBorrowed )
 		{
-			_Init( a_text, a_color, a_size );
+			_Init( a_text, a_color, a_size, a_isBorrowed );
 		}
 
 		DisplayText( const DisplayText& a_other )
@@ -97,12 +103,16 @@ class FloatingDamage
 	std::vector<DisplayText> data;
 
 public:
-	bool AddText( const char* a_text, uint32_t a_color, uint32_t a_size );
+	// A borrowed text is not copied, it must outlive the Draw call: rule set strings and buffers of the caller
+	bool AddText( const char* a_text, uint32_t a_color, uint32_t a_size, bool a_isBorrowed = false );
 
 	void Draw( RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, float a_offsetX, float a_offsetY, float a_alpha = 100, bool a_ignoreLOS = false );
 
+	// Capacity is kept for the next hit
 	void Reset() { data.clear(); };
 
+	bool IsEmpty() const { return data.empty(); }
+
 	static void Initialize( REL::Version a_ver );
 
 	static RE::GFxMovie* GetMenu();
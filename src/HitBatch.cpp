@@ -0,0 +1,173 @@
+#include "HitBatch.h"
+#include "LocationalDamage.h"
+#include "Utils.h"
+#include "Profiler.h"
+#include "FilterProgram.h"
+#include "core/WorkPool.h"
+
+extern float g_fLastHitDamage;
+extern RE::BGSImpactData* g_ImpactOverride;
+
+// References that keep the objects of a queued hit, and the rule set it is decided by, alive until it is applied
+struct BatchedRefs
+{
+	std::shared_ptr<const Settings::RuleSet>	ruleSet;
+	RE::NiPointer<RE::TESObjectREFR>	projectile;
+	RE::NiPointer<RE::TESObjectREFR>	target;
+	RE::NiPointer<RE::TESObjectREFR>	shooter;
+	RE::NiPointer<RE::NiNode>			hitPart;
+};
+
+static std::mutex				queueMutex;
+static std::vector<BatchedHit>	queuedHits;
+static std::vector<BatchedRefs>	queuedRefs;
+
+// Owned by the flushing thread, reused from frame to frame
+static std::mutex				flushMutex;
+static std::vector<BatchedHit>	flushHits;
+static std::vector<BatchedRefs>	flushRefs;
+static std::vector<BatchScan>	flushScans;
+static std::unique_ptr<WorkPool>	pool;
+static long						poolThreads = 0;
+
+bool HitBatch::Add( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch )
+{
+	// Deflection and impact overrides only work while the impact is resolved
+	auto ruleSet = Settings::GetRuleSet();
+	if( !ruleSet || !ruleSet->options.batchedEvaluation || ruleSet->hasImpactRules )
+		return false;
+
+	// The workers run the compiled filters over snapshots, the engine filters need the game
+	auto program = ruleSet->filterProgram.get();
+	if( !program || !program->CanSnapshot() )
+		return false;
+
+	// Hits skipped by the prefilters are done with
+	RE::Actor* shooterActor = nullptr;
+	if( !LocationalDamage::IsProcessed( a_projectile, a_target, shooterActor ) )
+		return true;
+
+	// The skeleton is read now, it moves on before the batch runs
+	auto hitPart = LocationalDamage::FindHitPart( a_projectile, a_target, a_location, *ruleSet );
+	if( !hitPart )
+		return true;
+
+	// An overflow entry is rewritten by the next one of this thread, before the batch runs
+	auto& nodeMatch = ruleSet->MatchNode( hitPart->name.c_str() );
+	if( !nodeMatch.isStored )
+		return false;
+
+	// The perk condition of a continuing rule decides the damage seen by a later chance roll, the scan cannot know it
+	if( !nodeMatch.isBatchable )
+		return false;
+
+	BatchedHit hit;
+	hit.ruleSet			= ruleSet.get();
+	hit.projectile		= a_projectile;
+	hit.target			= (RE::Actor*)a_target;
+	hit.shooter			= shooterActor;
+	hit.hitPart			= hitPart;
+	hit.location		= *a_location;
+	hit.damage			= g_fLastHitDamage;
+	hit.shooterIsPlayer	= shooterActor && shooterActor->IsPlayerRef();
+	hit.targetIsPlayer	= a_target->IsPlayerRef();
+	hit.nodeMatch		= &nodeMatch;
+	hit.targetID		= a_target->GetFormID();
+	hit.shooterID		= shooterActor ? shooterActor->GetFormID() : 0;
+	hit.weaponID		= a_projectile->weaponSource ? a_projectile->weaponSource->GetFormID() : 0;
+	hit.ammoID			= a_projectile->ammoSource ? a_projectile->ammoSource->GetFormID() : 0;
+	hit.targetMaxHealth	= hit.target->GetBaseActorValue( RE::ActorValue::kHealth );
+
+	// Only the clauses of the rules that can trigger on this node are evaluated
+	FilterSnapshot::ClauseMask targetClauses{};
+	FilterSnapshot::ClauseMask shooterClauses{};
+	auto& hotRules = ruleSet->hotRules;
+	for( uint32_t ruleIndex = 0; ruleIndex < hotRules.size(); ++ruleIndex )
+	{
+		if( !nodeMatch.IsRuleMatched( ruleIndex ) )
+			continue;
+
+		auto& ruleTarget	= program->GetClauses( ruleIndex, true );
+		auto& ruleShooter	= program->GetClauses( ruleIndex, false );
+		for( size_t word = 0; word < targetClauses.size(); ++word )
+		{
+			targetClauses[ word ]	|= ruleTarget[ word ];
+			shooterClauses[ word ]	|= ruleShooter[ word ];
+		}
+	}
+
+	{
+		HitArena::Scope arenaScope;
+
+		FilterFacts targetFacts( *program, hit.target, a_projectile );
+		hit.targetFacts.Capture( targetFacts, targetClauses );
+
+		FilterFacts shooterFacts( *program, shooterActor, a_projectile );
+		hit.shooterFacts.Capture( shooterFacts, shooterClauses );
+	}
+
+	// Velocities and flight time belong to the impact, the workers only compute the difficulty
+	hit.hasShot = hit.shooterIsPlayer && ruleSet->options.enableDifficultyBonus;
+	if( hit.hasShot )
+		hit.shot = GetShotDifficultyParams( a_projectile, hit.target, a_launch, *a_location );
+
+	std::lock_guard<std::mutex> lock( queueMutex );
+
+	// Seeds are drawn in queue order so the rolls do not depend on how the batch is split
+	hit.seed = (uint32_t)rand();
+	queuedHits.push_back( hit );
+	queuedRefs.push_back( { std::move( ruleSet ), RE::NiPointer<RE::TESObjectREFR>( a_projectile ), RE::NiPointer<RE::TESObjectREFR>( a_target ), RE::NiPointer<RE::TESObjectREFR>( shooterActor ), RE::NiPointer<RE::NiNode>( hitPart ) } );
+
+	// First hit of the frame schedules the flush, HandleProjectileAttack flushes earlier when it comes first
+	if( pendingCount.fetch_add( 1, std::memory_order_acq_rel ) == 0 )
+		SKSE::GetTaskInterface()->AddTask( []() { Flush(); } );
+
+	return true;
+}
+
+void HitBatch::Flush()
+{
+	std::lock_guard<std::mutex> flushLock( flushMutex );
+	{
+		std::lock_guard<std::mutex> lock( queueMutex );
+		flushHits.swap( queuedHits );
+		flushRefs.swap( queuedRefs );
+		pendingCount.store( 0, std::memory_order_release );
+	}
+
+	if( flushHits.empty() )
+		return;
+
+	auto threads = flushHits.back().ruleSet->options.batchThreads;
+	if( !pool || poolThreads != threads )
+	{
+		pool.reset();
+		pool = std::make_unique<WorkPool>( threads > 0 ? (uint32_t)threads : 0 );
+		poolThreads = threads;
+	}
+
+	flushScans.resize( flushHits.size() );
+	{
+		ALD_PROFILE_SCOPE( kBatchScan );
+
+		pool->ParallelFor( flushHits.size(), []( size_t a_index, uint32_t )
+		{
+			LocationalDamage::ScanBatchedHit( flushHits[ a_index ], flushScans[ a_index ] );
+		});
+	}
+
+	{
+		ALD_PROFILE_SCOPE( kBatchApply );
+
+		// Applied in impact order, the impact override of a hit being handled is left as it was
+		auto impactOverride	= g_ImpactOverride;
+		auto apply			= LocationalDamage::applyBatchedVariant.load( std::memory_order_relaxed );
+		for( size_t i = 0; i < flushHits.size(); ++i )
+			apply( flushHits[ i ], flushScans[ i ] );
+
+		g_ImpactOverride = impactOverride;
+	}
+
+	flushHits.clear();
+	flushRefs.clear();
+}
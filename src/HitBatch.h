@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ProjectileTracker.h"
+#include "Settings.h"
+#include "core/ShotDifficulty.h"
+#include "core/FilterCode.h"
+
+// Impact of one hit as queued for the frame batch. Engine objects stay referenced by the batch until it is applied.
+// The workers never touch them: everything the scan reads from the game is captured by the impact hook.
+struct BatchedHit
+{
+	const Settings::RuleSet*			ruleSet = nullptr;		// Kept alive by the batch references
+	RE::Projectile*						projectile = nullptr;
+	RE::Actor*							target = nullptr;
+	RE::Actor*							shooter = nullptr;
+	RE::NiNode*							hitPart = nullptr;
+	RE::NiPoint3						location;
+	float								damage = 0;		// g_fLastHitDamage when the hit was queued
+	uint32_t							seed = 0;		// Success chance rolls, drawn in impact order
+	bool								shooterIsPlayer = false;
+	bool								targetIsPlayer = false;
+	bool								hasShot = false;
+	ShotDifficultyParams				shot;
+
+	// Snapshot of the scan input
+	const NodeMatchCache::Entry*		nodeMatch = nullptr;
+	RE::FormID							targetID = 0;
+	RE::FormID							shooterID = 0;		// 0 without shooter
+	RE::FormID							weaponID = 0;		// Forms of the projectile, 0 without
+	RE::FormID							ammoID = 0;
+	float								targetMaxHealth = 0;
+	FilterSnapshot						targetFacts;		// Clauses of the rules matching the hit node
+	FilterSnapshot						shooterFacts;
+};
+static_assert( std::is_trivially_copyable_v<BatchedHit> );
+
+// Outcome of the parallel phase for one hit: the rules to trigger, in rule order
+struct BatchScan
+{
+	struct Candidate
+	{
+		uint32_t	rule = 0;
+		bool		isConditionPending = false;		// Perk condition still to pass, evaluated when the hit is applied
+	};
+
+	std::vector<Candidate>	candidates;
+	float					shotDifficulty = 1;
+};
+
+// Hits of a frame are queued by the impact hook and decided together on a WorkPool ('[Settings] BatchedEvaluation').
+// Filters, chance rolls and shot difficulty run on the worker threads, the rules are triggered by the flushing thread
+// in impact order before the first hit of the batch reaches HandleProjectileAttack.
+struct HitBatch
+{
+	// Returns false when the hit is left to the inline pipeline: batching is off, the rules act on the impact itself
+	// or the hit cannot be captured (filters not compiled yet, too many keyword clauses, node match cache full)
+	static bool Add( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch );
+
+	// Decide and apply every queued hit, callers are serialized
+	static void Flush();
+
+	static bool IsEmpty() { return pendingCount.load( std::memory_order_acquire ) == 0; }
+
+private:
+	static inline std::atomic<uint32_t> pendingCount = 0;
+};
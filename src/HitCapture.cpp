@@ -0,0 +1,203 @@
+#include "HitCapture.h"
+#include "Utils.h"
+#include "Settings.h"
+#include "NativeCondition.h"
+#include "core/HitTrace.h"
+
+extern float g_fLastHitDamage;
+extern unsigned long long g_PerformanceFrequency;
+extern std::unordered_map<RE::FormID,std::string> formEditorIDMap;
+
+static std::mutex			captureMutex;
+static HitTraceWriter		traceWriter;
+static unsigned long long	captureStart = 0;
+
+std::filesystem::path HitCapture::GetPath()
+{
+	auto path = logger::log_directory();
+	if( !path )
+		return {};
+
+	*path /= fmt::format( "{}_hits.aldtrace"sv, Plugin::NAME );
+	return *path;
+}
+
+bool HitCapture::Start()
+{
+	std::lock_guard<std::mutex> lock( captureMutex );
+
+	auto path = GetPath();
+	if( path.empty() || !traceWriter.Open( path, Settings::ReadIni() ) )
+		return false;
+
+	QueryPerformanceCounter( (LARGE_INTEGER*)&captureStart );
+	isActive = true;
+
+	return true;
+}
+
+uint32_t HitCapture::Stop()
+{
+	std::lock_guard<std::mutex> lock( captureMutex );
+
+	isActive = false;
+	traceWriter.Close();
+
+	return traceWriter.GetCount();
+}
+
+void HitCapture::SnapshotKeywords( RE::BGSKeywordForm* a_form, std::vector<std::string>& a_keywords )
+{
+	if( !a_form )
+		return;
+
+	for( uint32_t i = 0; i < a_form->numKeywords; ++i )
+	{
+		auto keyword = a_form->keywords[ i ];
+		if( keyword )
+			a_keywords.emplace_back( keyword->formEditorID.c_str() );
+	}
+}
+
+// Depth first so the children of a node follow it, as SkeletonSnapshot expects
+void HitCapture::SnapshotSkeleton( RE::NiNode* a_node, int32_t a_parent, RE::NiNode* a_impactNode, HitRecord& a_record )
+{
+	auto index = (int32_t)a_record.skeleton.nodes.size();
+	auto& node = a_record.skeleton.nodes.emplace_back();
+	node.name			= a_node->name.c_str();
+	node.position		= ToPoint3( a_node->world.translate );
+	node.parent			= a_parent;
+	node.hasCollision	= NiNodeAdapter::HasCollision( a_node );
+
+	if( a_node == a_impactNode )
+		a_record.impactNode = index;
+
+	NiNodeAdapter::ForEachChild( a_node, [ & ]( RE::NiNode* a_child )
+	{
+		SnapshotSkeleton( a_child, index, a_impactNode, a_record );
+	});
+
+	a_record.skeleton.nodes[ index ].subtreeSize = (uint32_t)( a_record.skeleton.nodes.size() - index );
+}
+
+void HitCapture::SnapshotActor( RE::Actor* a_actor, ActorSnapshot& a_snapshot )
+{
+	auto race = a_actor->GetRace();
+	if( race )
+	{
+		a_snapshot.raceID		= race->GetFormID();
+		a_snapshot.raceEditorID	= race->GetFormEditorID();
+	}
+
+	auto base = a_actor->GetActorBase();
+	a_snapshot.hasBase = base != nullptr;
+	if( base )
+	{
+		a_snapshot.baseID	= base->GetRootFaceNPC()->GetFormID();
+		a_snapshot.sex		= (Sex)base->GetSex();
+		SnapshotKeywords( base, a_snapshot.keywords );
+
+		auto iter = formEditorIDMap.find( a_snapshot.baseID );
+		if( iter != formEditorIDMap.end() )
+			a_snapshot.baseEditorID = iter->second;
+	}
+
+	a_snapshot.health		= a_actor->GetActorValue( RE::ActorValue::kHealth );
+	a_snapshot.maxHealth	= a_actor->GetBaseActorValue( RE::ActorValue::kHealth );
+	a_snapshot.isPlayer		= a_actor->IsPlayerRef();
+
+	const auto inv = a_actor->GetInventory( []( RE::TESBoundObject& a_object ) { return a_object.IsArmor(); } );
+	for( const auto& [ item, invData ] : inv )
+	{
+		const auto& [ count, entry ] = invData;
+		auto armor = item->As<RE::TESObjectARMO>();
+		if( armor && count > 0 && entry->IsWorn() )
+			SnapshotKeywords( armor, a_snapshot.wornArmors.emplace_back() );
+	}
+
+	auto activeEffects = a_actor->GetActiveEffectList();
+	if( activeEffects )
+	{
+		for( auto activeEffect : *activeEffects )
+		{
+			if( !activeEffect || !activeEffect->effect || !activeEffect->effect->baseEffect )
+				continue;
+
+			auto& effect = a_snapshot.activeEffects.emplace_back();
+			effect.isInactive = activeEffect->flags.any( RE::ActiveEffect::Flag::kInactive );
+			SnapshotKeywords( activeEffect->effect->baseEffect, effect.keywords );
+		}
+	}
+}
+
+void HitCapture::Record( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch )
+{
+	if( !a_projectile || !a_target || a_target->IsDead() ||
+		a_projectile->formType != RE::FormType::ProjectileArrow ||
+		a_target->formType != RE::FormType::ActorCharacter ||
+		( a_projectile->flags & (1 << 17) ) )
+		return;
+
+	auto ruleSet = Settings::GetRuleSet();
+	auto root = a_target->Get3D() ? a_target->Get3D()->AsNode() : nullptr;
+	if( !ruleSet || !root )
+		return;
+
+	RE::Actor* shooterActor = nullptr;
+	auto shooter = a_projectile->shooter.get();
+	if( shooter )
+		shooterActor = shooter->As<RE::Actor>();
+
+	if( shooterActor && !shooterActor->CheckValidTarget( *a_target ) )
+		return;
+
+	auto targetActor = (RE::Actor*)a_target;
+
+	HitRecord record;
+	unsigned long long now;
+	QueryPerformanceCounter( (LARGE_INTEGER*)&now );
+	record.timestamp	= ( now - captureStart ) * 1000000 / g_PerformanceFrequency;
+	record.impact		= ToPoint3( *a_location );
+	record.damage		= g_fLastHitDamage;
+	record.hasShooter	= shooterActor != nullptr;
+
+	RE::NiNode* impactNode = a_projectile->impacts.empty() ? nullptr : ( *a_projectile->impacts.begin() )->damageRootNode;
+	SnapshotSkeleton( root, -1, impactNode, record );
+	SnapshotActor( targetActor, record.target );
+	if( shooterActor )
+		SnapshotActor( shooterActor, record.shooter );
+
+	auto& projectile = record.projectile;
+	projectile.hasSource = a_projectile->weaponSource && a_projectile->ammoSource;
+	if( projectile.hasSource )
+	{
+		projectile.ammo = a_projectile->ammoSource->IsBolt() ? AmmoType::Bolt : AmmoType::Arrow;
+		SnapshotKeywords( a_projectile->weaponSource, projectile.weaponKeywords );
+		SnapshotKeywords( a_projectile->ammoSource, projectile.ammoKeywords );
+	}
+
+	projectile.shot = GetShotDifficultyParams( a_projectile, targetActor, a_launch, *a_location );
+
+	// Conditions are stored as results. Conditions with GetRandomPercent would consume a roll and are left out, they pass on replay.
+	for( uint32_t ruleIndex = 0; ruleIndex < ruleSet->locations.size(); ++ruleIndex )
+	{
+		auto perkCondition = ruleSet->GetCondition( ruleIndex );
+		if( !perkCondition || ruleSet->locations[ ruleIndex ].isConditionPinned )
+			continue;
+
+		bool isTrue = perkCondition->nativeCondition ?
+			perkCondition->nativeCondition->IsTrue( shooterActor, targetActor ) :
+			perkCondition->condition->IsTrue( shooterActor, targetActor );
+
+		if( !isTrue )
+			record.failedConditions.push_back( ruleIndex );
+	}
+
+	std::lock_guard<std::mutex> lock( captureMutex );
+	if( isActive && !traceWriter.Write( record ) )
+	{
+		isActive = false;
+		traceWriter.Close();
+		logger::warn( "Failed to write hit trace, capture stopped" );
+	}
+}
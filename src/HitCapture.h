@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ProjectileTracker.h"
+#include "core/HitRecord.h"
+
+// Records the impacts seen by ApplyLocationalDamage to a hit trace ('ald capture start|stop').
+// The trace replays offline with tools/HitReplay.cpp, against the captured INI or another one.
+struct HitCapture
+{
+	// Trace goes to the log directory with the current INI text in its header
+	static bool Start();
+
+	// Returns the number of hits written
+	static uint32_t Stop();
+
+	static bool IsActive() { return isActive.load( std::memory_order_relaxed ); }
+
+	// Same arguments and prefilters as LocationalDamage::ApplyLocationalDamage, called just before it
+	static void Record( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch );
+
+	static std::filesystem::path GetPath();
+
+private:
+	static void SnapshotSkeleton( RE::NiNode* a_node, int32_t a_parent, RE::NiNode* a_impactNode, HitRecord& a_record );
+	static void SnapshotActor( RE::Actor* a_actor, ActorSnapshot& a_snapshot );
+	static void SnapshotKeywords( RE::BGSKeywordForm* a_form, std::vector<std::string>& a_keywords );
+
+	static inline std::atomic<bool> isActive = false;
+};
@@ -14,6 +14,9 @@ bool Hooks::Install( REL::Version a_ver )
 	if( !HandleProjectileAttackHook::Check( a_ver ) )	return false;
 
 	//GetImpactDataHook::Install( a_ver );
+	stl::write_vfunc<RE::ArrowProjectile, ProjectileUpdateHook>();
+	stl::write_vfunc<RE::FirstPersonState, FirstPersonBeginHook>();
+	stl::write_vfunc<RE::FirstPersonState, FirstPersonEndHook>();
 	DamageHook::Install( a_ver );
 	ProjectileGetImpackHookActor::Install( a_ver );
 	ProjectileImpactHook::Install( a_ver );
@@ -21,7 +24,6 @@ bool Hooks::Install( REL::Version a_ver )
 
 	//ProjectileImpactHook::ProjectileImpactPatch patchImpact( projectileImpactHookLoc.address() + 6 );
 	//stl::write_patch_branch<ProjectileImpactHook>( projectileImpactHookLoc.address(), patchImpact );
-	//stl::write_vfunc<RE::Projectile,ProjectileUpdateHook>();
 	//ProjectileUpdateHook::func = projectileVtbl.address() + sizeof(uintptr_t)*0xB6;
 	//projectileVtbl.write_vfunc( 0xB6, ProjectileUpdateHook::thunk );
 
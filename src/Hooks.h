@@ -2,12 +2,15 @@
 
 #include "Offsets.h"
 #include "LocationalDamage.h"
+#include "Profiler.h"
+#include "HitCapture.h"
+#include "PlayerSkeleton.h"
 
 extern float g_fLastHitDamage;
 extern float g_fDamageMult;
 
 extern RE::BGSImpactData* g_ImpactOverride;
-extern std::vector<HitDataOverride> g_HitDataOverride;
+extern HitOverrideList g_HitDataOverride;
 extern std::mutex g_handleProjectileAttackMutex;
 
 namespace Hooks
@@ -22,6 +25,8 @@ namespace Hooks
 	{
 		static uint64_t thunk( RE::Projectile* a_projectile, float a_delta )
 		{
+			ProjectileTracker::OnUpdate( a_projectile );
+
 			return func( a_projectile, a_delta );
 		}
 
@@ -29,6 +34,31 @@ namespace Hooks
 		static const size_t size = 0xB5;
 	};
 
+	// Camera state hooks select the player hit node candidates of the first or third person tree
+	struct FirstPersonBeginHook
+	{
+		static void thunk( RE::FirstPersonState* a_state )
+		{
+			func( a_state );
+			PlayerSkeleton::OnCameraState( PlayerSkeleton::kFirstPerson );
+		}
+
+		static inline REL::Relocation<decltype(thunk)> func;
+		static const size_t size = 0x1;
+	};
+
+	struct FirstPersonEndHook
+	{
+		static void thunk( RE::FirstPersonState* a_state )
+		{
+			func( a_state );
+			PlayerSkeleton::OnCameraState( PlayerSkeleton::kThirdPerson );
+		}
+
+		static inline REL::Relocation<decltype(thunk)> func;
+		static const size_t size = 0x2;
+	};
+
 	// For testing
 	struct GetImpactDataHook
 	{
@@ -63,28 +93,30 @@ namespace Hooks
 		// 36991+0xA3D SkyrimSE.exe+0x5EBBE0+0xA3D
 		static void* thunk( RE::Character* a_character, RE::HitData* a_hitData )
 		{
+			ALD_PROFILE_SCOPE( kHandleProjectileAttack );
+
+			// Hits of the frame batch need their overrides before any of them is handled
+			if( !HitBatch::IsEmpty() )
+				HitBatch::Flush();
+
 			auto aggressorPtr	= a_hitData->aggressor ? a_hitData->aggressor.get() : nullptr;
 			auto targetPtr		= a_hitData->target ? a_hitData->target.get() : nullptr;
 
 			auto aggressorRef	= aggressorPtr ? aggressorPtr->AsReference() : nullptr;
 			auto targetRef		= targetPtr ? targetPtr->AsReference() : nullptr;
 
-			std::lock_guard<std::mutex> lock( g_handleProjectileAttackMutex );
+			std::unique_lock<std::mutex> lock( g_handleProjectileAttackMutex, std::defer_lock );
+			{
+				ALD_TRACE_SCOPE( "Wait HandleProjectileAttack mutex" );
+				lock.lock();
+			}
 
 			// Find matching hit data
-			std::vector<HitDataOverride>::iterator iter;
-			for( iter = g_HitDataOverride.begin(); iter != g_HitDataOverride.end(); ++iter )
+			HitOverride hitOverride;
+			if( g_HitDataOverride.Take( aggressorRef, targetRef, ToPoint3( a_hitData->unk00 ), hitOverride ) )
 			{
-				if( iter->aggressor == aggressorRef &&
-					iter->target == targetRef &&
-					iter->location == a_hitData->unk00 )
-				{
-					g_ImpactOverride = iter->impactData;
-					a_hitData->totalDamage *= iter->damageMult;
-
-					g_HitDataOverride.erase( iter );
-					break;
-				}
+				g_ImpactOverride = static_cast<RE::BGSImpactData*>( hitOverride.impactData );
+				a_hitData->totalDamage *= hitOverride.damageMult;
 			}
 
 			// Impact override is consumed in this function
@@ -97,13 +129,7 @@ namespace Hooks
 			QueryPerformanceCounter( (LARGE_INTEGER*)&currentTimestamp );
 
 			// Cleanup hit data that does not get processed in time
-			for( iter = g_HitDataOverride.begin(); iter != g_HitDataOverride.end(); )
-			{
-				if( iter->expireTimestamp <= currentTimestamp )
-					iter = g_HitDataOverride.erase( iter );
-				else
-					++iter;
-			}
+			g_HitDataOverride.Expire( currentTimestamp );
 
 			return result;
 		}
@@ -135,6 +161,8 @@ namespace Hooks
 		// This function does sometime got skipped on projectile hit
 		static RE::BGSImpactData* thunk( RE::BGSImpactDataSet* a_dataset, RE::BGSMaterialType* a_material )
 		{
+			ALD_TRACE_SCOPE( "ProjectileGetImpackHookActor" );
+
 			if( g_ImpactOverride )
 				return g_ImpactOverride;
 
@@ -167,6 +195,12 @@ namespace Hooks
 	{
 		static bool thunk( RE::Projectile* a_projectile )
 		{
+			ALD_TRACE_SCOPE( "ProjectileImpactHook" );
+
+			// Reclaim the launch record on any impact
+			ProjectileTracker::Launch launch;
+			bool isTracked = ProjectileTracker::Release( a_projectile, launch );
+
 			// Use impact result directly
 			if( !a_projectile->impacts.empty() )
 			{
@@ -177,7 +211,12 @@ namespace Hooks
 					auto impactLocation = &impactData->desiredTargetLoc;
 
 					if( targetPtr )
-						LocationalDamage::ApplyLocationalDamage( a_projectile, targetPtr->AsReference(), impactLocation );
+					{
+						if( HitCapture::IsActive() )
+							HitCapture::Record( a_projectile, targetPtr->AsReference(), impactLocation, isTracked ? &launch : nullptr );
+
+						LocationalDamage::ApplyLocationalDamage( a_projectile, targetPtr->AsReference(), impactLocation, isTracked ? &launch : nullptr );
+					}
 				}
 			}
 
@@ -236,6 +275,8 @@ namespace Hooks
 
 		static void thunk( RE::HitData* a_hitData )
 		{
+			ALD_TRACE_SCOPE( "DamageHook" );
+
 			// Save damage for effect chance calculation
 			g_fLastHitDamage = a_hitData->totalDamage;
 		}
@@ -278,9 +319,7 @@ namespace Hooks
 		{
 			if( a_target && a_target->IsPlayerRef() )
 			{
-				auto name = a_spell->GetName();
-				auto formID = a_spell->formID;
-				RE::ConsoleLog::GetSingleton()->Print( fmt::format( "Spell {} ({:08X}) casted on player"sv, name, formID ).c_str() );
+				Diagnostics::Push( Diagnostics::kSpellOnPlayer, a_spell->formID, a_spell->GetName() );
 			}
 			auto ret = func( a_caster, a_spell, unk1_bool1, a_target, a_magOverride, unk2_bool2, unk3, a_blameTarget );
 			return ret;
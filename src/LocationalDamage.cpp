@@ -3,39 +3,22 @@
 #include "Hooks.h"
 #include "Settings.h"
 #include "FloatingDamage.h"
+#include "ConsoleCommand.h"
+#include "Profiler.h"
+#include "FilterProgram.h"
+#include "NativeCondition.h"
+#include "core/FilterMemo.h"
+#include "Diagnostics.h"
+#include "PlayerSkeleton.h"
+#include "HitBatch.h"
 
-extern std::vector<Settings::Location> g_LocationalDamageSettings;
-
-extern bool g_bDebugNotification;
-extern bool g_bPlayerNotification;
-extern bool g_bPlayerHitSound;
-extern bool g_bEffectChanceCap;
-extern bool g_bAmplifyEnchantment;
 extern bool g_bEnableFloatingText;
-extern bool g_bHitEffectNotification;
-extern bool g_bNPCFloatingNotification;
-extern bool g_bIgnoreHitboxCheck;
-extern bool g_bEnableDifficultyBonus;
-extern bool g_bEnableLocationMultiplier;
-extern float g_fShotDifficultyTimeFactor;
-extern float g_fShotDifficultyDistFactor;
-extern float g_fShotDifficultyMoveFactor;
-extern float g_fShotDifficultyMax;
-extern float g_fShotDifficultyReportMin;
 extern float g_fNormalMult;
 extern float g_fDamageMult;
-extern float g_fHPFactor;
 extern float g_fLastHitDamage;
-extern float g_fFloatingOffsetX;
-extern float g_fFloatingOffsetY;
-extern long g_nNotificationMode;
-extern long g_nEXPNotificationMode;
-extern std::regex g_sExcludeRegexp;
-extern std::regex g_PlayerNodes;
-
 float g_fLastHitDamage = 0;
 float g_fDamageMult = 1.0f;
-std::vector<HitDataOverride> g_HitDataOverride;
+HitOverrideList g_HitDataOverride;
 RE::BGSImpactData* g_ImpactOverride = NULL;
 unsigned long long g_PerformanceFrequency = 0;
 
@@ -55,318 +38,980 @@ void LocationalDamage::InitFormEditorIDMap()
 	logger::info( "Form editor ID loaded in {:0.2f} seconds", duration.count() );
 }
 
-void LocationalDamage::InitPerkConditions()
+static std::atomic<bool> isDataLoaded = false;
+static std::mutex reloadMutex;
+
+void LocationalDamage::ResolvePerkConditions( Settings::RuleSet& a_ruleSet )
 {
-	for( auto& location : g_LocationalDamageSettings )
+	a_ruleSet.conditions.assign( a_ruleSet.locations.size(), {} );
+	for( size_t i = 0; i < a_ruleSet.locations.size(); ++i )
 	{
+		auto& location = a_ruleSet.locations[ i ];
 		if( location.perkConditionCopy != "" )
 		{
 			auto perk = RE::TESForm::LookupByEditorID<RE::BGSPerk>( location.perkConditionCopy );
 			if( perk )
-				location.condition = &perk->perkConditions;
+			{
+				auto& perkCondition = a_ruleSet.conditions[ i ];
+				perkCondition.condition = &perk->perkConditions;
+
+				for( auto item = perkCondition.condition->head; item; item = item->next )
+				{
+					if( item->data.functionData.function.get() == RE::FUNCTION_DATA::FunctionID::kGetRandomPercent )
+						location.isConditionPinned = true;
+				}
+
+				perkCondition.nativeCondition = NativeCondition::Compile( *perkCondition.condition );
+				if( perkCondition.nativeCondition )
+				{
+					std::string interpreted;
+					for( auto& item : perkCondition.nativeCondition->GetItems() )
+					{
+						if( !item.isNative )
+							interpreted += fmt::format( "{}{}", interpreted.empty() ? "" : ", ", NativeCondition::GetFunctionName( item.function ) );
+					}
+
+					logger::info( "{}: {} of {} condition items compiled from perk {}{}{}", location.id,
+						perkCondition.nativeCondition->GetNativeCount(), perkCondition.nativeCondition->GetItems().size(), location.perkConditionCopy,
+						interpreted.empty() ? "" : ", interpreted: ", interpreted );
+				}
+				else
+					logger::info( "{}: condition of perk {} uses GetRandomPercent and is evaluated by the engine", location.id, location.perkConditionCopy );
+			}
 			else
 				RE::ConsoleLog::GetSingleton()->Print( "Archery Locational Damage: Cannot find perk '%s' to copy condition from.", location.perkConditionCopy.c_str() );
 		}
 	}
 }
 
-void LocationalDamage::ApplyLocationalDamage( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location )
+void LocationalDamage::CompileFilters( Settings::RuleSet& a_ruleSet )
+{
+	a_ruleSet.filterProgram = FilterProgram::Compile( a_ruleSet, formEditorIDMap, a_ruleSet.options.filterJIT );
+}
+
+void LocationalDamage::InitPerkConditions()
+{
+	std::lock_guard<std::mutex> lock( reloadMutex );
+
+	auto ruleSet = std::make_unique<Settings::RuleSet>( *Settings::GetRuleSet() );
+	ResolvePerkConditions( *ruleSet );
+	CompileFilters( *ruleSet );
+	Settings::Publish( std::move( ruleSet ) );
+
+	isDataLoaded = true;
+}
+
+void LocationalDamage::ReloadSettings()
 {
-	if( a_projectile && a_target && !a_target->IsDead() &&
-		a_projectile->formType == RE::FormType::ProjectileArrow &&
-		a_target->formType == RE::FormType::ActorCharacter )
+	std::thread( []()
 	{
-		// Skip if projectile has no life remaining (eg. during VATS hitscan)
-		// Not really accurate because this member variable seems to be the projectile's lifetime instead of remaining life.
-		// lifeRemaining can be zero when shot at point-blank range.
-		/*if( a_projectile->lifeRemaining == 0 )
-			return;*/
-
-		// VATS hitscan set bit 17 to 1
-		if( a_projectile->flags & (1 << 17) )
-			return;
+		std::lock_guard<std::mutex> lock( reloadMutex );
 
-		RE::Actor* shooterActor = nullptr;
-		auto shooter = a_projectile->shooter.get();
-		if( shooter )
-			shooterActor = shooter->As<RE::Actor>();
+		auto start = std::chrono::steady_clock::now();
+		std::unique_ptr<Settings::RuleSet> ruleSet;
+		try
+		{
+			ruleSet = Settings::Build();
+			if( isDataLoaded )
+			{
+				ResolvePerkConditions( *ruleSet );
+				CompileFilters( *ruleSet );
+			}
+		}
+		catch( std::exception& e )
+		{
+			// A typo in the INI must not end the game, the current rules stay in place
+			logger::error( "Settings reload failed, keeping the current rules: {}", e.what() );
 
-		// Skip if the target is not vaild
-		if( shooterActor && !shooterActor->CheckValidTarget( *a_target ) )
+			std::string error = e.what();
+			SKSE::GetTaskInterface()->AddTask( [ error ]()
+			{
+				RE::ConsoleLog::GetSingleton()->Print( "Archery Locational Damage: Reload failed, keeping the current rules. %s", error.c_str() );
+			});
 			return;
+		}
 
-		RE::NiNode* hitPart = nullptr;
-		RE::Projectile::ImpactData* impactData = nullptr;
+		auto locationCount = ruleSet->locations.size();
+		Settings::Publish( std::move( ruleSet ) );
+		SelectVariant( *Settings::GetRuleSet() );
 
-		// Use impact result directly
-		if( !a_projectile->impacts.empty() )
+		// Rule counters are indexed by position, they no longer apply to the new rules
+		Profiler::ResetRules();
+
+		std::chrono::duration<float, std::milli> duration = std::chrono::steady_clock::now() - start;
+		logger::info( "Settings reloaded in {:0.1f} ms ({} locations)", duration.count(), locationCount );
+
+		SKSE::GetTaskInterface()->AddTask( [ locationCount, duration ]()
 		{
-			impactData = *a_projectile->impacts.begin();
-			hitPart = impactData->damageRootNode;
-		}
+			RE::ConsoleLog::GetSingleton()->Print( "Archery Locational Damage: Reloaded %d locations in %0.1f ms.", (int)locationCount, duration.count() );
+		});
+	}).detach();
+}
+
+void LocationalDamage::SelectVariant( const Settings::RuleSet& a_ruleSet )
+{
+	auto& options = a_ruleSet.options;
+
+	uint32_t features = 0;
+	if( options.notificationMode != NotificationMode::None )
+		features |= kHitNotification;
+	if( options.amplifyEnchantment )
+		features |= kAmplifyEnchantment;
+	if( options.enableDifficultyBonus || options.enableLocationMultiplier )
+		features |= kExperience;
+	if( options.debugNotification )
+		features |= kDebugNotification;
 
-		// Search manually if no impact data
-		if( !hitPart || g_bIgnoreHitboxCheck )
+	applyVariant		= kVariants[ features ];
+	applyBatchedVariant	= kBatchedVariants[ features ];
+	logger::info( "ApplyLocationalDamage variant {:#x}", features );
+}
+
+void LocationalDamage::ApplyLocationalDamage( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch )
+{
+	// Queued hits are decided with the rest of the frame
+	if( HitBatch::Add( a_projectile, a_target, a_location, a_launch ) )
+		return;
+
+	applyVariant.load( std::memory_order_relaxed )( a_projectile, a_target, a_location, a_launch );
+}
+
+bool LocationalDamage::IsProcessed( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::Actor*& a_shooter )
+{
+	if( !a_projectile || !a_target || a_target->IsDead() ||
+		a_projectile->formType != RE::FormType::ProjectileArrow ||
+		a_target->formType != RE::FormType::ActorCharacter )
+		return false;
+
+	// Skip if projectile has no life remaining (eg. during VATS hitscan)
+	// Not really accurate because this member variable seems to be the projectile's lifetime instead of remaining life.
+	// lifeRemaining can be zero when shot at point-blank range.
+	/*if( a_projectile->lifeRemaining == 0 )
+		return false;*/
+
+	// VATS hitscan set bit 17 to 1
+	if( a_projectile->flags & (1 << 17) )
+		return false;
+
+	a_shooter = nullptr;
+	auto shooter = a_projectile->shooter.get();
+	if( shooter )
+		a_shooter = shooter->As<RE::Actor>();
+
+	// Skip if the target is not vaild
+	return !a_shooter || a_shooter->CheckValidTarget( *a_target );
+}
+
+RE::NiNode* LocationalDamage::FindHitPart( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const Settings::RuleSet& a_ruleSet )
+{
+	RE::NiNode* hitPart = nullptr;
+
+	// Use impact result directly
+	if( !a_projectile->impacts.empty() )
+		hitPart = ( *a_projectile->impacts.begin() )->damageRootNode;
+
+	// Search manually if no impact data
+	if( !hitPart || a_ruleSet.options.ignoreHitboxCheck )
+	{
+		ALD_PROFILE_SCOPE( kHitNode );
+
+		float hitDist;
+		auto root = a_target->Get3D()->AsNode();
+		if( a_target->IsPlayerRef() )
+			hitPart = PlayerSkeleton::FindClosestHitNode( root, *a_location, hitDist, a_ruleSet );
+		else
+			hitPart = FindClosestHitNode( root, a_location, hitDist, false, a_ruleSet, a_ruleSet.options.ignoreHitboxCheck );
+	}
+
+	// Shield node has a strange name, need to check parent
+	if( hitPart && hitPart->parent && hitPart->parent->name == "SHIELD" )
+		hitPart = hitPart->parent;
+
+	return hitPart;
+}
+
+// Filters of one hit: the compiled program with actor facts shared by every rule, EngineFilter until forms are loaded
+class HitFilters
+{
+public:
+	static constexpr bool kDefersConditions = false;
+
+	HitFilters( const Settings::RuleSet& a_ruleSet, RE::Actor* a_target, RE::Actor* a_shooter, RE::Projectile* a_projectile ) :
+		target( a_target ), shooter( a_shooter ), projectile( a_projectile ),
+		targetID( a_target->GetFormID() ), shooterID( a_shooter ? a_shooter->GetFormID() : 0 ),
+		weaponID( a_projectile->weaponSource ? a_projectile->weaponSource->GetFormID() : 0 ),
+		ammoID( a_projectile->ammoSource ? a_projectile->ammoSource->GetFormID() : 0 ), program( a_ruleSet.filterProgram.get() )
+	{
+		if( program )
 		{
-			float hitDist;
-			hitPart = FindClosestHitNode( a_target->Get3D()->AsNode(), a_location, hitDist, a_target->IsPlayerRef(), g_bIgnoreHitboxCheck );
+			targetFacts.emplace( *program, a_target, a_projectile );
+			shooterFacts.emplace( *program, a_shooter, a_projectile );
 		}
-		
-		if( hitPart )
-		{
-			FloatingDamage floatingText;
-			HitDataOverride hitDataOverride;
-			auto targetActor		= (RE::Actor*)a_target;
-			bool locationHit		= false;
-			bool shooterIsPlayer	= shooterActor && shooterActor->IsPlayerRef();
-			bool targetIsPlayer		= targetActor->IsPlayerRef();
-			float difficulty		= 1;
-
-			// Shield node has a strange name, need to check parent
-			if( hitPart->parent && hitPart->parent->name == "SHIELD" )
-				hitPart = hitPart->parent;
-
-			for( auto& locationalSetting : g_LocationalDamageSettings )
-			{
-				if( locationalSetting.enable &&
-					std::regex_match( hitPart->name.c_str(), locationalSetting.regexp ) )
-				{
-					// Success chance check
-					int finalSuccessChance = locationalSetting.successChance;
+	}
 
-					// Compute HP factor
-					if( locationalSetting.successHPFactor != 0 )
-					{
-						float successHPFactor = GetHPFactor( targetActor, locationalSetting.successHPFactor, g_fLastHitDamage, locationalSetting.successHPFactorCap );
-						finalSuccessChance = (int)(locationalSetting.successChance * successHPFactor);
-					}
-					
-					if( RandomPercent( finalSuccessChance ) &&
-						locationalSetting.targetFilter.IsVaild( targetActor, a_projectile, &formEditorIDMap ) &&
-						locationalSetting.shooterFilter.IsVaild( shooterActor, a_projectile, &formEditorIDMap ) &&
-						( locationalSetting.condition == nullptr || locationalSetting.condition->IsTrue( shooterActor, targetActor ) ) )
-					{
+	bool IsPassed( const ActorFilter& a_filter, bool a_isTarget )
+	{
+		auto actor = a_isTarget ? target : shooter;
+		if( !program )
+			return EngineFilter::IsVaild( a_filter, actor, projectile, &formEditorIDMap );
+
+		bool result = program->Evaluate( a_filter, a_isTarget ? *targetFacts : *shooterFacts );
 #ifndef NDEBUG
-						RE::ConsoleLog::GetSingleton()->Print( "ALD: %s triggered", locationalSetting.id.c_str() );
+		if( result != EngineFilter::IsVaild( a_filter, actor, projectile, &formEditorIDMap ) )
+			Diagnostics::Push( Diagnostics::kFilterMismatch );
 #endif
-						hitDataOverride.aggressor	= shooterActor;
-						hitDataOverride.target		= a_target;
-						hitDataOverride.location	= *a_location;
-						hitDataOverride.damageMult	*= locationalSetting.damageMult;
-
-						difficulty = max( difficulty, locationalSetting.difficulty );
-
-						// Set expiration time to prevent build up of unprocessed hits (1/10 sec)
-						QueryPerformanceCounter( (LARGE_INTEGER*)&hitDataOverride.expireTimestamp );
-						hitDataOverride.expireTimestamp += g_PerformanceFrequency / 10;
-
-						locationHit = true;
-						g_fDamageMult = locationalSetting.damageMult;
-						g_fLastHitDamage *= g_fDamageMult;
-
-						auto missileProjectile = a_projectile->As<RE::MissileProjectile>();
-						if( missileProjectile && locationalSetting.deflectProjectile )
-						{
-							if( missileProjectile->impactResult == RE::ImpactResult::kStick )
-							{
-								missileProjectile->impactResult = RE::ImpactResult::kBounce;
-
-								if( impactData )
-									impactData->impactResult = RE::ImpactResult::kBounce;
-							}
-						}
-
-						if( locationalSetting.impactData.size() > 0 )
-						{
-							auto impactOverride = RE::TESForm::LookupByEditorID( locationalSetting.impactData );
-							if( impactOverride )
-							{
-								g_ImpactOverride = impactOverride->As<RE::BGSImpactData>();
-								hitDataOverride.impactData = g_ImpactOverride;
-							}
-						}
-
-						auto message			= &locationalSetting.message;
-						auto messageFloating	= &locationalSetting.messageFloating;
-
-						if( shooterActor )
-						{
-							// Amplify the power of any effects applied by the impact.(Enchantments and Perks)
-							if( g_bAmplifyEnchantment )
-								AmplifyActiveEffect( targetActor, shooterActor, locationalSetting.damageMult );
-
-							// Only player sound when the player is involved
-							if( ( shooterIsPlayer || targetIsPlayer ) && locationalSetting.sound.size() > 0 )
-							{
-								if( shooterIsPlayer || g_bPlayerHitSound )
-									RE::PlaySound( locationalSetting.sound.c_str() );
-							}
-
-							// Notification display
-							if( shooterIsPlayer || targetIsPlayer || g_bNPCFloatingNotification )
-							{
-								if( message->size() > 0 || messageFloating->size() > 0 )
-								{
-									// Use normal message for floating text if floating message is not defined
-									if( messageFloating->size() == 0 )
-										messageFloating = message;
-
-									bool shouldShowNotification = g_nNotificationMode == NotificationMode::Both || g_nNotificationMode == NotificationMode::Screen;
-
-									if( g_nNotificationMode == NotificationMode::Both || g_nNotificationMode == NotificationMode::Floating )
-									{
-										if( ( targetIsPlayer && g_bPlayerNotification ) ||								// Floating notification for player
-											( !targetIsPlayer && !shooterIsPlayer && g_bNPCFloatingNotification ) ||	// Floating notification for NPC
-											shooterIsPlayer )
-										{
-											// Switch to screen notification if failed
-											if( !floatingText.AddText( 
-												messageFloating->c_str(), 
-												targetIsPlayer ? locationalSetting.floatingColorSelf : locationalSetting.floatingColorEnemy, 
-												locationalSetting.floatingSize ) )
-												shouldShowNotification = true;
-										}
-									}
-
-									// On screen notification is reserved for player only
-									if( shouldShowNotification && message->size() > 0 )
-									{
-										if( targetIsPlayer && g_bPlayerNotification )
-											RE::DebugNotification( fmt::format( "{} by {}"sv, message->c_str(), shooterActor->GetDisplayFullName() ).c_str() );
-										else if( shooterIsPlayer )
-											RE::DebugNotification( message->c_str(), NULL, false );
-									}
-								}
-							}
-						}
-
-						for( auto& effect : locationalSetting.effects )
-						{
-							auto hpFactor		= GetHPFactor( targetActor, g_fHPFactor, g_fLastHitDamage, g_bEffectChanceCap );
-							int finalChance		= (int)(effect.effectChance * hpFactor);
-
-							if( effect.effectID.length() > 0 && RandomPercent( finalChance ) )
-							{
-								auto magicItem = RE::TESForm::LookupByEditorID<RE::MagicItem>( effect.effectID );
-								if( magicItem && (
-									magicItem->formType == RE::FormType::Spell ||
-									magicItem->formType == RE::FormType::Enchantment ||
-									magicItem->formType == RE::FormType::AlchemyItem ) )
-								{
-									auto castingSource = RE::MagicSystem::CastingSource::kInstant;
-
-									// Cast from target if all effects are PVM type to prevent PVM stacking bug from multiple sources
-									bool shouldCastAtTarget = true;
-									for( auto iter = magicItem->effects.begin(); iter != magicItem->effects.end(); ++iter )
-									{
-										if( (*iter)->baseEffect->GetArchetype() != RE::EffectSetting::Archetype::kPeakValueModifier )
-										{
-											shouldCastAtTarget = false;
-											break;
-										}
-									}
-
-									// Cast at target when it should or when the firing actor does not exist.(Fired from an activator)
-									if( shouldCastAtTarget || !shooterActor )
-										a_target->GetMagicCaster( castingSource )->CastSpellImmediate( magicItem, false, a_target, 1.0f, false, 0, NULL );
-									else
-										shooterActor->GetMagicCaster( castingSource )->CastSpellImmediate( magicItem, false, a_target, 1.0f, false, 0, NULL );
-
-									if( g_bHitEffectNotification )
-									{
-										if( (targetIsPlayer || shooterIsPlayer) ||
-											g_bNPCFloatingNotification )
-											floatingText.AddText( 
-												magicItem->GetName(), 
-												targetIsPlayer ? locationalSetting.floatingColorSelf : locationalSetting.floatingColorEnemy, 
-												locationalSetting.floatingSize );
-									}
-								}
-							}
-						}
-
-						// Stop processing further locations if not required to do so.
-						if( !locationalSetting.shouldContinue )
-							break;
-					}
-				}
+		return result;
+	}
+
+	RE::Actor*			target;
+	RE::Actor*			shooter;
+	RE::Projectile*		projectile;
+	RE::FormID			targetID;
+	RE::FormID			shooterID;
+	RE::FormID			weaponID;
+	RE::FormID			ammoID;
+
+private:
+	HitArena::Scope				arenaScope;		// Facts allocate from the thread arena, released with the filters
+	const FilterProgram*		program;
+	std::optional<FilterFacts>	targetFacts;
+	std::optional<FilterFacts>	shooterFacts;
+};
+
+// Filters of a batched hit on a worker thread: the filter code over the snapshots captured by the impact hook.
+// Perk conditions run engine functions, they are left to the thread that applies the hit.
+class BatchedFilters
+{
+public:
+	static constexpr bool kDefersConditions = true;
+
+	explicit BatchedFilters( const BatchedHit& a_hit ) :
+		targetID( a_hit.targetID ), shooterID( a_hit.shooterID ), weaponID( a_hit.weaponID ), ammoID( a_hit.ammoID ),
+		hit( a_hit ), program( *a_hit.ruleSet->filterProgram ) {}
+
+	bool IsPassed( const ActorFilter& a_filter, bool a_isTarget ) const
+	{
+		auto& facts = a_isTarget ? hit.targetFacts : hit.shooterFacts;
+		return a_filter.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+		{
+			return program.Interpret( a_filter.programEntries[ a_predicate ], facts );
+		});
+	}
+
+	RE::FormID			targetID;
+	RE::FormID			shooterID;
+	RE::FormID			weaponID;
+	RE::FormID			ammoID;
+
+private:
+	const BatchedHit&		hit;
+	const FilterCode&		program;
+};
+
+static bool IsConditionTrue( const Settings::PerkCondition& a_condition, RE::Actor* a_shooter, RE::Actor* a_target )
+{
+	ALD_PROFILE_SCOPE( kPerkCondition );
+
+	return a_condition.nativeCondition ?
+		a_condition.nativeCondition->IsTrue( a_shooter, a_target ) :
+		a_condition.condition->IsTrue( a_shooter, a_target );
+}
+
+// Filters and perk condition of a rule whose location matched and whose chance passed, through the filter memo.
+// Filters that defer conditions leave the perk condition to the caller: a_isConditionPending is set when it still has to pass.
+template <class Filters>
+static bool IsRulePassed( const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex, Filters& a_filters, Profiler::RuleScope& a_ruleProfile, bool* a_isConditionPending = nullptr )
+{
+	auto& locationalSetting = a_ruleSet.locations[ a_ruleIndex ];
+	auto perkCondition = a_ruleSet.GetCondition( a_ruleIndex );
+
+	auto evaluatePredicate = [ & ]( uint32_t a_predicate )
+	{
+		bool isPredicatePassed = true;
+		switch( a_predicate )
+		{
+		case Settings::Location::kTargetFilter:
+			{
+				ALD_PROFILE_SCOPE( kFilter );
+				isPredicatePassed = a_filters.IsPassed( locationalSetting.targetFilter, true );
+				a_ruleProfile.Count( isPredicatePassed ? Profiler::RuleCounter::kTargetPassed : Profiler::RuleCounter::kTargetFailed );
 			}
+			break;
 
-			float expMult = 1;
-			if( hitDataOverride.aggressor )
+		case Settings::Location::kShooterFilter:
 			{
-				g_HitDataOverride.push_back( hitDataOverride );
+				ALD_PROFILE_SCOPE( kFilter );
+				isPredicatePassed = a_filters.IsPassed( locationalSetting.shooterFilter, false );
+				a_ruleProfile.Count( isPredicatePassed ? Profiler::RuleCounter::kShooterPassed : Profiler::RuleCounter::kShooterFailed );
+			}
+			break;
 
-				if( shooterIsPlayer )
-				{
-					// Reward additional EXP if enabled
-					if( g_bEnableLocationMultiplier && difficulty > 1 )
-						expMult += difficulty - 1;
-				}
+		case Settings::Location::kCondition:
+			if constexpr( Filters::kDefersConditions )
+			{
+				if( perkCondition )
+					*a_isConditionPending = true;
+			}
+			else if( perkCondition )
+			{
+				isPredicatePassed = IsConditionTrue( *perkCondition, a_filters.shooter, a_filters.target );
+				a_ruleProfile.Count( isPredicatePassed ? Profiler::RuleCounter::kConditionPassed : Profiler::RuleCounter::kConditionFailed );
 			}
+			break;
+		}
+
+		return isPredicatePassed;
+	};
+
+	// Filters are deterministic, the condition too when all its items are stable. Only that part is cached.
+	uint32_t memoMask = ( 1 << Settings::Location::kTargetFilter ) | ( 1 << Settings::Location::kShooterFilter );
+	if( !perkCondition || ( perkCondition->nativeCondition && perkCondition->nativeCondition->IsStable() ) )
+		memoMask |= 1 << Settings::Location::kCondition;
+
+	// Ammo type and weapon keyword clauses read the projectile, its forms are part of the key
+	auto memoMs		= a_ruleSet.options.filterMemoMs;
+	FilterMemo::Key memoKey{ a_ruleSet.generation, a_ruleIndex, a_filters.shooterID, a_filters.targetID, a_filters.weaponID, a_filters.ammoID };
+	auto memo		= memoMs > 0 ? FilterMemo::Find( memoKey ) : FilterMemo::Result::kUnknown;
+	if( memo != FilterMemo::Result::kUnknown )
+	{
+		a_ruleProfile.Count( Profiler::RuleCounter::kMemoHit );
+
+		return memo == FilterMemo::Result::kPassed &&
+			( ( memoMask & ( 1 << Settings::Location::kCondition ) ) || evaluatePredicate( Settings::Location::kCondition ) );
+	}
+
+	uint32_t evaluatedMask	= 0;
+	uint32_t failedMask		= 0;
+	bool isPassed = locationalSetting.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+	{
+		bool isPredicatePassed = evaluatePredicate( a_predicate );
+
+		// A condition left to the caller is not known yet
+		if( a_predicate != Settings::Location::kCondition || !Filters::kDefersConditions || !*a_isConditionPending )
+			evaluatedMask |= 1 << a_predicate;
+
+		if( !isPredicatePassed )
+			failedMask |= 1 << a_predicate;
+
+		return isPredicatePassed;
+	}, locationalSetting.isConditionPinned ? 1 << Settings::Location::kCondition : 0 );
+
+	// Cache only an outcome decided by the deterministic predicates
+	if( memoMs <= 0 )
+		return isPassed;
+
+	if( failedMask & memoMask )
+		FilterMemo::Store( memoKey, false, memoMs );
+	else if( ( evaluatedMask & memoMask ) == memoMask )
+		FilterMemo::Store( memoKey, true, memoMs );
+
+	return isPassed;
+}
+
+// Feature bits are constants in every variant, disabled blocks are removed by the compiler
+template <uint32_t Features>
+void LocationalDamage::ApplyLocationalDamageVariant( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch )
+{
+	ALD_PROFILE_SCOPE( kApplyLocationalDamage );
+
+	RE::Actor* shooterActor = nullptr;
+	if( !IsProcessed( a_projectile, a_target, shooterActor ) )
+		return;
+
+	// Snapshot of the rules, stays valid for this hit even if a reload publishes a new set
+	auto ruleSet = Settings::GetRuleSet();
+	if( !ruleSet )
+		return;
+
+	auto hitPart = FindHitPart( a_projectile, a_target, a_location, *ruleSet );
+	if( !hitPart )
+		return;
 
-			if( shooterIsPlayer )
+	HitState hit;
+	hit.ruleSet			= ruleSet.get();
+	hit.projectile		= a_projectile;
+	hit.impactData		= a_projectile->impacts.empty() ? nullptr : *a_projectile->impacts.begin();
+	hit.isAtImpact		= true;
+	hit.target			= (RE::Actor*)a_target;
+	hit.shooter			= shooterActor;
+	hit.hitPart			= hitPart;
+	hit.location		= *a_location;
+	hit.shooterIsPlayer	= shooterActor && shooterActor->IsPlayerRef();
+	hit.targetIsPlayer	= a_target->IsPlayerRef();
+
+	HitFilters filters( *ruleSet, hit.target, shooterActor, a_projectile );
+
+	auto& hotRules = ruleSet->hotRules;
+	auto& nodeMatch = ruleSet->MatchNode( hitPart->name.c_str() );
+	for( uint32_t ruleIndex = 0; ruleIndex < hotRules.size(); ++ruleIndex )
+	{
+		Profiler::RuleScope ruleProfile( ruleIndex );
+
+		bool isLocationMatched = false;
+		{
+			ALD_PROFILE_SCOPE( kRuleMatch );
+			isLocationMatched = nodeMatch.IsRuleMatched( ruleIndex );
+		}
+
+		if( isLocationMatched )
+		{
+			ruleProfile.Count( Profiler::RuleCounter::kMatched );
+
+			// The chance is always rolled first so the random sequence does not depend on the predicate order
+			bool isPassed = RandomPercent( GetSuccessChance( *ruleSet, ruleIndex, hit.target, g_fLastHitDamage ) );
+			if( isPassed )
 			{
-				// Reward shot difficulty EXP if enabled
-				if( g_bEnableDifficultyBonus )
-				{
-					float shotDifficulty = CalculateShotDifficulty( a_projectile, targetActor, g_fShotDifficultyTimeFactor, g_fShotDifficultyDistFactor, g_fShotDifficultyMoveFactor );
-					expMult *= shotDifficulty;
-				}
+				ruleProfile.Count( Profiler::RuleCounter::kChancePassed );
+				isPassed = IsRulePassed( *ruleSet, ruleIndex, filters, ruleProfile );
+			}
+
+			// Rule cost covers the predicates only, the effects of a triggered rule have their own stages
+			ruleProfile.Stop();
+
+			if( isPassed )
+			{
+				ruleProfile.Count( Profiler::RuleCounter::kTriggered );
+
+				// Stop processing further locations if not required to do so.
+				if( !TriggerRule<Features>( hit, *ruleSet, ruleIndex ) )
+					break;
+			}
+		}
+	}
+
+	FinishHit<Features>( hit, [ & ]()
+	{
+		auto& options = ruleSet->options;
+		return CalculateShotDifficulty( a_projectile, hit.target, a_launch, *a_location, options.shotDifficultyTimeFactor, options.shotDifficultyDistFactor, options.shotDifficultyMoveFactor );
+	});
+}
+
+int LocationalDamage::GetSuccessChance( const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex, RE::Actor* a_target, float a_damage )
+{
+	// The health is only read for a rule that scales its chance with it
+	auto& hotRules = a_ruleSet.hotRules;
+	if( hotRules.successHPFactor[ a_ruleIndex ] == 0 )
+		return hotRules.successChance[ a_ruleIndex ];
+
+	return GetSuccessChance( a_ruleSet, a_ruleIndex, a_target->GetBaseActorValue( RE::ActorValue::kHealth ), a_damage );
+}
+
+int LocationalDamage::GetSuccessChance( const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex, float a_targetMaxHealth, float a_damage )
+{
+	auto& hotRules = a_ruleSet.hotRules;
+	int finalSuccessChance = hotRules.successChance[ a_ruleIndex ];
+
+	// Compute HP factor
+	if( hotRules.successHPFactor[ a_ruleIndex ] != 0 )
+	{
+		float successHPFactor = GetHPFactor( a_targetMaxHealth, hotRules.successHPFactor[ a_ruleIndex ], a_damage, hotRules.Has( a_ruleIndex, Settings::RuleSet::HotRules::kSuccessHPFactorCap ) );
+		finalSuccessChance = (int)(hotRules.successChance[ a_ruleIndex ] * successHPFactor);
+	}
+
+	return finalSuccessChance;
+}
+
+template <uint32_t Features>
+bool LocationalDamage::TriggerRule( HitState& a_hit, const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex )
+{
+	auto& hotRules			= a_ruleSet.hotRules;
+	auto& locationalSetting	= a_ruleSet.locations[ a_ruleIndex ];
+	auto& options			= a_ruleSet.options;
+	auto& floatingText		= a_hit.sideEffects.floatingText;
+	auto& hitDataOverride	= a_hit.hitOverride;
+	auto targetActor		= a_hit.target;
+	auto shooterActor		= a_hit.shooter;
+	bool shooterIsPlayer	= a_hit.shooterIsPlayer;
+	bool targetIsPlayer		= a_hit.targetIsPlayer;
+
+#ifndef NDEBUG
+	Diagnostics::Push( Diagnostics::kRuleTriggered, a_ruleIndex, locationalSetting.id );
+#endif
+	hitDataOverride.aggressor	= static_cast<RE::TESObjectREFR*>( shooterActor );	// Compared with the attack aggressor reference
+	hitDataOverride.target		= static_cast<RE::TESObjectREFR*>( targetActor );
+	hitDataOverride.location	= ToPoint3( a_hit.location );
+	hitDataOverride.damageMult	*= hotRules.damageMult[ a_ruleIndex ];
+
+	a_hit.difficulty = max( a_hit.difficulty, hotRules.difficulty[ a_ruleIndex ] );
+
+	// Set expiration time to prevent build up of unprocessed hits (1/10 sec)
+	QueryPerformanceCounter( (LARGE_INTEGER*)&hitDataOverride.expireTimestamp );
+	hitDataOverride.expireTimestamp += g_PerformanceFrequency / 10;
+
+	g_fDamageMult = hotRules.damageMult[ a_ruleIndex ];
+	g_fLastHitDamage *= g_fDamageMult;
 
-				if( g_nEXPNotificationMode != NotificationMode::None && 
-					( g_bEnableDifficultyBonus || g_bEnableLocationMultiplier ) &&
-					expMult >= g_fShotDifficultyReportMin )
+	// Only while the impact is resolved, batched hits never reach a rule that acts on the impact
+	auto missileProjectile = a_hit.projectile->As<RE::MissileProjectile>();
+	if( a_hit.isAtImpact && missileProjectile && hotRules.Has( a_ruleIndex, Settings::RuleSet::HotRules::kDeflect ) )
+	{
+		if( missileProjectile->impactResult == RE::ImpactResult::kStick )
+		{
+			missileProjectile->impactResult = RE::ImpactResult::kBounce;
+
+			if( a_hit.impactData )
+				a_hit.impactData->impactResult = RE::ImpactResult::kBounce;
+		}
+	}
+
+	if( locationalSetting.impactData.size() > 0 )
+	{
+		auto impactOverride = RE::TESForm::LookupByEditorID( locationalSetting.impactData );
+		if( impactOverride )
+		{
+			g_ImpactOverride = impactOverride->As<RE::BGSImpactData>();
+			hitDataOverride.impactData = g_ImpactOverride;
+		}
+	}
+
+	auto message			= &locationalSetting.message;
+	auto messageFloating	= &locationalSetting.messageFloating;
+	if( shooterActor )
+	{
+		// Amplify the power of any effects applied by the impact.(Enchantments and Perks)
+		if constexpr( ( Features & kAmplifyEnchantment ) != 0 )
+			AmplifyActiveEffect( targetActor, shooterActor, hotRules.damageMult[ a_ruleIndex ] );
+
+		// Only player sound when the player is involved
+		if( ( shooterIsPlayer || targetIsPlayer ) && locationalSetting.sound.size() > 0 )
+		{
+			if( shooterIsPlayer || options.playerHitSound )
+				a_hit.sideEffects.sounds.push_back( locationalSetting.sound.c_str() );
+		}
+
+		// Notification display
+		if( ( Features & kHitNotification ) && ( shooterIsPlayer || targetIsPlayer || options.npcFloatingNotification ) )
+		{
+			ALD_PROFILE_SCOPE( kNotification );
+
+			if( message->size() > 0 || messageFloating->size() > 0 )
+			{
+				// Use normal message for floating text if floating message is not defined
+				if( messageFloating->size() == 0 )
+					messageFloating = message;
+
+				bool shouldShowNotification = options.notificationMode == NotificationMode::Both || options.notificationMode == NotificationMode::Screen;
+
+				if( options.notificationMode == NotificationMode::Both || options.notificationMode == NotificationMode::Floating )
 				{
-					auto reportStr = fmt::format( "Shot difficulty: {:0.1f}", expMult );
-					bool shouldShowNotification = 
-						g_nEXPNotificationMode == NotificationMode::Both || g_nEXPNotificationMode == NotificationMode::Screen;
-					if( g_nEXPNotificationMode == NotificationMode::Both || g_nEXPNotificationMode == NotificationMode::Floating )
+					if( ( targetIsPlayer && options.playerNotification ) ||								// Floating notification for player
+						( !targetIsPlayer && !shooterIsPlayer && options.npcFloatingNotification ) ||	// Floating notification for NPC
+						shooterIsPlayer )
 					{
-						if( !floatingText.AddText( reportStr.c_str(), 0xFF8000, 24) )
+						// Switch to screen notification if failed
+						if( !floatingText.AddText( 
+							messageFloating->c_str(), 
+							targetIsPlayer ? locationalSetting.floatingColorSelf : locationalSetting.floatingColorEnemy, 
+							locationalSetting.floatingSize,
+							true ) )
 							shouldShowNotification = true;
 					}
+				}
 
-					if( shouldShowNotification )
-						RE::DebugNotification( reportStr.c_str(), NULL, false );
+				// On screen notification is reserved for player only
+				if( shouldShowNotification && message->size() > 0 )
+				{
+					if( targetIsPlayer && options.playerNotification )
+						a_hit.sideEffects.notifications.push_back( { message->c_str(), true } );
+					else if( shooterIsPlayer )
+						a_hit.sideEffects.notifications.push_back( { message->c_str(), false, false } );
 				}
+			}
+		}
+	}
 
-				// Clamp to limit
-				expMult = min( g_fShotDifficultyMax, expMult );
+	for( auto& effect : locationalSetting.effects )
+	{
+		auto hpFactor		= GetHPFactor( targetActor, options.hpFactor, g_fLastHitDamage, options.effectChanceCap );
+		int finalChance		= (int)(effect.effectChance * hpFactor);
 
-				if( expMult > 1 )
+		if( effect.effectID.length() > 0 && RandomPercent( finalChance ) )
+		{
+			ALD_PROFILE_SCOPE( kEffectCast );
+
+			auto magicItem = RE::TESForm::LookupByEditorID<RE::MagicItem>( effect.effectID );
+			if( magicItem && (
+				magicItem->formType == RE::FormType::Spell ||
+				magicItem->formType == RE::FormType::Enchantment ||
+				magicItem->formType == RE::FormType::AlchemyItem ) )
+			{
+				auto castingSource = RE::MagicSystem::CastingSource::kInstant;
+
+				// Cast from target if all effects are PVM type to prevent PVM stacking bug from multiple sources
+				bool shouldCastAtTarget = true;
+				for( auto iter = magicItem->effects.begin(); iter != magicItem->effects.end(); ++iter )
 				{
-					auto player = static_cast<RE::PlayerCharacter*>( shooterActor );
-					auto weapon = a_projectile->weaponSource;
-					if( weapon )
+					if( (*iter)->baseEffect->GetArchetype() != RE::EffectSetting::Archetype::kPeakValueModifier )
 					{
-						// Skyrim give EXP equals to weapon base attack damage by default (1x)
-						auto baseEXP = weapon->GetAttackDamage();
-						// Only give the amount of EXP over 1x since the game is already rewarded the player at this point
-						player->AddSkillExperience( weapon->weaponData.skill.get(), baseEXP * (expMult - 1) );
+						shouldCastAtTarget = false;
+						break;
 					}
 				}
+
+				// Cast at target when it should or when the firing actor does not exist.(Fired from an activator)
+				if( shouldCastAtTarget || !shooterActor )
+					targetActor->GetMagicCaster( castingSource )->CastSpellImmediate( magicItem, false, targetActor, 1.0f, false, 0, NULL );
+				else
+					shooterActor->GetMagicCaster( castingSource )->CastSpellImmediate( magicItem, false, targetActor, 1.0f, false, 0, NULL );
+
+				if( options.hitEffectNotification )
+				{
+					if( (targetIsPlayer || shooterIsPlayer) ||
+						options.npcFloatingNotification )
+						floatingText.AddText( 
+							magicItem->GetName(), 
+							targetIsPlayer ? locationalSetting.floatingColorSelf : locationalSetting.floatingColorEnemy, 
+							locationalSetting.floatingSize,
+							true );
+				}
 			}
+		}
+	}
 
-			bool isFPS = false;
-			auto camera = RE::PlayerCamera::GetSingleton();
-			if( camera && targetIsPlayer )
-				isFPS = camera->currentState->id == RE::CameraState::kFirstPerson;
+	// Stop processing further locations if not required to do so.
+	return hotRules.Has( a_ruleIndex, Settings::RuleSet::HotRules::kContinue );
+}
+
+template <uint32_t Features, class GetShotDifficulty>
+void LocationalDamage::FinishHit( HitState& a_hit, GetShotDifficulty&& a_getShotDifficulty )
+{
+	auto& hitDataOverride	= a_hit.hitOverride;
+	auto& sideEffects		= a_hit.sideEffects;
+	auto& options			= a_hit.ruleSet->options;
+
+	float expMult = 1;
+	if( hitDataOverride.aggressor )
+	{
+		g_HitDataOverride.Add( hitDataOverride );
 
-			// Flush floating text buffer
-			float alpha = (shooterIsPlayer || targetIsPlayer) ? 100.0f : 50.0f;
-			floatingText.Draw( a_target, isFPS ? NULL : a_location, g_fFloatingOffsetX, g_fFloatingOffsetY, alpha, shooterIsPlayer );
+		if( a_hit.shooterIsPlayer )
+		{
+			// Reward additional EXP if enabled
+			if( options.enableLocationMultiplier && a_hit.difficulty > 1 )
+				expMult += a_hit.difficulty - 1;
+		}
+	}
+
+	if( ( Features & kExperience ) && a_hit.shooterIsPlayer )
+	{
+		ALD_PROFILE_SCOPE( kExperience );
+
+		// Reward shot difficulty EXP if enabled
+		if( options.enableDifficultyBonus )
+		{
+			expMult *= a_getShotDifficulty();
+		}
+
+		if( options.expNotificationMode != NotificationMode::None && 
+			( options.enableDifficultyBonus || options.enableLocationMultiplier ) &&
+			expMult >= options.shotDifficultyReportMin )
+			sideEffects.shotDifficulty = expMult;
+
+		// Clamp to limit
+		expMult = min( options.shotDifficultyMax, expMult );
+
+		if( expMult > 1 )
+		{
+			auto weapon = a_hit.projectile->weaponSource;
+			if( weapon )
+			{
+				// Skyrim give EXP equals to weapon base attack damage by default (1x)
+				auto baseEXP = weapon->GetAttackDamage();
+				// Only give the amount of EXP over 1x since the game is already rewarded the player at this point
+				sideEffects.skill		= weapon->weaponData.skill.get();
+				sideEffects.experience	= baseEXP * (expMult - 1);
+			}
+		}
+	}
+
+	if constexpr( ( Features & kDebugNotification ) != 0 )
+	{
+		if( a_hit.shooterIsPlayer )
+			Diagnostics::Push( Diagnostics::kArrowHits, 0, a_hit.hitPart->name.c_str() );
+
+		if( a_hit.targetIsPlayer )
+			Diagnostics::Push( Diagnostics::kEnemyHits, 0, a_hit.hitPart->name.c_str() );
+	}
+
+	// Everything left does not change the impact, it runs on the main thread once the hook has returned
+	if( !sideEffects.IsEmpty() )
+	{
+		sideEffects.target			= RE::NiPointer<RE::TESObjectREFR>( a_hit.target );
+		sideEffects.location		= a_hit.location;
+		sideEffects.shooter			= RE::NiPointer<RE::TESObjectREFR>( a_hit.shooter );
+		sideEffects.shooterIsPlayer	= a_hit.shooterIsPlayer;
+		sideEffects.targetIsPlayer	= a_hit.targetIsPlayer;
+		sideEffects.ruleSet			= a_hit.ruleSet->shared_from_this();
+
+		SideEffectQueue::Push( sideEffects );
+	}
+}
+
+// Worker thread of HitBatch::Flush, reads the snapshot of the hit and never the game objects
+void LocationalDamage::ScanBatchedHit( const BatchedHit& a_hit, BatchScan& a_scan )
+{
+	a_scan.candidates.clear();
+	a_scan.shotDifficulty = 1;
+
+	auto& ruleSet	= *a_hit.ruleSet;
+	auto& hotRules	= ruleSet.hotRules;
+	auto& nodeMatch	= *a_hit.nodeMatch;
+	BatchedFilters filters( a_hit );
+
+	// Rolls of a hit come from its own seed, the outcome does not depend on the thread that scans it
+	std::minstd_rand random( a_hit.seed );
+	float damage = a_hit.damage;
+	for( uint32_t ruleIndex = 0; ruleIndex < hotRules.size(); ++ruleIndex )
+	{
+		Profiler::RuleScope ruleProfile( ruleIndex );
+
+		bool isLocationMatched = false;
+		{
+			ALD_PROFILE_SCOPE( kRuleMatch );
+			isLocationMatched = nodeMatch.IsRuleMatched( ruleIndex );
+		}
+
+		if( !isLocationMatched )
+			continue;
+
+		ruleProfile.Count( Profiler::RuleCounter::kMatched );
+
+		bool isConditionPending = false;
+		bool isPassed = (int)( random() % 100 ) <= GetSuccessChance( ruleSet, ruleIndex, a_hit.targetMaxHealth, damage );
+		if( isPassed )
+		{
+			ruleProfile.Count( Profiler::RuleCounter::kChancePassed );
+			isPassed = IsRulePassed( ruleSet, ruleIndex, filters, ruleProfile, &isConditionPending );
+		}
+
+		ruleProfile.Stop();
+
+		if( isPassed )
+		{
+			a_scan.candidates.push_back( { ruleIndex, isConditionPending } );
 
-			if( g_bDebugNotification )
+			// A rule sure to trigger ends the scan unless it continues, then it scales the damage seen by the next ones
+			if( !isConditionPending )
 			{
-				if( shooterIsPlayer )
-					RE::DebugNotification( fmt::format( "Arrow hits {}"sv, hitPart->name.c_str() ).c_str() );
+				if( !hotRules.Has( ruleIndex, Settings::RuleSet::HotRules::kContinue ) )
+					break;
 
-				if( a_target->IsPlayerRef() )
-					RE::ConsoleLog::GetSingleton()->Print( "Enemy hits your '%s'", hitPart->name.c_str() );
+				damage *= hotRules.damageMult[ ruleIndex ];
 			}
 		}
 	}
+
+	if( a_hit.hasShot )
+		a_scan.shotDifficulty = ShotDifficulty::Compute( a_hit.shot, ruleSet.options.shotDifficultyTimeFactor, ruleSet.options.shotDifficultyDistFactor, ruleSet.options.shotDifficultyMoveFactor );
+}
+
+template <uint32_t Features>
+void LocationalDamage::ApplyBatchedHitVariant( const BatchedHit& a_hit, const BatchScan& a_scan )
+{
+	HitState hit;
+	hit.ruleSet			= a_hit.ruleSet;
+	hit.projectile		= a_hit.projectile;
+	hit.target			= a_hit.target;
+	hit.shooter			= a_hit.shooter;
+	hit.hitPart			= a_hit.hitPart;
+	hit.location		= a_hit.location;
+	hit.shooterIsPlayer	= a_hit.shooterIsPlayer;
+	hit.targetIsPlayer	= a_hit.targetIsPlayer;
+
+	// Effect chances start from the damage seen at the impact, as they would inline
+	g_fLastHitDamage = a_hit.damage;
+
+	auto& ruleSet = *a_hit.ruleSet;
+	for( auto& candidate : a_scan.candidates )
+	{
+		// Perk conditions run the engine condition functions, only here
+		if( candidate.isConditionPending )
+		{
+			bool isConditionTrue = IsConditionTrue( *ruleSet.GetCondition( candidate.rule ), hit.shooter, hit.target );
+			Profiler::CountRule( candidate.rule, isConditionTrue ? Profiler::RuleCounter::kConditionPassed : Profiler::RuleCounter::kConditionFailed );
+			if( !isConditionTrue )
+				continue;
+		}
+
+		Profiler::CountRule( candidate.rule, Profiler::RuleCounter::kTriggered );
+
+		if( !TriggerRule<Features>( hit, ruleSet, candidate.rule ) )
+			break;
+	}
+
+	FinishHit<Features>( hit, [ & ]() { return a_scan.shotDifficulty; } );
+}
+
+template <size_t... Features>
+static constexpr std::array<LocationalDamage::ApplyFunction, sizeof...( Features )> MakeVariants( std::index_sequence<Features...> )
+{
+	return { &LocationalDamage::ApplyLocationalDamageVariant<Features>... };
+}
+
+const std::array<LocationalDamage::ApplyFunction, LocationalDamage::kVariantCount> LocationalDamage::kVariants = MakeVariants( std::make_index_sequence<kVariantCount>() );
+
+template <size_t... Features>
+static constexpr std::array<LocationalDamage::ApplyBatchedFunction, sizeof...( Features )> MakeBatchedVariants( std::index_sequence<Features...> )
+{
+	return { &LocationalDamage::ApplyBatchedHitVariant<Features>... };
+}
+
+const std::array<LocationalDamage::ApplyBatchedFunction, LocationalDamage::kVariantCount> LocationalDamage::kBatchedVariants = MakeBatchedVariants( std::make_index_sequence<kVariantCount>() );
+
+void HitSideEffects::Run()
+{
+	ALD_PROFILE_SCOPE( kSideEffects );
+
+	for( auto sound : sounds )
+		RE::PlaySound( sound );
+
+	if( experience > 0 )
+		RE::PlayerCharacter::GetSingleton()->AddSkillExperience( skill, experience );
+
+	ALD_PROFILE_SCOPE( kNotification );
+
+	// Drawn and shown before returning, the report can stay on the stack
+	char reportStr[ 64 ];
+	bool shouldShowReport = false;
+	if( shotDifficulty > 0 )
+	{
+		FormatTo( reportStr, "Shot difficulty: {:0.1f}", shotDifficulty );
+		auto mode = ruleSet->options.expNotificationMode;
+		shouldShowReport = mode == NotificationMode::Both || mode == NotificationMode::Screen;
+		if( mode == NotificationMode::Both || mode == NotificationMode::Floating )
+		{
+			if( !floatingText.AddText( reportStr, 0xFF8000, 24, true ) )
+				shouldShowReport = true;
+		}
+	}
+
+	bool isFPS = targetIsPlayer && PlayerSkeleton::GetMode() == PlayerSkeleton::kFirstPerson;
+
+	// Flush floating text buffer
+	float alpha = (shooterIsPlayer || targetIsPlayer) ? 100.0f : 50.0f;
+	floatingText.Draw( target.get(), isFPS ? NULL : &location, ruleSet->options.floatingOffsetX, ruleSet->options.floatingOffsetY, alpha, shooterIsPlayer );
+
+	char buffer[ 512 ];
+	for( auto& notification : notifications )
+	{
+		if( notification.isByShooter )
+		{
+			if( shooter )
+				RE::DebugNotification( FormatTo( buffer, "{} by {}", notification.text, shooter->GetDisplayFullName() ) );
+		}
+		else
+			RE::DebugNotification( notification.text, NULL, notification.cancelIfQueued );
+	}
+
+	if( shouldShowReport )
+		RE::DebugNotification( reportStr, NULL, false );
+}
+
+void HitSideEffects::Clear()
+{
+	target.reset();
+	shooter.reset();
+	location		= RE::NiPoint3();
+	shooterIsPlayer	= false;
+	targetIsPlayer	= false;
+	ruleSet.reset();
+
+	floatingText.Reset();
+	sounds.clear();
+	notifications.clear();
+
+	shotDifficulty	= 0;
+	skill			= RE::ActorValue::kNone;
+	experience		= 0;
+}
+
+static std::mutex					sideEffectMutex;
+static std::vector<HitSideEffects>	pendingSideEffects;
+static std::vector<HitSideEffects>	freeSideEffects;
+static bool							isDrainScheduled = false;
+
+std::vector<HitSideEffects>& SideEffectQueue::GetThreadSlots()
+{
+	thread_local std::vector<HitSideEffects> slots = []()
+	{
+		std::vector<HitSideEffects> result;
+		result.reserve( kMaxThreadSlots );
+		return result;
+	}();
+
+	return slots;
+}
+
+HitSideEffects SideEffectQueue::Acquire()
+{
+	auto& slots = GetThreadSlots();
+	if( slots.empty() )
+		return HitSideEffects();
+
+	auto sideEffects = std::move( slots.back() );
+	slots.pop_back();
+	return sideEffects;
+}
+
+void SideEffectQueue::Release( HitSideEffects&& a_sideEffects )
+{
+	a_sideEffects.Clear();
+
+	auto& slots = GetThreadSlots();
+	if( slots.size() < kMaxThreadSlots )
+		slots.push_back( std::move( a_sideEffects ) );
+}
+
+void SideEffectQueue::Push( HitSideEffects& a_sideEffects )
+{
+	std::lock_guard<std::mutex> lock( sideEffectMutex );
+	pendingSideEffects.push_back( std::move( a_sideEffects ) );
+
+	// The hit gets a slot back from the drained ones, under the same lock
+	if( !freeSideEffects.empty() )
+	{
+		a_sideEffects = std::move( freeSideEffects.back() );
+		freeSideEffects.pop_back();
+	}
+	else
+		a_sideEffects = HitSideEffects();
+
+	// One task for everything queued until it runs
+	if( !isDrainScheduled )
+	{
+		isDrainScheduled = true;
+		SKSE::GetTaskInterface()->AddTask( []() { Drain(); } );
+	}
+}
+
+void SideEffectQueue::Drain()
+{
+	// Main thread only, swapped with the queue so both keep their capacity
+	static std::vector<HitSideEffects> running;
+	{
+		std::lock_guard<std::mutex> lock( sideEffectMutex );
+		running.swap( pendingSideEffects );
+		isDrainScheduled = false;
+	}
+
+	for( auto& sideEffects : running )
+		sideEffects.Run();
+
+	for( auto& sideEffects : running )
+		sideEffects.Clear();
+
+	{
+		std::lock_guard<std::mutex> lock( sideEffectMutex );
+		for( auto& sideEffects : running )
+		{
+			if( freeSideEffects.size() >= kMaxFreeSlots )
+				break;
+
+			freeSideEffects.push_back( std::move( sideEffects ) );
+		}
+	}
+
+	running.clear();
 }
 
 bool LocationalDamage::Install( REL::Version a_ver )
@@ -376,7 +1021,9 @@ bool LocationalDamage::Install( REL::Version a_ver )
 #endif
 
 	Settings::Load();
+	SelectVariant( *Settings::GetRuleSet() );
 	FloatingDamage::Initialize( a_ver );
+	ConsoleCommand::Install();
 
 	QueryPerformanceFrequency( (LARGE_INTEGER*)&g_PerformanceFrequency );
 
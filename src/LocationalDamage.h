@@ -1,13 +1,99 @@
 #pragma once
 
-struct HitDataOverride
+#include "ProjectileTracker.h"
+#include "Utils.h"
+#include "Settings.h"
+#include "FloatingDamage.h"
+#include "HitBatch.h"
+#include "core/HitOverride.h"
+
+// Results of a hit that do not change the impact: sounds, notifications, floating text and EXP.
+// Collected by the impact hook and run later on the main thread by SideEffectQueue.
+// Strings are borrowed from the rule set, the side effects hold a reference to it until they run.
+struct HitSideEffects
 {
-	RE::TESObjectREFR*		aggressor = 0;
-	RE::TESObjectREFR*		target = 0;
-	RE::NiPoint3			location;
-	float					damageMult = 1.0f;
-	RE::BGSImpactData*		impactData = nullptr;
-	unsigned long long		expireTimestamp;
+	struct Notification
+	{
+		const char*	text = nullptr;
+		bool		isByShooter = false;	// Append the shooter name, formatted when shown
+		bool		cancelIfQueued = true;
+	};
+
+	RE::NiPointer<RE::TESObjectREFR>	target;
+	RE::NiPointer<RE::TESObjectREFR>	shooter;
+	RE::NiPoint3						location;
+	bool								shooterIsPlayer = false;
+	bool								targetIsPlayer = false;
+	std::shared_ptr<const Settings::RuleSet>	ruleSet;			// The hit went through it, owns the strings and options
+
+	FloatingDamage						floatingText;
+	std::vector<const char*>			sounds;
+	std::vector<Notification>			notifications;
+
+	float								shotDifficulty = 0;		// Reported when above zero
+	RE::ActorValue						skill = RE::ActorValue::kNone;
+	float								experience = 0;
+
+	bool IsEmpty() const
+	{
+		return floatingText.IsEmpty() && sounds.empty() && notifications.empty() && shotDifficulty <= 0 && experience <= 0;
+	}
+
+	void Run();
+
+	// Reset for another hit, the containers keep their capacity
+	void Clear();
+};
+
+// Side effects waiting for the main thread. Slots are recycled with the capacity of their containers and a single
+// SKSE task runs everything queued during a frame, a hit allocates neither a task nor its side effects.
+// A hit takes its slot from a free list of its thread, the queue lock is only taken by a hit that pushes side effects.
+class SideEffectQueue
+{
+public:
+	static constexpr size_t kMaxFreeSlots		= 256;
+	static constexpr size_t kMaxThreadSlots		= 2;	// Per hooking thread, hits of a thread do not overlap
+
+	// Cleared side effects for a new hit from the free list of this thread, without locking
+	static HitSideEffects Acquire();
+
+	// Side effects of a finished hit, kept by this thread for its next one
+	static void Release( HitSideEffects&& a_sideEffects );
+
+	// Run a_sideEffects with the next drain on the main thread, a_sideEffects is replaced by cleared ones
+	static void Push( HitSideEffects& a_sideEffects );
+
+private:
+	static void Drain();
+
+	static std::vector<HitSideEffects>& GetThreadSlots();
+};
+
+// One hit going through the rules, shared by the inline and the batched pipeline
+struct HitState
+{
+	const Settings::RuleSet*	ruleSet = nullptr;
+	RE::Projectile*				projectile = nullptr;
+	RE::BGSImpactData*			impactData = nullptr;
+	RE::Actor*					target = nullptr;
+	RE::Actor*					shooter = nullptr;
+	RE::NiNode*					hitPart = nullptr;
+	RE::NiPoint3				location;
+	bool						shooterIsPlayer = false;
+	bool						targetIsPlayer = false;
+	bool						isAtImpact = false;		// Inside the impact hook, the projectile impact can still be changed
+	float						difficulty = 1;
+
+	HitOverride					hitOverride;
+	HitSideEffects				sideEffects;
+
+	HitState() :
+		sideEffects( SideEffectQueue::Acquire() ) {}
+
+	~HitState() { SideEffectQueue::Release( std::move( sideEffects ) ); }
+
+	HitState( const HitState& ) = delete;
+	HitState& operator=( const HitState& ) = delete;
 };
 
 struct LocationalDamage
@@ -15,9 +101,67 @@ struct LocationalDamage
 	typedef void(*MagicCaster_CastPtr)( RE::MagicItem* a_spell, bool unk1, RE::TESObjectREFR* a_target, float a_magOverride, bool unk2, float unk3, void* unk4 );
 	static MagicCaster_CastPtr fnCastMagic;
 
-	static void ApplyLocationalDamage( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location );
+	// Settings that decide whole blocks of the hit pipeline. Each combination is a separate instantiation
+	// of ApplyLocationalDamageVariant (16 in total), the matching one is selected whenever settings are loaded.
+	enum Feature : uint32_t
+	{
+		kHitNotification	= 1 << 0,	// HitNotificationMode is not None
+		kAmplifyEnchantment	= 1 << 1,	// AmplifyEnchantment
+		kExperience			= 1 << 2,	// EnableDifficultyBonus or EnableLocationMultiplier
+		kDebugNotification	= 1 << 3,	// DebugNotification
+
+		kVariantCount		= 1 << 4
+	};
 
+	using ApplyFunction = void (*)( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch );
+
+	static void ApplyLocationalDamage( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch = nullptr );
+
+	template <uint32_t Features>
+	static void ApplyLocationalDamageVariant( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const ProjectileTracker::Launch* a_launch );
+
+	// Batched hits are decided by ScanBatchedHit on the worker threads, the variant triggers the rules on the main thread
+	using ApplyBatchedFunction = void (*)( const BatchedHit& a_hit, const BatchScan& a_scan );
+
+	static void ScanBatchedHit( const BatchedHit& a_hit, BatchScan& a_scan );
+
+	template <uint32_t Features>
+	static void ApplyBatchedHitVariant( const BatchedHit& a_hit, const BatchScan& a_scan );
+
+	// Prefilters shared by every path, a_shooter is set when the hit is processed
+	static bool IsProcessed( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::Actor*& a_shooter );
+
+	static RE::NiNode* FindHitPart( RE::Projectile* a_projectile, RE::TESObjectREFR* a_target, RE::NiPoint3* a_location, const Settings::RuleSet& a_ruleSet );
+
+	static int GetSuccessChance( const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex, RE::Actor* a_target, float a_damage );
+	static int GetSuccessChance( const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex, float a_targetMaxHealth, float a_damage );
+
+	// Returns true when the following rules are still evaluated
+	template <uint32_t Features>
+	static bool TriggerRule( HitState& a_hit, const Settings::RuleSet& a_ruleSet, uint32_t a_ruleIndex );
+
+	// Hit override, EXP and side effects once every rule is done
+	template <uint32_t Features, class GetShotDifficulty>
+	static void FinishHit( HitState& a_hit, GetShotDifficulty&& a_getShotDifficulty );
+
+	// Pick the variant matching the settings of a_ruleSet
+	static void SelectVariant( const Settings::RuleSet& a_ruleSet );
+
+	static const std::array<ApplyFunction, kVariantCount> kVariants;
+	static inline std::atomic<ApplyFunction> applyVariant = &ApplyLocationalDamageVariant<kVariantCount - 1>;
+
+	static const std::array<ApplyBatchedFunction, kVariantCount> kBatchedVariants;
+	static inline std::atomic<ApplyBatchedFunction> applyBatchedVariant = &ApplyBatchedHitVariant<kVariantCount - 1>;
+
+	// Resolve perk conditions of the current rule set once forms are loaded
 	static void InitPerkConditions();
+	static void ResolvePerkConditions( Settings::RuleSet& a_ruleSet );
+
+	// Lower the rule filters to a FilterProgram once forms are loaded
+	static void CompileFilters( Settings::RuleSet& a_ruleSet );
+
+	// Rebuild the rule set from the INI on a background thread and publish it
+	static void ReloadSettings();
 
 	static bool RandomPercent( int percent )
 	{
@@ -83,17 +227,20 @@ struct LocationalDamage
 
 	static float GetHPFactor( RE::Actor* a_actor, float a_factor, float a_damage, bool a_isCap )
 	{
-		auto targetMaxHP = a_actor->GetBaseActorValue( RE::ActorValue::kHealth );
+		return GetHPFactor( a_actor->GetBaseActorValue( RE::ActorValue::kHealth ), a_factor, a_damage, a_isCap );
+	}
 
+	static float GetHPFactor( float a_maxHealth, float a_factor, float a_damage, bool a_isCap )
+	{
 		// Prevent divide by zero
-		if( targetMaxHP == 0 )
+		if( a_maxHealth == 0 )
 			return 1;
 
 		float factor = 1;
 		if( a_factor > 0 )
-			factor = a_damage / targetMaxHP / a_factor;
+			factor = a_damage / a_maxHealth / a_factor;
 		else if( a_factor < 0 )
-			factor = 1 / (a_damage / targetMaxHP / -a_factor);
+			factor = 1 / (a_damage / a_maxHealth / -a_factor);
 
 		return a_isCap ? min( factor, 1 ) : factor;
 	}
@@ -0,0 +1,229 @@
+#include "NativeCondition.h"
+#include "Diagnostics.h"
+
+using FunctionID = RE::FUNCTION_DATA::FunctionID;
+using OpCode = RE::CONDITION_ITEM_DATA::OpCode;
+
+bool NativeCondition::IsSupported( FunctionID a_function )
+{
+	switch( a_function )
+	{
+	case FunctionID::kHasKeyword:
+	case FunctionID::kGetIsRace:
+	case FunctionID::kGetIsSex:
+	case FunctionID::kGetIsID:
+	case FunctionID::kGetIsReference:
+	case FunctionID::kGetActorValue:
+	case FunctionID::kGetBaseActorValue:
+	case FunctionID::kGetLevel:
+	case FunctionID::kIsSneaking:
+	case FunctionID::kIsInCombat:
+	case FunctionID::kIsWeaponOut:
+	case FunctionID::kGetEquippedItemType:
+		return true;
+	}
+
+	return false;
+}
+
+std::string NativeCondition::GetFunctionName( FunctionID a_function )
+{
+	auto commands = RE::SCRIPT_FUNCTION::GetFirstScriptCommand();
+	if( commands && commands[ (uint32_t)a_function ].functionName )
+		return commands[ (uint32_t)a_function ].functionName;
+
+	return fmt::format( "Function {}", (uint32_t)a_function );
+}
+
+std::unique_ptr<NativeCondition> NativeCondition::Compile( const RE::TESCondition& a_condition )
+{
+	auto condition = std::make_unique<NativeCondition>();
+	for( auto conditionItem = a_condition.head; conditionItem; conditionItem = conditionItem->next )
+	{
+		auto& data = conditionItem->data;
+		auto function = data.functionData.function.get();
+
+		// Random numbers must be drawn by the engine in its own order, the whole condition stays interpreted
+		if( function == FunctionID::kGetRandomPercent )
+			return nullptr;
+
+		Item item;
+		item.item			= conditionItem;
+		item.function		= function;
+		item.param			= data.functionData.params[ 0 ];
+		item.opCode			= data.flags.opCode;
+		item.isOR			= data.flags.isOR;
+		item.isRunOnTarget	= ( data.object == RE::CONDITIONITEMOBJECT::kTarget ) != data.flags.swapTarget;
+		item.isNative		= IsSupported( function ) &&
+			!data.flags.usesAliases && !data.flags.usePackData &&
+			( data.object == RE::CONDITIONITEMOBJECT::kSelf || data.object == RE::CONDITIONITEMOBJECT::kTarget );
+
+		// Actor values, combat and stance change from one hit to the next, engine items are unknown
+		switch( function )
+		{
+		case FunctionID::kHasKeyword:
+		case FunctionID::kGetIsRace:
+		case FunctionID::kGetIsSex:
+		case FunctionID::kGetIsID:
+		case FunctionID::kGetIsReference:
+		case FunctionID::kGetLevel:
+		case FunctionID::kGetEquippedItemType:
+			condition->isStable &= item.isNative && !data.flags.global;
+			break;
+
+		default:
+			condition->isStable = false;
+			break;
+		}
+
+		condition->items.push_back( item );
+	}
+
+	return condition;
+}
+
+bool NativeCondition::IsTrue( RE::TESObjectREFR* a_subject, RE::TESObjectREFR* a_target ) const
+{
+	// Short circuit inside a group once an item is true, and across groups once a group is false
+	bool isGroupTrue = false;
+	for( auto& item : items )
+	{
+		if( !isGroupTrue )
+			isGroupTrue = Evaluate( item, a_subject, a_target );
+
+		if( !item.isOR )
+		{
+			if( !isGroupTrue )
+				return false;
+
+			isGroupTrue = false;
+		}
+	}
+
+	// A trailing OR item closes the last group
+	return items.empty() || !items.back().isOR || isGroupTrue;
+}
+
+bool NativeCondition::Evaluate( const Item& a_item, RE::TESObjectREFR* a_subject, RE::TESObjectREFR* a_target ) const
+{
+	auto ref = a_item.isRunOnTarget ? a_target : a_subject;
+
+	float value;
+	if( !a_item.isNative || !ref || !EvaluateNative( a_item, ref, value ) )
+	{
+		RE::ConditionCheckParams params( a_subject, a_target );
+		return a_item.item->IsTrue( params );
+	}
+
+	auto& data = a_item.item->data;
+	float comparison = data.flags.global ? ( data.comparisonValue.g ? data.comparisonValue.g->value : 0 ) : data.comparisonValue.f;
+
+	bool result = false;
+	switch( a_item.opCode )
+	{
+	case OpCode::kEqualTo:				result = value == comparison; break;
+	case OpCode::kNotEqualTo:			result = value != comparison; break;
+	case OpCode::kGreaterThan:			result = value > comparison; break;
+	case OpCode::kGreaterThanOrEqualTo:	result = value >= comparison; break;
+	case OpCode::kLessThan:				result = value < comparison; break;
+	case OpCode::kLessThanOrEqualTo:	result = value <= comparison; break;
+	}
+
+#ifndef NDEBUG
+	RE::ConditionCheckParams params( a_subject, a_target );
+	if( result != a_item.item->IsTrue( params ) )
+		Diagnostics::Push( Diagnostics::kConditionMismatch, 0, GetFunctionName( a_item.function ) );
+#endif
+
+	return result;
+}
+
+// Function result of the condition item, false when it is not applicable to the reference and the engine must evaluate it
+bool NativeCondition::EvaluateNative( const Item& a_item, RE::TESObjectREFR* a_ref, float& a_value ) const
+{
+	switch( a_item.function )
+	{
+	case FunctionID::kHasKeyword:
+		a_value = a_item.param && a_ref->HasKeyword( static_cast<RE::BGSKeyword*>( a_item.param ) ) ? 1.0f : 0.0f;
+		return true;
+
+	case FunctionID::kGetIsID:
+		a_value = a_ref->GetBaseObject() == a_item.param ? 1.0f : 0.0f;
+		return true;
+
+	case FunctionID::kGetIsReference:
+		a_value = a_ref == a_item.param ? 1.0f : 0.0f;
+		return true;
+	}
+
+	auto actor = a_ref->As<RE::Actor>();
+	if( !actor )
+		return false;
+
+	switch( a_item.function )
+	{
+	case FunctionID::kGetIsRace:
+		a_value = actor->GetRace() == a_item.param ? 1.0f : 0.0f;
+		return true;
+
+	case FunctionID::kGetIsSex:
+		{
+			auto base = actor->GetActorBase();
+			if( !base )
+				return false;
+
+			a_value = base->GetSex() == (RE::SEX)(uintptr_t)a_item.param ? 1.0f : 0.0f;
+			return true;
+		}
+
+	case FunctionID::kGetActorValue:
+		a_value = actor->GetActorValue( (RE::ActorValue)(uintptr_t)a_item.param );
+		return true;
+
+	case FunctionID::kGetBaseActorValue:
+		a_value = actor->GetBaseActorValue( (RE::ActorValue)(uintptr_t)a_item.param );
+		return true;
+
+	case FunctionID::kGetLevel:
+		a_value = (float)actor->GetLevel();
+		return true;
+
+	case FunctionID::kIsSneaking:
+		a_value = actor->IsSneaking() ? 1.0f : 0.0f;
+		return true;
+
+	case FunctionID::kIsInCombat:
+		a_value = actor->IsInCombat() ? 1.0f : 0.0f;
+		return true;
+
+	case FunctionID::kIsWeaponOut:
+		a_value = actor->IsWeaponDrawn() ? 1.0f : 0.0f;
+		return true;
+
+	case FunctionID::kGetEquippedItemType:
+		{
+			// 0 fists, 1-8 weapon types up to staff, 9 spell, 10 shield, 11 torch, 12 crossbow
+			auto object = actor->GetEquippedObject( (uintptr_t)a_item.param == 0 );
+			if( !object )
+			{
+				a_value = 0;
+				return true;
+			}
+
+			if( auto weapon = object->As<RE::TESObjectWEAP>() )
+				a_value = weapon->GetWeaponType() == RE::WEAPON_TYPE::kCrossbow ? 12.0f : (float)weapon->GetWeaponType();
+			else if( object->Is( RE::FormType::Spell ) )
+				a_value = 9;
+			else if( object->Is( RE::FormType::Armor ) )
+				a_value = 10;
+			else if( object->Is( RE::FormType::Light ) )
+				a_value = 11;
+			else
+				return false;
+
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+// Load time translation of a perk condition (UsePerkCondition) into native predicates.
+// Items with a supported function run directly on the actor, anything else is evaluated by the engine item by item.
+// OR items are grouped with the next item like the Creation Kit: (A OR B) AND (C OR D).
+class NativeCondition
+{
+public:
+	struct Item
+	{
+		const RE::TESConditionItem*		item;
+		RE::FUNCTION_DATA::FunctionID	function;
+		void*							param = nullptr;
+		RE::CONDITION_ITEM_DATA::OpCode	opCode;
+		bool							isOR = false;
+		bool							isNative = false;
+		bool							isRunOnTarget = false;	// Subject is the target instead of the shooter
+	};
+
+	// Null when the condition must stay with the engine as a whole (it draws random numbers)
+	static std::unique_ptr<NativeCondition> Compile( const RE::TESCondition& a_condition );
+
+	bool IsTrue( RE::TESObjectREFR* a_subject, RE::TESObjectREFR* a_target ) const;
+
+	const std::vector<Item>& GetItems() const { return items; }
+
+	// Result only changes with equipment or active effects, which invalidate the filter memo
+	bool IsStable() const { return isStable; }
+
+	size_t GetNativeCount() const { return std::count_if( items.begin(), items.end(), []( auto& a_item ) { return a_item.isNative; } ); }
+
+	static std::string GetFunctionName( RE::FUNCTION_DATA::FunctionID a_function );
+
+private:
+	static bool IsSupported( RE::FUNCTION_DATA::FunctionID a_function );
+
+	bool Evaluate( const Item& a_item, RE::TESObjectREFR* a_subject, RE::TESObjectREFR* a_target ) const;
+	bool EvaluateNative( const Item& a_item, RE::TESObjectREFR* a_ref, float& a_value ) const;
+
+	std::vector<Item>	items;
+	bool				isStable = true;
+};
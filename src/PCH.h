@@ -1,5 +1,7 @@
 #pragma once
 
+#include "core/PCH.h"
+
 #pragma warning(push)
 #include <RE/Skyrim.h>
 #include <REL/Relocation.h>
@@ -12,7 +14,6 @@
 #endif
 
 #include <xbyak\xbyak.h>
-#include <SimpleIni.h>
 #pragma warning(pop)
 
 using namespace std::literals;
@@ -0,0 +1,88 @@
+#include "PlayerSkeleton.h"
+
+class PlayerSkeletonEventSink :
+	public RE::BSTEventSink<RE::TESEquipEvent>,
+	public RE::BSTEventSink<RE::TESObjectLoadedEvent>
+{
+public:
+	static PlayerSkeletonEventSink* GetSingleton()
+	{
+		static PlayerSkeletonEventSink singleton;
+		return &singleton;
+	}
+
+	RE::BSEventNotifyControl ProcessEvent( const RE::TESEquipEvent* a_event, RE::BSTEventSource<RE::TESEquipEvent>* ) override
+	{
+		if( a_event && a_event->actor && a_event->actor->IsPlayerRef() )
+			PlayerSkeleton::Invalidate();
+
+		return RE::BSEventNotifyControl::kContinue;
+	}
+
+	RE::BSEventNotifyControl ProcessEvent( const RE::TESObjectLoadedEvent* a_event, RE::BSTEventSource<RE::TESObjectLoadedEvent>* ) override
+	{
+		if( a_event && a_event->formID == 0x14 )
+			PlayerSkeleton::Release();
+
+		return RE::BSEventNotifyControl::kContinue;
+	}
+};
+
+void PlayerSkeleton::RegisterEvents()
+{
+	auto eventSource = RE::ScriptEventSourceHolder::GetSingleton();
+	if( !eventSource )
+		return;
+
+	eventSource->AddEventSink<RE::TESEquipEvent>( PlayerSkeletonEventSink::GetSingleton() );
+	eventSource->AddEventSink<RE::TESObjectLoadedEvent>( PlayerSkeletonEventSink::GetSingleton() );
+}
+
+void PlayerSkeleton::Release()
+{
+	for( auto& candidates : candidateSets )
+		candidates.store( nullptr, std::memory_order_release );
+}
+
+std::shared_ptr<const PlayerSkeleton::Candidates> PlayerSkeleton::Gather( RE::NiNode* a_root, const Settings::RuleSet& a_ruleSet )
+{
+	// The generation is read first, an equip event during the walk leaves the set stale
+	auto candidates = std::make_shared<Candidates>();
+	candidates->generation	= generation.load( std::memory_order_relaxed );
+	candidates->root		= RE::NiPointer<RE::NiNode>( a_root );
+	candidates->nodeMatches	= a_ruleSet.nodeMatches;
+	NodeSearch::CollectPlayerNodes<NiNodeAdapter>( a_root, a_ruleSet, candidates->nodes );
+
+	for( auto node : candidates->nodes.nodes )
+		candidates->references.emplace_back( node );
+
+	return candidates;
+}
+
+RE::NiNode* PlayerSkeleton::FindClosestHitNode( RE::NiNode* a_root, const RE::NiPoint3& a_pos, float& a_dist, const Settings::RuleSet& a_ruleSet )
+{
+	auto active = GetMode();
+	auto pos = ToPoint3( a_pos );
+
+	// The other set covers a 3D switch seen before its camera state hook
+	auto index = active;
+	for( auto candidateMode : { active, (Mode)( kModeCount - 1 - active ) } )
+	{
+		auto candidates = candidateSets[ candidateMode ].load( std::memory_order_acquire );
+		if( !candidates || candidates->root.get() != a_root )
+			continue;
+
+		if( candidates->IsValid( a_root, a_ruleSet ) )
+			return NodeSearch::FindClosestPlayerNode<NiNodeAdapter>( candidates->nodes, pos, a_dist );
+
+		index = candidateMode;
+		break;
+	}
+
+	// New tree, rule set or equipment: the set of this tree is gathered again, concurrent hits may both do it
+	auto candidates = Gather( a_root, a_ruleSet );
+	auto closest = NodeSearch::FindClosestPlayerNode<NiNodeAdapter>( candidates->nodes, pos, a_dist );
+	candidateSets[ index ].store( std::move( candidates ), std::memory_order_release );
+
+	return closest;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Utils.h"
+#include "Settings.h"
+
+// Hit node candidates of the player, one set per camera mode. The player has no hit box in first person, so its nodes
+// are chosen by the player node pattern instead ('[Settings] PlayerNodes'), and each camera mode shows its own tree.
+// A set is gathered by the first player hit after the tree, the rule set or the equipment changed and published as an
+// immutable snapshot: later hits measure a few distances instead of walking the whole tree. The snapshots are
+// std::atomic<std::shared_ptr>, which takes a short internal lock on MSVC, not lock-free.
+class PlayerSkeleton
+{
+public:
+	enum Mode : uint32_t
+	{
+		kThirdPerson,
+		kFirstPerson,
+
+		kModeCount
+	};
+
+	// Camera state hooks, main thread
+	static void OnCameraState( Mode a_mode ) { mode.store( a_mode, std::memory_order_relaxed ); }
+
+	static Mode GetMode() { return mode.load( std::memory_order_relaxed ); }
+
+	// Same result as NodeSearch::FindClosestHitNode for the player over a_root, its current 3D. Any thread.
+	// Reads the tree like that search does, the set of a_root is gathered again when it is missing or stale.
+	static RE::NiNode* FindClosestHitNode( RE::NiNode* a_root, const RE::NiPoint3& a_pos, float& a_dist, const Settings::RuleSet& a_ruleSet );
+
+	// Equipping attaches and detaches nodes, possibly after the event: both sets are gathered again by the next hit
+	static void Invalidate() { generation.fetch_add( 1, std::memory_order_relaxed ); }
+
+	// A new or unloaded 3D drops both sets, so they do not keep the old tree alive
+	static void Release();
+
+	// Event sources are available once data is loaded
+	static void RegisterEvents();
+
+private:
+	struct Candidates
+	{
+		RE::NiPointer<RE::NiNode>					root;			// Tree the candidates come from
+		std::vector<RE::NiPointer<RE::NiNode>>		references;		// Candidates stay alive while the set is loaded
+		std::shared_ptr<const NodeMatchCache>		nodeMatches;	// Rule set whose patterns chose them
+		uint32_t									generation = 0;
+		NodeSearch::PlayerNodes<RE::NiNode>			nodes;
+
+		bool IsValid( RE::NiNode* a_root, const Settings::RuleSet& a_ruleSet ) const
+		{
+			return root.get() == a_root && nodeMatches == a_ruleSet.nodeMatches && generation == PlayerSkeleton::generation.load( std::memory_order_relaxed ) && IsAttached();
+		}
+
+		// Every candidate still hangs below the root, a node detached after the gathering makes the set stale
+		bool IsAttached() const
+		{
+			for( auto node : nodes.nodes )
+			{
+				auto parent = node->parent;
+				while( parent && parent != root.get() )
+					parent = parent->parent;
+
+				if( !parent )
+					return false;
+			}
+
+			return true;
+		}
+	};
+
+	static std::shared_ptr<const Candidates> Gather( RE::NiNode* a_root, const Settings::RuleSet& a_ruleSet );
+
+	static inline std::atomic<Mode>													mode = kThirdPerson;
+	static inline std::atomic<uint32_t>												generation = 1;
+	static inline std::array<std::atomic<std::shared_ptr<const Candidates>>, kModeCount>	candidateSets;		// Indexed by mode
+};
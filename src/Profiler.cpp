@@ -0,0 +1,277 @@
+#include "Profiler.h"
+
+namespace Profiler
+{
+	struct Span
+	{
+		const char*	name;
+		uint64_t	begin;
+		uint64_t	end;
+	};
+
+	struct TraceBuffer
+	{
+		std::array<Span, kTraceCapacity>	spans;
+		std::atomic<uint64_t>				head = 0;	// Total spans written, the ring index is head % capacity
+	};
+
+	using RuleCounters = std::array<std::array<std::atomic<uint64_t>, (size_t)RuleCounter::kTotal>, kMaxRules>;
+
+	struct ThreadHistograms
+	{
+		std::array<Histogram, (size_t)Stage::kTotal>	stages;
+		std::atomic<TraceBuffer*>						trace = nullptr;	// Allocated on the first traced span
+		std::atomic<RuleCounters*>						rules = nullptr;	// Allocated on the first rule evaluation
+		uint32_t										threadIndex = 0;
+	};
+
+	// Histograms are registered once per thread and never released, game threads live for the whole session
+	static std::mutex						registryMutex;
+	static std::vector<ThreadHistograms*>	registry;
+
+	static ThreadHistograms& GetThreadHistograms()
+	{
+		thread_local ThreadHistograms* histograms = nullptr;
+		if( !histograms )
+		{
+			histograms = new ThreadHistograms;
+
+			std::lock_guard<std::mutex> lock( registryMutex );
+			histograms->threadIndex = (uint32_t)registry.size();
+			registry.push_back( histograms );
+		}
+
+		return *histograms;
+	}
+
+	void Record( Stage a_stage, uint64_t a_nanoseconds )
+	{
+		GetThreadHistograms().stages[ (size_t)a_stage ].Record( a_nanoseconds );
+	}
+
+	Summary GetSummary( Stage a_stage )
+	{
+		std::array<uint64_t, Histogram::kBuckets> buckets{};
+		Summary summary;
+
+		{
+			std::lock_guard<std::mutex> lock( registryMutex );
+			for( auto histograms : registry )
+				histograms->stages[ (size_t)a_stage ].MergeInto( buckets, summary.max );
+		}
+
+		for( auto count : buckets )
+			summary.count += count;
+
+		if( summary.count == 0 )
+			return summary;
+
+		auto percentile = [ & ]( double a_percent )
+		{
+			auto target = (uint64_t)std::ceil( summary.count * a_percent );
+			uint64_t accumulated = 0;
+			for( uint32_t i = 0; i < Histogram::kBuckets; ++i )
+			{
+				accumulated += buckets[ i ];
+				if( accumulated >= target )
+					return std::min<uint64_t>( Histogram::GetBucketValue( i ), summary.max );
+			}
+
+			return summary.max;
+		};
+
+		summary.p50 = percentile( 0.50 );
+		summary.p99 = percentile( 0.99 );
+
+		return summary;
+	}
+
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock( registryMutex );
+		for( auto histograms : registry )
+		{
+			for( auto& histogram : histograms->stages )
+				histogram.Reset();
+		}
+	}
+}
+
+namespace Profiler
+{
+	void StartTrace()
+	{
+		{
+			std::lock_guard<std::mutex> lock( registryMutex );
+			for( auto histograms : registry )
+			{
+				auto trace = histograms->trace.load( std::memory_order_acquire );
+				if( trace )
+					trace->head.store( 0, std::memory_order_relaxed );
+			}
+		}
+
+		isTracing = true;
+	}
+
+	void TraceSpan( const char* a_name, uint64_t a_begin, uint64_t a_end )
+	{
+		auto& histograms = GetThreadHistograms();
+
+		auto trace = histograms.trace.load( std::memory_order_relaxed );
+		if( !trace )
+		{
+			trace = new TraceBuffer;
+			histograms.trace.store( trace, std::memory_order_release );
+		}
+
+		// Single writer, publish the span by advancing head after it is written
+		auto head = trace->head.load( std::memory_order_relaxed );
+		trace->spans[ head % kTraceCapacity ] = { a_name, a_begin, a_end };
+		trace->head.store( head + 1, std::memory_order_release );
+	}
+
+	bool StopTrace( const std::filesystem::path& a_path, size_t& a_spanCount )
+	{
+		isTracing = false;
+		a_spanCount = 0;
+
+		std::ofstream file( a_path, std::ios::trunc );
+		if( !file )
+			return false;
+
+		// Timestamps are relative to the earliest span, in microseconds
+		std::lock_guard<std::mutex> lock( registryMutex );
+
+		uint64_t origin = UINT64_MAX;
+		for( auto histograms : registry )
+		{
+			auto trace = histograms->trace.load( std::memory_order_acquire );
+			if( !trace )
+				continue;
+
+			auto head = trace->head.load( std::memory_order_acquire );
+			for( auto i = head > kTraceCapacity ? head - kTraceCapacity : 0; i < head; ++i )
+			{
+				if( trace->spans[ i % kTraceCapacity ].begin < origin )
+					origin = trace->spans[ i % kTraceCapacity ].begin;
+			}
+		}
+
+		file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+		bool isFirst = true;
+		for( auto histograms : registry )
+		{
+			auto trace = histograms->trace.load( std::memory_order_acquire );
+			if( !trace )
+				continue;
+
+			auto head = trace->head.load( std::memory_order_acquire );
+			for( auto i = head > kTraceCapacity ? head - kTraceCapacity : 0; i < head; ++i )
+			{
+				auto& span = trace->spans[ i % kTraceCapacity ];
+				file << ( isFirst ? "\n" : ",\n" ) << fmt::format( "{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+					span.name, histograms->threadIndex, ( span.begin - origin ) / 1000.0, ( span.end - span.begin ) / 1000.0 );
+
+				isFirst = false;
+				++a_spanCount;
+			}
+		}
+
+		file << "\n]}\n";
+
+		return (bool)file;
+	}
+}
+
+namespace Profiler
+{
+	void RecordRule( uint32_t a_rule, RuleCounter a_counter, uint64_t a_value )
+	{
+		if( a_rule >= kMaxRules )
+			return;
+
+		auto& histograms = GetThreadHistograms();
+
+		auto rules = histograms.rules.load( std::memory_order_relaxed );
+		if( !rules )
+		{
+			rules = new RuleCounters{};
+			histograms.rules.store( rules, std::memory_order_release );
+		}
+
+		// Single writer, same as the histograms
+		auto& counter = ( *rules )[ a_rule ][ (size_t)a_counter ];
+		counter.store( counter.load( std::memory_order_relaxed ) + a_value, std::memory_order_relaxed );
+	}
+
+	std::array<uint64_t, (size_t)RuleCounter::kTotal> GetRuleCounters( uint32_t a_rule )
+	{
+		std::array<uint64_t, (size_t)RuleCounter::kTotal> counters{};
+		if( a_rule >= kMaxRules )
+			return counters;
+
+		std::lock_guard<std::mutex> lock( registryMutex );
+		for( auto histograms : registry )
+		{
+			auto rules = histograms->rules.load( std::memory_order_acquire );
+			if( !rules )
+				continue;
+
+			for( size_t i = 0; i < counters.size(); ++i )
+				counters[ i ] += ( *rules )[ a_rule ][ i ].load( std::memory_order_relaxed );
+		}
+
+		return counters;
+	}
+
+	void ResetRules()
+	{
+		std::lock_guard<std::mutex> lock( registryMutex );
+		for( auto histograms : registry )
+		{
+			auto rules = histograms->rules.load( std::memory_order_acquire );
+			if( !rules )
+				continue;
+
+			for( auto& rule : *rules )
+			{
+				for( auto& counter : rule )
+					counter.store( 0, std::memory_order_relaxed );
+			}
+		}
+	}
+
+	bool WriteRuleCSV( const std::filesystem::path& a_path, const std::vector<std::string>& a_ruleIDs )
+	{
+		std::ofstream file( a_path, std::ios::trunc );
+		if( !file )
+			return false;
+
+		file << "Index,ID";
+		for( auto name : kRuleCounterNames )
+			file << ',' << name;
+
+		file << ",AverageNanoseconds\n";
+
+		for( uint32_t i = 0; i < a_ruleIDs.size() && i < kMaxRules; ++i )
+		{
+			auto counters = GetRuleCounters( i );
+
+			// IDs come from the INI section names, quote them in case they contain a comma
+			std::string id = a_ruleIDs[ i ];
+			for( size_t quote = id.find( '"' ); quote != std::string::npos; quote = id.find( '"', quote + 2 ) )
+				id.insert( quote, 1, '"' );
+
+			file << i << ",\"" << id << '"';
+			for( auto value : counters )
+				file << ',' << value;
+
+			auto evaluated = counters[ (size_t)RuleCounter::kEvaluated ];
+			file << ',' << ( evaluated ? counters[ (size_t)RuleCounter::kNanoseconds ] / evaluated : 0 ) << '\n';
+		}
+
+		return (bool)file;
+	}
+}
@@ -0,0 +1,274 @@
+#pragma once
+
+// Hot path latency histograms and span tracing, enabled with the ALD_ENABLE_PROFILING build option.
+// Each thread records into its own log-linear histograms (8 sub-buckets per power of two, 12.5% resolution)
+// without locking. Readers merge all threads on demand.
+// While tracing is started, timed scopes are also written as spans into a per-thread ring buffer
+// that is exported in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+namespace Profiler
+{
+	enum class Stage : uint32_t
+	{
+		kApplyLocationalDamage,
+		kHitNode,
+		kRuleMatch,
+		kFilter,
+		kPerkCondition,
+		kEffectCast,
+		kNotification,
+		kExperience,
+		kHandleProjectileAttack,
+		kSideEffects,
+		kBatchScan,
+		kBatchApply,
+
+		kTotal
+	};
+
+	static constexpr const char* kStageNames[] = {
+		"ApplyLocationalDamage",
+		"HitNode",
+		"RuleMatch",
+		"Filter",
+		"PerkCondition",
+		"EffectCast",
+		"Notification",
+		"Experience",
+		"HandleProjectileAttack",
+		"SideEffects",
+		"BatchScan",
+		"BatchApply",
+	};
+	static_assert( std::size( kStageNames ) == (size_t)Stage::kTotal );
+
+	struct Summary
+	{
+		uint64_t	count = 0;
+		uint64_t	p50 = 0;
+		uint64_t	p99 = 0;
+		uint64_t	max = 0;
+	};
+
+	class Histogram
+	{
+	public:
+		static constexpr uint32_t kSubBucketBits = 3;
+		static constexpr uint32_t kSubBuckets = 1 << kSubBucketBits;
+		static constexpr uint32_t kBuckets = ( 64 - kSubBucketBits + 1 ) * kSubBuckets;
+
+		static uint32_t GetBucket( uint64_t a_value )
+		{
+			if( a_value < kSubBuckets )
+				return (uint32_t)a_value;
+
+			uint32_t shift = (uint32_t)std::bit_width( a_value ) - 1 - kSubBucketBits;
+			return ( shift + 1 ) * kSubBuckets + (uint32_t)( ( a_value >> shift ) & ( kSubBuckets - 1 ) );
+		}
+
+		// Middle of the bucket value range
+		static uint64_t GetBucketValue( uint32_t a_bucket )
+		{
+			if( a_bucket < kSubBuckets )
+				return a_bucket;
+
+			uint32_t shift = a_bucket / kSubBuckets - 1;
+			uint64_t lower = (uint64_t)( kSubBuckets + a_bucket % kSubBuckets ) << shift;
+			return lower + ( ( 1ull << shift ) >> 1 );
+		}
+
+		// Single writer, relaxed load/store is enough and avoids locked instructions
+		void Record( uint64_t a_value )
+		{
+			auto& bucket = buckets[ GetBucket( a_value ) ];
+			bucket.store( bucket.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+
+			if( a_value > max.load( std::memory_order_relaxed ) )
+				max.store( a_value, std::memory_order_relaxed );
+		}
+
+		void MergeInto( std::array<uint64_t, kBuckets>& a_buckets, uint64_t& a_max ) const
+		{
+			for( uint32_t i = 0; i < kBuckets; ++i )
+				a_buckets[ i ] += buckets[ i ].load( std::memory_order_relaxed );
+
+			a_max = std::max<uint64_t>( a_max, max.load( std::memory_order_relaxed ) );
+		}
+
+		void Reset()
+		{
+			for( auto& bucket : buckets )
+				bucket.store( 0, std::memory_order_relaxed );
+
+			max.store( 0, std::memory_order_relaxed );
+		}
+
+	private:
+		std::array<std::atomic<uint64_t>, kBuckets>	buckets{};
+		std::atomic<uint64_t>						max = 0;
+	};
+
+	void Record( Stage a_stage, uint64_t a_nanoseconds );
+
+	// Merge every thread's histogram of a stage
+	Summary GetSummary( Stage a_stage );
+
+	void Reset();
+
+	static constexpr uint32_t kTraceCapacity = 1 << 14;	// Spans kept per thread, oldest are overwritten
+
+	inline std::atomic<bool> isTracing = false;
+
+	void StartTrace();
+
+	// Stop recording and write the spans of all threads to a Chrome trace JSON file
+	bool StopTrace( const std::filesystem::path& a_path, size_t& a_spanCount );
+
+	void TraceSpan( const char* a_name, uint64_t a_begin, uint64_t a_end );
+
+	static uint64_t Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+	}
+
+	// Per rule evaluation counters, indexed by the rule position in the published rule set
+	enum class RuleCounter : uint32_t
+	{
+		kEvaluated,
+		kMatched,
+		kChancePassed,
+		kTargetPassed,
+		kTargetFailed,
+		kShooterPassed,
+		kShooterFailed,
+		kConditionPassed,
+		kConditionFailed,
+		kTriggered,
+		kMemoHit,
+		kNanoseconds,
+
+		kTotal
+	};
+
+	static constexpr const char* kRuleCounterNames[] = {
+		"Evaluated",
+		"Matched",
+		"ChancePassed",
+		"TargetPassed",
+		"TargetFailed",
+		"ShooterPassed",
+		"ShooterFailed",
+		"ConditionPassed",
+		"ConditionFailed",
+		"Triggered",
+		"MemoHit",
+		"Nanoseconds",
+	};
+	static_assert( std::size( kRuleCounterNames ) == (size_t)RuleCounter::kTotal );
+
+	static constexpr uint32_t kMaxRules = 1024;	// Rules past this index are not counted
+
+	void RecordRule( uint32_t a_rule, RuleCounter a_counter, uint64_t a_value = 1 );
+
+	// Merge every thread's counters of a rule
+	std::array<uint64_t, (size_t)RuleCounter::kTotal> GetRuleCounters( uint32_t a_rule );
+
+	void ResetRules();
+
+	// Write one CSV line per rule, a_ruleIDs gives the ID column and the number of rules
+	bool WriteRuleCSV( const std::filesystem::path& a_path, const std::vector<std::string>& a_ruleIDs );
+
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer( Stage a_stage ) :
+			stage( a_stage ), start( Now() ) {}
+
+		~ScopedTimer()
+		{
+			auto end = Now();
+			Record( stage, end - start );
+
+			if( isTracing.load( std::memory_order_relaxed ) )
+				TraceSpan( kStageNames[ (size_t)stage ], start, end );
+		}
+
+	private:
+		Stage		stage;
+		uint64_t	start;
+	};
+
+	// Span without a histogram, for hooks and lock waits
+	class ScopedSpan
+	{
+	public:
+		ScopedSpan( const char* a_name ) :
+			name( a_name ), start( isTracing.load( std::memory_order_relaxed ) ? Now() : 0 ) {}
+
+		~ScopedSpan()
+		{
+			if( start && isTracing.load( std::memory_order_relaxed ) )
+				TraceSpan( name, start, Now() );
+		}
+
+	private:
+		const char*	name;
+		uint64_t	start;
+	};
+}
+
+namespace Profiler
+{
+	// Counts the predicates of one rule evaluation and its elapsed time until Stop()
+	class RuleScope
+	{
+	public:
+#ifdef ALD_ENABLE_PROFILING
+		RuleScope( uint32_t a_rule ) :
+			rule( a_rule ), start( Now() )
+		{
+			RecordRule( rule, RuleCounter::kEvaluated );
+		}
+
+		~RuleScope() { Stop(); }
+
+		void Count( RuleCounter a_counter ) { RecordRule( rule, a_counter ); }
+
+		void Stop()
+		{
+			if( start )
+			{
+				RecordRule( rule, RuleCounter::kNanoseconds, Now() - start );
+				start = 0;
+			}
+		}
+
+	private:
+		uint32_t	rule;
+		uint64_t	start;
+#else
+		RuleScope( uint32_t ) {}
+
+		void Count( RuleCounter ) {}
+		void Stop() {}
+#endif
+	};
+
+	// Counter of a rule decided outside its RuleScope, like a batched rule triggered in the apply phase
+	inline void CountRule( [[maybe_unused]] uint32_t a_rule, [[maybe_unused]] RuleCounter a_counter )
+	{
+#ifdef ALD_ENABLE_PROFILING
+		RecordRule( a_rule, a_counter );
+#endif
+	}
+}
+
+#define ALD_PROFILE_CONCAT_IMPL( a, b ) a##b
+#define ALD_PROFILE_CONCAT( a, b ) ALD_PROFILE_CONCAT_IMPL( a, b )
+
+#ifdef ALD_ENABLE_PROFILING
+#	define ALD_PROFILE_SCOPE( stage ) Profiler::ScopedTimer ALD_PROFILE_CONCAT( profileScope, __LINE__ )( Profiler::Stage::stage )
+#	define ALD_TRACE_SCOPE( name ) Profiler::ScopedSpan ALD_PROFILE_CONCAT( traceScope, __LINE__ )( name )
+#else
+#	define ALD_PROFILE_SCOPE( stage )
+#	define ALD_TRACE_SCOPE( name )
+#endif
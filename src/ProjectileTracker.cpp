@@ -0,0 +1,53 @@
+#include "ProjectileTracker.h"
+
+extern unsigned long long g_PerformanceFrequency;
+
+float ProjectileTracker::Launch::GetFlightTime() const
+{
+	unsigned long long now;
+	QueryPerformanceCounter( (LARGE_INTEGER*)&now );
+
+	return (float)( now - timestamp ) / g_PerformanceFrequency;
+}
+
+void ProjectileTracker::OnUpdate( RE::Projectile* a_projectile )
+{
+	// Only a projectile that has not moved yet is launched, stuck arrows keep updating after their impact.
+	// A new projectile at the address of one that was never released replaces its launch here.
+	if( a_projectile->formType != RE::FormType::ProjectileArrow || a_projectile->distanceMoved != 0 )
+		return;
+
+	auto& entry = slots[ Hash( a_projectile ) ];
+
+	// A slot being read by an impact is left alone, the projectile is then reconstructed at its own impact
+	auto owner = entry.projectile.load( std::memory_order_relaxed );
+	do
+	{
+		if( owner == kBusy )
+			return;
+	} while( !entry.projectile.compare_exchange_weak( owner, kBusy, std::memory_order_acquire, std::memory_order_relaxed ) );
+
+	entry.formID			= a_projectile->GetFormID();
+	entry.launch.position	= a_projectile->GetPosition();
+	QueryPerformanceCounter( (LARGE_INTEGER*)&entry.launch.timestamp );
+
+	entry.projectile.store( a_projectile, std::memory_order_release );
+}
+
+bool ProjectileTracker::Release( RE::Projectile* a_projectile, Launch& a_launch )
+{
+	auto& entry = slots[ Hash( a_projectile ) ];
+
+	auto owner = a_projectile;
+	if( !entry.projectile.compare_exchange_strong( owner, kBusy, std::memory_order_acquire, std::memory_order_relaxed ) )
+		return false;
+
+	// A launch left by a projectile that was deleted without impact is dropped
+	bool isOwner = entry.formID == a_projectile->GetFormID();
+	if( isOwner )
+		a_launch = entry.launch;
+
+	entry.projectile.store( nullptr, std::memory_order_release );
+
+	return isOwner;
+}
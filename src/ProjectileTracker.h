@@ -0,0 +1,50 @@
+#pragma once
+
+// Records projectile launch data from the projectile update hook so the impact does not
+// need to reconstruct it from Projectile::lifeRemaining and Projectile::distanceMoved.
+// A projectile is recorded by the update that launches it, in a slot chosen by its address. The slot also keeps
+// the form ID, so a projectile created at the address of one that was never released does not get its launch.
+// A newer projectile overwrites such a slot, deleted or unloaded projectiles need no expiry.
+class ProjectileTracker
+{
+public:
+	struct Launch
+	{
+		RE::NiPoint3		position;
+		unsigned long long	timestamp = 0;	// QueryPerformanceCounter at launch
+
+		// Real time since the launch, slow time and pauses included
+		float GetFlightTime() const;
+	};
+
+	static constexpr uint32_t kCapacity = 1024;
+
+	// Called on every projectile update, records the projectile on the update that launches it.
+	// Other updates only read the projectile. Any thread.
+	static void OnUpdate( RE::Projectile* a_projectile );
+
+	// Remove the projectile from the registry and return its launch data if it was tracked.
+	// False when the slot holds another projectile, the launch is then unknown.
+	static bool Release( RE::Projectile* a_projectile, Launch& a_launch );
+
+private:
+	struct Entry
+	{
+		std::atomic<RE::Projectile*>	projectile = nullptr;	// Owner of the launch, kBusy while it is written or read
+		RE::FormID						formID = 0;				// Of the owner, tells apart projectiles created at the same address
+		Launch							launch;
+	};
+
+	static inline RE::Projectile* const kBusy = reinterpret_cast<RE::Projectile*>( 1 );
+
+	static uint32_t Hash( RE::Projectile* a_projectile )
+	{
+		auto key = (uint64_t)a_projectile;
+		key ^= key >> 33;
+		key *= 0xFF51AFD7ED558CCD;
+		key ^= key >> 33;
+		return (uint32_t)key & ( kCapacity - 1 );
+	}
+
+	static inline std::array<Entry, kCapacity>	slots;
+};
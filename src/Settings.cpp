@@ -1,159 +1,161 @@
 #include "Utils.h"
 #include "Settings.h"
+#include "core/BinaryArchive.h"
 
-std::vector<Settings::Location> g_LocationalDamageSettings;
-
-bool g_bDebugNotification = true;
-bool g_bPlayerNotification = true;
-bool g_bPlayerHitSound = true;
-bool g_bEffectChanceCap = true;
-bool g_bAmplifyEnchantment = true;
 bool g_bEnableFloatingText = true;
-bool g_bHitEffectNotification = true;
-bool g_bNPCFloatingNotification = false;
-bool g_bIgnoreHitboxCheck = false;
-bool g_bEnableDifficultyBonus = true;
-bool g_bEnableLocationMultiplier = true;
-float g_fShotDifficultyTimeFactor = 1;
-float g_fShotDifficultyDistFactor = 1;
-float g_fShotDifficultyMoveFactor = 1;
-float g_fShotDifficultyMax = 15.0f;
-float g_fShotDifficultyReportMin = 1.1f;
-float g_fHPFactor = 0.25f;
-float g_fFloatingOffsetX = 0;
-float g_fFloatingOffsetY = 0.04f;
-long g_nNotificationMode = NotificationMode::Floating;
-long g_nEXPNotificationMode = NotificationMode::Screen;
-std::regex g_sExcludeRegexp;
-std::regex g_PlayerNodes;
+
+static constexpr auto	kIniPath		= L"Data/SKSE/Plugins/ArcheryLocationalDamage.ini";
+static constexpr auto	kCachePath		= L"Data/SKSE/Plugins/ArcheryLocationalDamage.cache";
+static constexpr uint32_t kCacheMagic	= 0x43444C41;	// "ALDC"
+static constexpr uint32_t kCacheVersion	= 8;	// Increase when the serialized layout changes
+
+static std::mutex		publishMutex;
+static uint32_t			lastGeneration = 0;
 
 void Settings::Load()
 {
-	CSimpleIniA iniFile;
-	iniFile.SetUnicode();
-	iniFile.SetMultiKey();
-	iniFile.LoadFile( L"Data/SKSE/Plugins/ArcheryLocationalDamage.ini" );
-
-	if( iniFile.GetLongValue( "Version", "Major", 1 ) < 2 )
-		stl::report_and_fail( "You are using an old version of the INI file. Please download the new version or read the mod description page on how to upgrade the INI to the new version before continuing." );
-
-	g_bEnableLocationMultiplier		= iniFile.GetBoolValue( "Experience", "EnableLocationMultiplier", g_bEnableLocationMultiplier );
-	g_bEnableDifficultyBonus		= iniFile.GetBoolValue( "Experience", "EnableDifficultyBonus", g_bEnableDifficultyBonus );
-	g_fShotDifficultyTimeFactor		= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyTimeFactor", g_fShotDifficultyTimeFactor );
-	g_fShotDifficultyDistFactor		= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyDistFactor", g_fShotDifficultyDistFactor );
-	g_fShotDifficultyMoveFactor		= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyMoveFactor", g_fShotDifficultyMoveFactor );
-	g_fShotDifficultyMax			= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyMax", g_fShotDifficultyMax );
-	g_fShotDifficultyReportMin		= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyReportMin", g_fShotDifficultyReportMin );
-
-	g_bDebugNotification			= iniFile.GetBoolValue( "Settings", "DebugNotification", g_bDebugNotification );
-	g_bPlayerNotification			= iniFile.GetBoolValue( "Settings", "PlayerHitNotification", g_bPlayerNotification );
-	g_bPlayerHitSound				= iniFile.GetBoolValue( "Settings", "PlayerHitSound", g_bPlayerHitSound );
-	g_nNotificationMode				= iniFile.GetLongValue( "Settings", "HitNotificationMode", g_nNotificationMode );
-	g_nEXPNotificationMode			= iniFile.GetLongValue( "Settings", "EXPNotificationMode", g_nEXPNotificationMode );
-	g_bHitEffectNotification		= iniFile.GetBoolValue( "Settings", "HitEffectNotification", g_bHitEffectNotification );
-	g_bNPCFloatingNotification		= iniFile.GetBoolValue( "Settings", "NPCHitNotification", g_bNPCFloatingNotification );
-	g_bIgnoreHitboxCheck			= iniFile.GetBoolValue( "Settings", "IgnoreHitboxCheck", g_bIgnoreHitboxCheck );
-	g_sExcludeRegexp				= iniFile.GetValue( "Settings", "LocationExclude", "" );
-	g_PlayerNodes					= iniFile.GetValue( "Settings", "PlayerNodeInclude", ".*" );
-	g_fHPFactor						= (float)iniFile.GetDoubleValue( "Settings", "HPFactor", 25 ) / 100.0f;
-	g_bEffectChanceCap				= iniFile.GetBoolValue( "Settings", "HPFactorCap", g_bEffectChanceCap );
-	g_bAmplifyEnchantment			= iniFile.GetBoolValue( "Settings", "AmplifyEnchantment", g_bAmplifyEnchantment );
-	g_fFloatingOffsetX				= (float)iniFile.GetDoubleValue( "Settings", "FloatingTextOffsetX", g_fFloatingOffsetX );
-	g_fFloatingOffsetY				= (float)iniFile.GetDoubleValue( "Settings", "FloatingTextOffsetY", g_fFloatingOffsetY );
-
-	// Sort section priority by their number
-	std::list<CSimpleIni::Entry> sectionList;
-	std::regex sectionRegex( "Location([0-9]+)" );
-	iniFile.GetAllSections( sectionList );
-	sectionList.sort( [ sectionRegex ]( const CSimpleIni::Entry& x, const CSimpleIni::Entry& y )
-		{
-			std::cmatch match_x, match_y;
-			std::regex_match( x.pItem, match_x, sectionRegex );
-			std::regex_match( y.pItem, match_y, sectionRegex );
+	try
+	{
+		Publish( Build() );
+	}
+	catch( std::exception& e )
+	{
+		stl::report_and_fail( e.what() );
+	}
+}
+
+std::unique_ptr<Settings::RuleSet> Settings::Build()
+{
+	using clock = std::chrono::steady_clock;
+	auto elapsedMs = []( clock::time_point a_start ) { return std::chrono::duration<float, std::milli>( clock::now() - a_start ).count(); };
+
+	auto ruleSet = std::make_unique<RuleSet>();
+
+	auto start = clock::now();
+	auto iniData = ReadIni();
+	auto iniHash = HashFNV1a( iniData.data(), iniData.size() );
+	float readTime = elapsedMs( start );
+
+	// Keys missing from the INI take their default, never the value of the rule set being replaced
+	start = clock::now();
+	auto& options = ruleSet->options;
+	bool isCached = LoadCache( kCachePath, iniHash, options, *ruleSet );
+	if( !isCached )
+		RuleCompiler::Parse( std::move( iniData ), *ruleSet, options );
+
+	float parseTime = elapsedMs( start );
+
+	start = clock::now();
+	ruleSet->CompilePatterns();
+	float compileTime = elapsedMs( start );
+
+	start = clock::now();
+	if( !isCached )
+		SaveCache( kCachePath, iniHash, options, *ruleSet );
+
+	float saveTime = elapsedMs( start );
+
+	logger::info( "Settings loaded {} ({} locations): read {:0.2f} ms, {} {:0.2f} ms, compile {:0.2f} ms, cache write {:0.2f} ms",
+		isCached ? "from cache" : "from INI", ruleSet->locations.size(), readTime, isCached ? "cache read" : "parse", parseTime, compileTime, saveTime );
 
-			return atoi( match_x[1].str().c_str() ) < atoi( match_y[1].str().c_str() );
-		});
+	return ruleSet;
+}
+
+std::string Settings::ReadIni()
+{
+	std::string iniData;
+	std::ifstream iniStream( kIniPath, std::ios::binary );
+	if( iniStream )
+		iniData.assign( std::istreambuf_iterator<char>( iniStream ), std::istreambuf_iterator<char>() );
+
+	return iniData;
+}
 
-	for( auto& sectionIter : sectionList )
+void Settings::Publish( std::unique_ptr<RuleSet> a_ruleSet )
+{
+	std::lock_guard<std::mutex> lock( publishMutex );
+
+	// The previous set is freed by whoever releases it last, a hit or a queued side effect
+	a_ruleSet->generation = ++lastGeneration;
+	currentRuleSet.store( std::shared_ptr<const RuleSet>( std::move( a_ruleSet ) ), std::memory_order_release );
+}
+
+template <class Archive>
+void Settings::Serialize( Archive& a_ar, RuleCompiler::Options& a_options, RuleSet& a_ruleSet )
+{
+	a_options.Serialize( a_ar );
+	a_ar( a_ruleSet );
+}
+
+bool Settings::LoadCache( const wchar_t* a_path, uint64_t a_iniHash, RuleCompiler::Options& a_options, RuleSet& a_ruleSet )
+{
+	auto file = CreateFileW( a_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	bool isLoaded = false;
+	LARGE_INTEGER fileSize;
+	auto mapping = CreateFileMappingW( file, NULL, PAGE_READONLY, 0, 0, NULL );
+	if( mapping && GetFileSizeEx( file, &fileSize ) )
 	{
-		if( std::regex_match( sectionIter.pItem, sectionRegex ) )
+		auto view = (const uint8_t*)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+		if( view )
 		{
-			Location setting;
-
-			setting.id					= sectionIter.pItem;
-			setting.shouldContinue		= iniFile.GetBoolValue( sectionIter.pItem, "Continue", false );
-			setting.damageMult			= (float)iniFile.GetDoubleValue( sectionIter.pItem, "Multiplier", 1.0 );
-			setting.difficulty			= (float)iniFile.GetDoubleValue( sectionIter.pItem, "Difficulty", setting.damageMult );
-			setting.successHPFactor		= (float)iniFile.GetDoubleValue( sectionIter.pItem, "SuccessHPFactor", 0 ) / 100.0f;
-			setting.successChance		= iniFile.GetLongValue( sectionIter.pItem, "SuccessChance", 100 );
-			setting.successHPFactorCap	= iniFile.GetBoolValue( sectionIter.pItem, "SuccessHPFactorCap", true );
-			setting.floatingColorEnemy	= iniFile.GetLongValue( sectionIter.pItem, "FloatingColorEnemy", 0xFF8000 );
-			setting.floatingColorSelf	= iniFile.GetLongValue( sectionIter.pItem, "FloatingColorSelf", 0xFF4040 );
-			setting.floatingSize		= iniFile.GetLongValue( sectionIter.pItem, "FloatingTextSize", 24 );
-			setting.deflectProjectile	= iniFile.GetBoolValue( sectionIter.pItem, "Deflect", false );
-			setting.impactData			= iniFile.GetValue( sectionIter.pItem, "ImpactData", "" );
-			setting.message				= iniFile.GetValue( sectionIter.pItem, "Message", "" );
-			setting.messageFloating		= iniFile.GetValue( sectionIter.pItem, "MessageFloating", "" );
-			setting.sound				= iniFile.GetValue( sectionIter.pItem, "HitSound", "" );
-			auto regexp					= iniFile.GetValue( sectionIter.pItem, "Regexp", "" );
-
-			// Copy condition from perk if specified
-			setting.perkConditionCopy	= iniFile.GetValue( sectionIter.pItem, "UsePerkCondition", "" );
-
-			setting.enable		= regexp[ 0 ] != NULL;
-			setting.regexp		= CreateRegex( regexp );
-
-			auto sex = iniFile.GetValue( sectionIter.pItem, "Sex", "" );
-			if( sex[ 0 ] != '\0' )
-				setting.targetFilter.sex = _strcmpi( sex, "M" ) == 0 ? RE::SEX::kMale : RE::SEX::kFemale;
-			else
-				setting.targetFilter.sex = RE::SEX::kNone;
-
-			auto shooterSex = iniFile.GetValue( sectionIter.pItem, "ShooterSex", "" );
-			if( shooterSex[ 0 ] != '\0' )
-				setting.shooterFilter.sex = _strcmpi( shooterSex, "M" ) == 0 ? RE::SEX::kMale : RE::SEX::kFemale;
-			else
-				setting.shooterFilter.sex = RE::SEX::kNone;
-			
-			setting.targetFilter.editorID	= CreateRegex( iniFile.GetValue( sectionIter.pItem, "EditorID", "" ) );
-			setting.targetFilter.ammoType	= (AmmoType)iniFile.GetLongValue( sectionIter.pItem, "AmmoType", 0 );
-
-			setting.shooterFilter.editorID	= CreateRegex( iniFile.GetValue( sectionIter.pItem, "ShooterEditorID", "" ) );
-			setting.shooterFilter.ammoType	= setting.targetFilter.ammoType; // Ammo type is the same for both filters
-
-			auto section = iniFile.GetSection( sectionIter.pItem );
-
-			int effectIdx = 0;
-			int chanceIdx = 0;
-			for( auto iter = section->begin(); iter != section->end(); ++iter )
+			BinaryReader reader( view, (size_t)fileSize.QuadPart );
+
+			uint32_t magic = 0, version = 0, pluginVersion = 0;
+			uint64_t iniHash = 0;
+			reader( magic );
+			reader( version );
+			reader( pluginVersion );
+			reader( iniHash );
+
+			if( reader.IsGood() &&
+				magic == kCacheMagic &&
+				version == kCacheVersion &&
+				pluginVersion == Plugin::VERSION.pack() &&
+				iniHash == a_iniHash )
 			{
-				std::string currentKey = iter->first.pItem;
-
-				if( currentKey == "Effect" )
-					ParseLocationEffect( setting, iter->second );
-				else if( currentKey == "EffectName" )
-					SetLocationEffect( setting, effectIdx++, iter->second );
-				else if( currentKey == "EffectChance" )
-					SetLocationChance( setting, chanceIdx++, atoi( iter->second ) );
-				else if( currentKey == "KeywordInclude" && *iter->second != 0 )
-					ExtractFilterStrings( setting.targetFilter.keywordInclude, iter->second );
-				else if( currentKey == "KeywordExclude" && *iter->second != 0 )
-					ExtractFilterStrings( setting.targetFilter.keywordExclude, iter->second );
-				else if( currentKey == "ShooterKeywordInclude" && *iter->second != 0 )
-					ExtractFilterStrings( setting.shooterFilter.keywordInclude, iter->second );
-				else if( currentKey == "ShooterKeywordExclude" && *iter->second != 0 )
-					ExtractFilterStrings( setting.shooterFilter.keywordExclude, iter->second );
-				else if( currentKey == "RaceInclude" && *iter->second != 0 )
-					setting.targetFilter.raceInclude.push_back( CreateRegex( iter->second ) );
-				else if( currentKey == "RaceExclude" && *iter->second != 0 )
-					setting.targetFilter.raceExclude.push_back( CreateRegex( iter->second ) );
-				else if( currentKey == "ShooterRaceInclude" && *iter->second != 0 )
-					setting.shooterFilter.raceInclude.push_back( CreateRegex( iter->second ) );
-				else if( currentKey == "ShooterRaceExclude" && *iter->second != 0 )
-					setting.shooterFilter.raceExclude.push_back( CreateRegex( iter->second ) );
+				Serialize( reader, a_options, a_ruleSet );
+				isLoaded = reader.IsGood() && reader.IsEnd();
+
+				if( !isLoaded )
+				{
+					a_ruleSet = RuleSet();
+					a_options = RuleCompiler::Options();	// Not always part of a_ruleSet
+				}
 			}
 
-			g_LocationalDamageSettings.push_back( setting );
+			UnmapViewOfFile( view );
 		}
 	}
+
+	if( mapping )
+		CloseHandle( mapping );
+
+	CloseHandle( file );
+
+	return isLoaded;
+}
+
+void Settings::SaveCache( const wchar_t* a_path, uint64_t a_iniHash, RuleCompiler::Options& a_options, RuleSet& a_ruleSet )
+{
+	BinaryWriter writer;
+
+	uint32_t magic			= kCacheMagic;
+	uint32_t version		= kCacheVersion;
+	uint32_t pluginVersion	= Plugin::VERSION.pack();
+	writer( magic );
+	writer( version );
+	writer( pluginVersion );
+	writer( a_iniHash );
+	Serialize( writer, a_options, a_ruleSet );
+
+	auto& buffer = writer.GetBuffer();
+	std::ofstream cacheStream( a_path, std::ios::binary | std::ios::trunc );
+	if( cacheStream )
+		cacheStream.write( (const char*)buffer.data(), buffer.size() );
+
+	if( !cacheStream )
+		logger::warn( "Failed to write settings cache" );
 }
@@ -1,127 +1,60 @@
 #pragma once
 
-enum NotificationMode
-{
-	None,
-	Floating,
-	Screen,
-	Both
-};
+#include "core/RuleCompiler.h"
+
+class FilterProgram;
+class NativeCondition;
 
 struct Settings
 {
-	struct Location
-	{
-		struct Effect
-		{
-			std::string effectID = "";
-			int			effectChance = 0;
-		};
+	using Location = LocationRule;
 
-		bool							enable = false;
-		bool							shouldContinue = false;
-		float							damageMult = 1.0f;
-		float							difficulty = 1.0f;
-		bool							deflectProjectile = false;
-		int								successChance = 100;
-		float							successHPFactor = 0;
-		bool							successHPFactorCap = true;
-		unsigned int					floatingColorEnemy = 0xFFC800;
-		unsigned int					floatingColorSelf = 0xFF4040;
-		int								floatingSize = 24;
-		std::string						id;
-		std::string						message;
-		std::string						messageFloating;
-		std::string						sound;
-		std::string						impactData;
-		std::regex						regexp;
-		std::vector<Effect>				effects;
-		ActorFilter						targetFilter;
-		ActorFilter						shooterFilter;
-		std::string						perkConditionCopy;
-		RE::TESCondition*				condition = nullptr;
+	// Perk condition of a location, resolved from LocationRule::perkConditionCopy once forms are loaded
+	struct PerkCondition
+	{
+		RE::TESCondition*						condition = nullptr;
+		std::shared_ptr<const NativeCondition>	nativeCondition;	// Translation of the condition, null when it is evaluated by the engine
 	};
 
-	static StringFilter CreateFilterFromString( const char* a_filter )
+	// Immutable rule set published to the hit pipeline.
+	// Readers hold a reference while they use it: a hit for its evaluation, queued batches and side effects until they run.
+	// A replaced set is freed by its last reader.
+	struct RuleSet : RuleData, std::enable_shared_from_this<RuleSet>
 	{
-		auto filterOption = split( a_filter, ":" );
-		if( filterOption.size() == 2 )
-		{
-			StringFilter filter;
-			if( filterOption[ 0 ] == "A" )
-				filter.type = StringFilter::Type::kActorKeyword;
-			else if( filterOption[ 0 ] == "E" )
-				filter.type = StringFilter::Type::kEquipKeyword;
-			else if( filterOption[ 0 ] == "M" )
-				filter.type = StringFilter::Type::kMagicKeyword;
-			else if( filterOption[ 0 ] == "W" )
-				filter.type = StringFilter::Type::kWeaponKeyword;
-			else
-				stl::report_and_fail( fmt::format( "Unknown keyword type: {}.", filterOption[ 0 ]).c_str() );
-
-			auto keywordList = split( filterOption[ 1 ].c_str(), "\\+" );
-			for( auto keyword : keywordList )
-			{
-				bool isNegate = false;
-				if( keyword[ 0 ] == '-' )
-				{
-					isNegate = true;
-					keyword = keyword.substr( 1 );
-				}
-
-				// Trim whitespaces
-				SKSE::stl::string::trim( keyword );
-
-				filter.AddFilter( keyword, isNegate );
-			}
-
-			return filter;
-		}
+		using HotRules = ::HotRules;
 
-		stl::report_and_fail( fmt::format( "Invalid keyword format. Expecting 1 of ':' but found {}. ({})", filterOption.size() - 1, a_filter ) );
-	}
+		uint32_t								generation = 0;	// Set by Publish, unique even when a freed set's address is reused
+		RuleCompiler::Options					options;		// Scalar settings, published with the rules they apply to
+		std::vector<PerkCondition>				conditions;		// Indexed by rule, empty until forms are loaded
+		std::shared_ptr<const FilterProgram>	filterProgram;	// Compiled once forms are loaded, filters are interpreted until then
 
-	static void ExtractFilterStrings( std::vector<StringFilterList>& a_settingList, const char* a_filter )
-	{
-		auto keywords = split( a_filter, "[\\s,]+" );
-		StringFilterList filterList;
-		for( auto str : keywords )
-			filterList.Add( CreateFilterFromString( str.c_str() ) );
-
-		a_settingList.push_back( filterList );
-	}
+		const PerkCondition* GetCondition( size_t a_rule ) const { return a_rule < conditions.size() && conditions[ a_rule ].condition ? &conditions[ a_rule ] : nullptr; }
+	};
 
-	static void SetLocationEffect( Location& a_setting, int a_index, std::string a_effect )
-	{
-		if( a_setting.effects.size() < a_index + 1 )
-			a_setting.effects.resize( a_index + 1 );
+	// Build and publish the first rule set, an invalid INI stops the game
+	static void Load();
 
-		a_setting.effects[ a_index ].effectID = a_effect;
-	}
+	// Read the INI (or its cache) into a new rule set, scalar settings included.
+	// Throws on a parse or pattern error, nothing is applied then.
+	static std::unique_ptr<RuleSet> Build();
 
-	static void SetLocationChance( Location& a_setting, int a_index, int a_chance )
-	{
-		if( a_setting.effects.size() < a_index + 1 )
-			a_setting.effects.resize( a_index + 1 );
+	// Raw INI text, empty when the file is missing
+	static std::string ReadIni();
 
-		a_setting.effects[ a_index ].effectChance = a_chance;
-	}
+	// Swap in a new rule set. In-flight readers keep using the previous one until they release it.
+	static void Publish( std::unique_ptr<RuleSet> a_ruleSet );
 
-	static void ParseLocationEffect( Location& a_setting, const char* a_str )
-	{
-		auto effectSetting = split( a_str, "[\\s%]+" );
-		if( effectSetting.size() == 2 )
-		{
-			Location::Effect effect;
-			effect.effectChance = atoi( effectSetting[ 0 ].c_str() );
-			effect.effectID		= effectSetting[ 1 ];
-			a_setting.effects.push_back( effect );
+	// Not lock-free: the shared_ptr load takes a short internal lock, once per hit
+	static std::shared_ptr<const RuleSet> GetRuleSet() { return currentRuleSet.load( std::memory_order_acquire ); }
 
-			return;
-		}
+private:
+	template <class Archive>
+	static void Serialize( Archive& a_ar, RuleCompiler::Options& a_options, RuleSet& a_ruleSet );
 
-		stl::report_and_fail( "Invalid effect format" );
-	}
+	// Binary cache of the parsed settings, invalidated by the INI content hash and the cache version.
+	// It skips INI parsing only: std::regex has no serialized form, the patterns are compiled on every load.
+	static bool LoadCache( const wchar_t* a_path, uint64_t a_iniHash, RuleCompiler::Options& a_options, RuleSet& a_ruleSet );
+	static void SaveCache( const wchar_t* a_path, uint64_t a_iniHash, RuleCompiler::Options& a_options, RuleSet& a_ruleSet );
 
-	static void Load();
+	static inline std::atomic<std::shared_ptr<const RuleSet>> currentRuleSet;
 };
@@ -1,72 +1,53 @@
 #pragma once
+
+#include "ProjectileTracker.h"
+#include "core/IniDocument.h"
+#include "core/Rules.h"
+#include "core/NodeSearch.h"
+#include "core/ShotDifficulty.h"
+#include "core/HitArena.h"
+#include "Diagnostics.h"
+
 #pragma warning(push)
 #pragma warning(disable: 4505)
 
-enum class AmmoType
+// Formats into a_buffer, truncated to fit, and returns it
+template <size_t Size, class... Args>
+static const char* FormatTo( char ( &a_buffer )[ Size ], fmt::format_string<Args...> a_format, Args&&... a_args )
 {
-	Both,
-	Arrow,
-	Bolt
-};
+	*fmt::format_to_n( a_buffer, Size - 1, a_format, std::forward<Args>( a_args )... ).out = 0;
+	return a_buffer;
+}
 
-struct StringFilter
+static Point3 ToPoint3( const RE::NiPoint3& a_point )
 {
-	enum class Type
-	{
-		kNone = -1,
-		kActorKeyword,
-		kEquipKeyword,
-		kMagicKeyword,
-		kWeaponKeyword,
-
-		kTotal
-	};
-
-	struct FilterData
-	{
-		std::string	str;
-		bool		isNegate = false;
-	};
-
-	std::vector<FilterData>	data;
-	Type					type = Type::kNone;
-
-	void AddFilter( std::string a_filter, bool isNegate = false )
-	{
-		FilterData newFilter;
-		newFilter.str = a_filter;
-		newFilter.isNegate = isNegate;
-		
-		data.push_back( newFilter );
-	}
-};
+	return { a_point.x, a_point.y, a_point.z };
+}
 
-class StringFilterList
+// Armors worn by an actor, until the callback returns false. Reads the inventory changes instead of building the
+// inventory map of GetInventory: an equipped item always has an entry there, marked worn in its extra data.
+template <class Callback>
+static void ForEachWornArmor( RE::Actor* a_actor, Callback&& a_callback )
 {
-	enum class Flag
-	{
-		kActorKeyword	= 1 << (uint32_t)StringFilter::Type::kActorKeyword,
-		kEquipKeyword	= 1 << (uint32_t)StringFilter::Type::kEquipKeyword,
-		kMagicKeyword	= 1 << (uint32_t)StringFilter::Type::kMagicKeyword,
-		kWeaponKeyword	= 1 << (uint32_t)StringFilter::Type::kWeaponKeyword,
-	};
-
-	std::vector<StringFilter>		data;
-	stl::enumeration<Flag,uint32_t>	flags;
+	auto changes = a_actor->GetInventoryChanges();
+	if( !changes || !changes->entryList )
+		return;
 
-public:
-	void Add( StringFilter a_filter )
+	for( auto entry : *changes->entryList )
 	{
-		data.push_back( a_filter );
-		flags.set( (Flag)( 1 << (uint32_t)a_filter.type ) );
-	}
+		if( !entry || !entry->object || !entry->object->IsArmor() || !entry->IsWorn() )
+			continue;
 
-	bool HasFilterType( StringFilter::Type a_type )
-	{
-		return flags.any( (Flag)( 1 << (uint32_t)a_type ) );
+		auto armor = entry->object->As<RE::TESObjectARMO>();
+		if( armor && !a_callback( armor ) )
+			return;
 	}
+}
 
-	static bool FormHasKeywords( RE::BGSKeywordForm* a_form, StringFilter& a_filter )
+// Engine side of the rule filters, tested on live actors
+struct EngineFilter
+{
+	static bool FormHasKeywords( RE::BGSKeywordForm* a_form, const StringFilter& a_filter )
 	{
 		for( auto& keyword : a_filter.data )
 		{
@@ -82,13 +63,14 @@ public:
 		return true;
 	}
 
-	bool ActiveEffectsHasKeywords( RE::Actor* a_actor )
+	static bool ActiveEffectsHasKeywords( const StringFilterList& a_list, RE::Actor* a_actor )
 	{
-		if( !HasFilterType( StringFilter::Type::kMagicKeyword ) )
+		if( !a_list.HasFilterType( StringFilter::Type::kMagicKeyword ) )
 			return true;
 
-		std::vector<StringFilter*> lookupFilter;
-		for( auto& filter : data )
+		HitArena::Scope scope;
+		ArenaVector<const StringFilter*> lookupFilter;
+		for( auto& filter : a_list.GetFilters() )
 		{
 			if( filter.type == StringFilter::Type::kMagicKeyword )
 				lookupFilter.push_back( &filter );
@@ -117,12 +99,12 @@ public:
 		return lookupFilter.size() == 0;
 	}
 
-	bool ActorHasKeywords( RE::Actor* a_actor )
+	static bool ActorHasKeywords( const StringFilterList& a_list, RE::Actor* a_actor )
 	{
-		if( !HasFilterType( StringFilter::Type::kActorKeyword ) )
+		if( !a_list.HasFilterType( StringFilter::Type::kActorKeyword ) )
 			return true;
 
-		for( auto& keywordList : data )
+		for( auto& keywordList : a_list.GetFilters() )
 		{
 			for( auto& keyword : keywordList.data )
 			{
@@ -138,57 +120,49 @@ public:
 		return true;
 	}
 
-	bool ArmorHasKeywords( RE::Actor* a_actor )
+	static bool ArmorHasKeywords( const StringFilterList& a_list, RE::Actor* a_actor )
 	{
-		if( !HasFilterType( StringFilter::Type::kEquipKeyword ) )
+		if( !a_list.HasFilterType( StringFilter::Type::kEquipKeyword ) )
 			return true;
 
-		std::vector<StringFilter*> lookupFilter;
-		for( auto& filter : data )
+		HitArena::Scope scope;
+		ArenaVector<const StringFilter*> lookupFilter;
+		for( auto& filter : a_list.GetFilters() )
 		{
 			if( filter.type == StringFilter::Type::kEquipKeyword )
 				lookupFilter.push_back( &filter );
 		}
 
-		const auto inv = a_actor->GetInventory([](RE::TESBoundObject& a_object) {
-			return a_object.IsArmor();
-			});
-
-		for( const auto& [item, invData] : inv ) 
+		ForEachWornArmor( a_actor, [ &lookupFilter ]( RE::TESObjectARMO* a_armor )
 		{
-			if( lookupFilter.size() == 0 )
-				break;
-
-			const auto& [count, entry] = invData;
-			if( count > 0 && entry->IsWorn() ) 
+			for( auto iter = lookupFilter.begin(); iter != lookupFilter.end(); )
 			{
-				const auto armor = item->As<RE::TESObjectARMO>();
-				for( auto iter = lookupFilter.begin(); iter != lookupFilter.end(); )
+				if( FormHasKeywords( a_armor, **iter ) )
 				{
-					if( armor && FormHasKeywords( armor, **iter ) )
-					{
-						iter = lookupFilter.erase( iter );
-					}
-					else
-						++iter;
+					iter = lookupFilter.erase( iter );
 				}
+				else
+					++iter;
 			}
-		}
+
+			return lookupFilter.size() > 0;
+		});
 
 		// Success when all filters matched
 		return lookupFilter.size() == 0;
 	}
 
-	bool WeaponHasKeyword( RE::Projectile* a_projectile )
+	static bool WeaponHasKeyword( const StringFilterList& a_list, RE::Projectile* a_projectile )
 	{
 		if( a_projectile == nullptr )
 			return false;
 
-		if( !HasFilterType( StringFilter::Type::kWeaponKeyword ) )
+		if( !a_list.HasFilterType( StringFilter::Type::kWeaponKeyword ) )
 			return true;
 
-		std::vector<StringFilter*> lookupFilter;
-		for( auto& filter : data )
+		HitArena::Scope scope;
+		ArenaVector<const StringFilter*> lookupFilter;
+		for( auto& filter : a_list.GetFilters() )
 		{
 			if( filter.type == StringFilter::Type::kWeaponKeyword )
 				lookupFilter.push_back( &filter );
@@ -210,286 +184,209 @@ public:
 		return lookupFilter.size() == 0;
 	}
 
-	bool Evaluate( RE::Actor* a_actor, RE::Projectile* a_source )
+	static bool Evaluate( const StringFilterList& a_list, RE::Actor* a_actor, RE::Projectile* a_source )
 	{
-		bool isActorHasKeyword	= ActorHasKeywords( a_actor );
-		bool isArmorHasKeyword	= ArmorHasKeywords( a_actor );
-		bool isMagicHasKeyword	= ActiveEffectsHasKeywords( a_actor );
-		bool isWeaponHasKeyword	= WeaponHasKeyword( a_source );
+		bool isActorHasKeyword	= ActorHasKeywords( a_list, a_actor );
+		bool isArmorHasKeyword	= ArmorHasKeywords( a_list, a_actor );
+		bool isMagicHasKeyword	= ActiveEffectsHasKeywords( a_list, a_actor );
+		bool isWeaponHasKeyword	= WeaponHasKeyword( a_list, a_source );
 
 		return isActorHasKeyword && isArmorHasKeyword && isMagicHasKeyword && isWeaponHasKeyword;
 	}
-};
-
-struct ActorFilter
-{
-	AmmoType						ammoType;
-	std::regex						editorID;
-	RE::SEX							sex;
-	std::vector<StringFilterList>	keywordInclude;
-	std::vector<StringFilterList>	keywordExclude;
-	std::vector<std::regex>			raceInclude;
-	std::vector<std::regex>			raceExclude;
 
 	// Editor ID map must be provided to filter by form editor ID
-	bool IsVaild( RE::Actor* a_actor, RE::Projectile* a_source, std::unordered_map<RE::FormID,std::string>* a_editorIDMap = NULL )
+	static bool IsVaild( const ActorFilter& a_filter, RE::Actor* a_actor, RE::Projectile* a_source, const std::unordered_map<RE::FormID,std::string>* a_editorIDMap = NULL )
 	{
-		// Default to true if there is no filter.
-		bool isVaild = keywordInclude.size() == 0;
-
-		// Check if the actor actually has a keyword
-		for( auto& filter : keywordInclude )
+		return a_filter.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
 		{
-			if( filter.Evaluate( a_actor, a_source ) )
-			{
-				isVaild = true;
-				break;
-			}
-		}
+			return Test( a_filter, (ActorFilter::Predicate)a_predicate, a_actor, a_source, a_editorIDMap );
+		});
+	}
 
-		// Check for exclusion filter
-		if( isVaild && keywordExclude.size() > 0 )
+	static bool Test( const ActorFilter& a_filter, ActorFilter::Predicate a_predicate, RE::Actor* a_actor, RE::Projectile* a_source, const std::unordered_map<RE::FormID,std::string>* a_editorIDMap )
+	{
+		switch( a_predicate )
 		{
-			for( auto& filter : keywordExclude )
+		case ActorFilter::kKeywords:
 			{
-				if( filter.Evaluate( a_actor, a_source ) )
+				// Default to true if there is no filter.
+				bool isVaild = a_filter.keywordInclude.size() == 0;
+
+				// Check if the actor actually has a keyword
+				for( auto& filter : a_filter.keywordInclude )
+				{
+					if( Evaluate( filter, a_actor, a_source ) )
+					{
+						isVaild = true;
+						break;
+					}
+				}
+
+				// Check for exclusion filter
+				if( isVaild && a_filter.keywordExclude.size() > 0 )
 				{
-					isVaild = false;
-					break;
+					for( auto& filter : a_filter.keywordExclude )
+					{
+						if( Evaluate( filter, a_actor, a_source ) )
+							return false;
+					}
 				}
+
+				return isVaild;
 			}
-		}
 
-		// Check for race
-		if( isVaild && raceInclude.size() > 0 )
-		{
-			isVaild = false;
-			auto race = a_actor->GetRace();
-			for( auto& filter : raceInclude )
+		case ActorFilter::kRaces:
 			{
-				isVaild = std::regex_match( race->GetFormEditorID(), filter );
+				if( a_filter.raceInclude.size() == 0 && a_filter.raceExclude.size() == 0 )
+					return true;
+
+				if( !a_actor )
+					return false;
+
+				auto race = a_actor->GetRace();
+				if( a_filter.raceInclude.size() > 0 )
+				{
+					bool isIncluded = false;
+					for( auto& filter : a_filter.raceInclude )
+					{
+						isIncluded = std::regex_match( race->GetFormEditorID(), filter.regex );
+						if( isIncluded )
+							break;
+					}
+
+					if( !isIncluded )
+						return false;
+				}
+
+				for( auto& filter : a_filter.raceExclude )
+				{
+					if( std::regex_match( race->GetFormEditorID(), filter.regex ) )
+						return false;
+				}
 
-				if( isVaild )
-					break;
+				return true;
 			}
-		}
 
-		if( isVaild && raceExclude.size() > 0 )
-		{
-			auto race = a_actor->GetRace();
-			for( auto& filter : raceExclude )
+		case ActorFilter::kSex:
 			{
-				isVaild = !std::regex_match( race->GetFormEditorID(), filter );
+				if( a_filter.sex == Sex::kNone )
+					return true;
 
-				if( !isVaild )
-					break;
-			}
-		}
+				if( !a_actor )
+					return false;
 
-		// Check for sex
-		if( isVaild && sex != RE::SEX::kNone )
-		{
-			auto targetSex = a_actor->GetActorBase()->GetSex();
-			if( targetSex != RE::SEX::kNone )
-				isVaild = targetSex == sex;
-		}
+				auto targetSex = a_actor->GetActorBase()->GetSex();
+				return targetSex == RE::SEX::kNone || targetSex == (RE::SEX)a_filter.sex;
+			}
 
-		// Editor ID test
-		if( isVaild && !editorID._Empty() )
-		{
-			if( a_editorIDMap )
+		case ActorFilter::kEditorID:
 			{
+				if( a_filter.editorID.empty() )
+					return true;
+
+				if( !a_editorIDMap || !a_actor )
+					return false;
+
 				auto base = a_actor->GetActorBase();
-				if( base )
-				{
-					auto baseRoot = base->GetRootFaceNPC();
-					auto& baseEditorID = (*a_editorIDMap)[ baseRoot->GetFormID() ];
-					isVaild = std::regex_match( baseEditorID, editorID );
-				}
+				if( !base )
+					return true;
+
+				// Lookup without inserting, forms without editor ID test against an empty string
+				static const std::string emptyEditorID;
+				auto iter = a_editorIDMap->find( base->GetRootFaceNPC()->GetFormID() );
+				return std::regex_match( iter != a_editorIDMap->end() ? iter->second : emptyEditorID, a_filter.editorID.regex );
 			}
-			else
-				isVaild = false;
-		}
 
-		// Ammo type test
-		if( isVaild && ammoType != AmmoType::Both && a_source->ammoSource )
-		{
-			if( (a_source->ammoSource->IsBolt() && ammoType == AmmoType::Bolt) ||
-				(!a_source->ammoSource->IsBolt() && ammoType == AmmoType::Arrow) )
-				isVaild = true;
-			else
-				isVaild = false;
+		case ActorFilter::kAmmo:
+			{
+				// Ammo type test
+				if( a_filter.ammoType == AmmoType::Both || !a_source->ammoSource )
+					return true;
+
+				return a_source->ammoSource->IsBolt() ? a_filter.ammoType == AmmoType::Bolt : a_filter.ammoType == AmmoType::Arrow;
+			}
 		}
 
-		return isVaild;
+		return true;
 	}
 };
 
-static std::vector<std::string> split( const char* a_input, const char* a_regex ) 
+// Scene graph adapter of NodeSearch
+struct NiNodeAdapter
 {
-	// passing -1 as the submatch index parameter performs splitting
-	std::string in(a_input);
-	std::regex re(a_regex);
-	std::sregex_token_iterator
-		first{in.begin(), in.end(), re, -1},
-		last;
-	return {first, last};
-}
+	static const char* GetName( const RE::NiNode* a_node ) { return a_node->name.c_str(); }
 
-static std::regex CreateRegex( const char* a_str )
-{
-	if( a_str == NULL || a_str[ 0 ] == NULL )
-		return std::regex();
+	static bool HasCollision( const RE::NiNode* a_node ) { return a_node->collisionObject.get() != nullptr; }
 
-	try
-	{
-		return std::regex( a_str );
-	}
-	catch( std::regex_error e )
-	{
-		stl::report_and_fail( fmt::format( "Regular expression error: {} is not vaild.\n{}", a_str, e.what() ) );
-	}
-}
+	static Point3 GetPosition( const RE::NiNode* a_node ) { return ToPoint3( a_node->world.translate ); }
 
-extern std::regex g_sExcludeRegexp;
-extern std::regex g_PlayerNodes;
-static RE::NiNode* FindClosestHitNode( RE::NiNode* a_root, RE::NiPoint3* a_pos, float& a_dist, bool a_isPlayer, bool a_ignoreHitboxCheck = false )
-{
-	float childMinDist = 1000000;
-	RE::NiNode* childNode = NULL;
-	if( a_root->children.size() > 0 )
+	template <class Callback>
+	static void ForEachChild( RE::NiNode* a_node, Callback&& a_callback )
 	{
-		for( auto iter = a_root->children.begin(); iter != a_root->children.end(); iter++ )
+		for( auto iter = a_node->children.begin(); iter != a_node->children.end(); iter++ )
 		{
-			float childDist;
 			auto avNode = iter->get();
-			if( avNode )
-			{
-				auto node = avNode->AsNode();
-				if( node )
-				{
-					auto childHit = FindClosestHitNode( node, a_pos, childDist, a_isPlayer );
-
-					if( childDist < childMinDist )
-					{
-						childMinDist = childDist;
-						childNode = childHit;
-					}
-				}
-			}
+			auto node = avNode ? avNode->AsNode() : nullptr;
+			if( node )
+				a_callback( node );
 		}
 	}
+};
 
-	// Only check against node with collision object
-	// Or if player is in first person mode then all of the nodes will not having any collision object
-	if( a_ignoreHitboxCheck || a_isPlayer || a_root->collisionObject )
-	{
-		// Do not check excluded node
-		if( !std::regex_match( a_root->name.c_str(), g_sExcludeRegexp ) )
-		{
-			if( !a_isPlayer || std::regex_match( a_root->name.c_str(), g_PlayerNodes ) )
-			{
-				auto* translation = &a_root->world.translate;
-				float dx = translation->x - a_pos->x;
-				float dy = translation->y - a_pos->y;
-				float dz = translation->z - a_pos->z;
-				a_dist = dx * dx + dy * dy + dz * dz;
-
-				if( childMinDist < a_dist )
-				{
-					a_dist = childMinDist;
-					return childNode;
-				}
+static RE::NiNode* FindClosestHitNode( RE::NiNode* a_root, RE::NiPoint3* a_pos, float& a_dist, bool a_isPlayer, const RuleData& a_rules, bool a_ignoreHitboxCheck = false )
+{
+	return NodeSearch::FindClosestHitNode<NiNodeAdapter>( a_root, ToPoint3( *a_pos ), a_dist, a_isPlayer, a_rules, a_ignoreHitboxCheck );
+}
 
-				return a_root->AsNode();
-			}
-		}
-	}
+// Launch data from ProjectileTracker replaces the reconstructed flight time and distance when available
+static ShotDifficultyParams GetShotDifficultyParams( RE::Projectile* a_projectile, RE::Actor* a_target, const ProjectileTracker::Launch* a_launch, const RE::NiPoint3& a_impact )
+{
+	ShotDifficultyParams params;
+	params.isFlying			= a_target->IsFlying();
 
-	if( childNode )
+	params.flightTime		= a_projectile->lifeRemaining;
+	params.distanceMoved	= a_projectile->distanceMoved;
+	if( a_launch )
 	{
-		a_dist = childMinDist;
-		return childNode;
+		params.flightTime		= a_launch->GetFlightTime();
+		params.distanceMoved	= a_launch->position.GetDistance( a_impact );
 	}
 
-	a_dist = 1000000;
-	return NULL;
-}
-
-static float CalculateShotDifficulty( RE::Projectile* a_projectile, RE::Actor* a_target, float a_flightTimeFactor, float a_distanceFactor, float a_moveFactor )
-{
-	// First 0.1 second of flight time do not count as time bonus
-	float timeBonus = max( a_projectile->lifeRemaining - 0.1f, 0 );
-	float timeDifficulty = ( powf( 1 + timeBonus, 2 ) - 1 ) / 2;
-	timeDifficulty *= a_flightTimeFactor;
-
-	// Add moving target bonus
 	RE::NiPoint3 targetVelocity;
 	RE::NiPoint3 attackVector;
 	a_projectile->GetLinearVelocity( attackVector );
-	a_target->GetLinearVelocity( targetVelocity );
-
-	float targetSpeed		= targetVelocity.Unitize();
-	float projectileSpeed	= attackVector.Unitize();
 
-	float sizeFactor = 1;
+	// Fetch the controller once and read the velocity and bound from it
 	auto targetController = a_target->GetCharController();
-	RE::BSBound* targetBound = NULL;
 	if( targetController )
 	{
-		targetBound = &targetController->collisionBound;
-		if( targetBound )
-			sizeFactor *= 65.0f / targetBound->extents.z; // Bonus for a short target like a rabbit or a penalty on tall target. (65 is normal sized NPC)
-	}
-
-	// First 0.1 second of travelled distance does not count
-	float distBonus = max( a_projectile->distanceMoved - projectileSpeed * 0.1f, 0 );
-	float distDifficulty = ( powf( 1 + distBonus / 6000.0f, 2 ) - 1 ) / 2;
-	distDifficulty *= a_distanceFactor;
-
-	// Calculate cross vector for shot difficulty
-	// A target moving toward or away from the player is not that hard to shoot
-	// But it becomes a lot harder when they're moving perpendicular to the player, especially when they're really far away
-
-	RE::NiPoint3 movementCross = targetVelocity.Cross( attackVector );
-	float crossFactor = 0;
-	float movementFactor = 0;
-	float bodyLengthSpeed = 0;
-	float movementDifficulty = 0;
-	if( targetSpeed != 0 )
-	{
-		crossFactor = movementCross.Length();
-		// extents.y is the width of the side of an actor when it's moving forward
-		if( targetBound && targetBound->extents.y != 0 )
-		{
-			bodyLengthSpeed = targetSpeed / targetBound->extents.y; // Speed vs size in body length per second
-			movementFactor = bodyLengthSpeed / 2.5f * crossFactor;
-		}
+		a_target->GetLinearVelocity( targetVelocity );
 
-		movementDifficulty = powf( 2.0f, 1 + a_projectile->lifeRemaining * 2 ) - 2;
-		movementDifficulty *= movementFactor * crossFactor * a_moveFactor;
+		params.hasBound		= true;
+		params.boundHeight	= targetController->collisionBound.extents.z;
+		params.boundWidth	= targetController->collisionBound.extents.y;
 	}
 
-	// Multiply by size factor
-	distDifficulty		*= sizeFactor;
-	movementDifficulty	*= sizeFactor;
+	params.targetSpeed		= targetVelocity.Unitize();
+	params.projectileSpeed	= attackVector.Unitize();
+
+	if( params.targetSpeed != 0 )
+		params.crossFactor = targetVelocity.Cross( attackVector ).Length();
 
-	float shotDifficulty = 0;
-	shotDifficulty		+= timeDifficulty;
-	shotDifficulty		+= distDifficulty;
-	shotDifficulty		+= movementDifficulty;
+	return params;
+}
 
-	// Multiply difficulty by 2 if the target is flying (A flying dragon is very hard to hit)
-	if( a_target->IsFlying() )
-		shotDifficulty *= 2;
+static float CalculateShotDifficulty( RE::Projectile* a_projectile, RE::Actor* a_target, const ProjectileTracker::Launch* a_launch, const RE::NiPoint3& a_impact, float a_flightTimeFactor, float a_distanceFactor, float a_moveFactor )
+{
+	auto params = GetShotDifficultyParams( a_projectile, a_target, a_launch, a_impact );
+	float shotDifficulty = ShotDifficulty::Compute( params, a_flightTimeFactor, a_distanceFactor, a_moveFactor );
 
 #ifdef _DEBUG
-	RE::ConsoleLog::GetSingleton()->Print( "TDiff: %0.2f, DDiff: %0.2f, CFactor: %0.2f, Spd: %0.1f, BSpd: %0.2f, MFactor: %0.2f, SFactor: %0.2f",
-		timeDifficulty, distDifficulty, crossFactor, targetSpeed, bodyLengthSpeed, movementFactor, sizeFactor );
+	Diagnostics::Push( Diagnostics::kShotDifficulty, 0, {},
+		{ params.flightTime, params.distanceMoved, params.crossFactor, params.targetSpeed, params.boundHeight, params.boundWidth, shotDifficulty } );
 #endif
 
-	// Convert to multiplier
-	return shotDifficulty + 1;
+	return shotDifficulty;
 }
 
 #pragma warning(pop)
@@ -0,0 +1,82 @@
+#include "AllocationCounter.h"
+
+#ifndef NDEBUG
+#	include <new>
+#	ifdef _MSC_VER
+#		include <malloc.h>
+#	endif
+
+// Plain counter, thread_local without a constructor is safe to touch from operator new
+static thread_local uint64_t allocationCount = 0;
+
+static void* AllocateAligned( std::size_t a_size, std::size_t a_alignment )
+{
+#	ifdef _MSC_VER
+	return _aligned_malloc( a_size ? a_size : 1, a_alignment );
+#	else
+	// aligned_alloc wants a multiple of the alignment
+	return std::aligned_alloc( a_alignment, ( ( a_size ? a_size : 1 ) + a_alignment - 1 ) & ~( a_alignment - 1 ) );
+#	endif
+}
+
+static void FreeAligned( void* a_memory )
+{
+#	ifdef _MSC_VER
+	_aligned_free( a_memory );
+#	else
+	std::free( a_memory );
+#	endif
+}
+
+void* operator new( std::size_t a_size )
+{
+	++allocationCount;
+
+	auto memory = std::malloc( a_size ? a_size : 1 );
+	if( !memory )
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[]( std::size_t a_size )
+{
+	return operator new( a_size );
+}
+
+void* operator new( std::size_t a_size, std::align_val_t a_alignment )
+{
+	++allocationCount;
+
+	auto memory = AllocateAligned( a_size, (std::size_t)a_alignment );
+	if( !memory )
+		throw std::bad_alloc();
+
+	return memory;
+}
+
+void* operator new[]( std::size_t a_size, std::align_val_t a_alignment )
+{
+	return operator new( a_size, a_alignment );
+}
+
+void operator delete( void* a_memory ) noexcept { std::free( a_memory ); }
+void operator delete[]( void* a_memory ) noexcept { std::free( a_memory ); }
+void operator delete( void* a_memory, std::size_t ) noexcept { std::free( a_memory ); }
+void operator delete[]( void* a_memory, std::size_t ) noexcept { std::free( a_memory ); }
+
+void operator delete( void* a_memory, std::align_val_t ) noexcept { FreeAligned( a_memory ); }
+void operator delete[]( void* a_memory, std::align_val_t ) noexcept { FreeAligned( a_memory ); }
+void operator delete( void* a_memory, std::size_t, std::align_val_t ) noexcept { FreeAligned( a_memory ); }
+void operator delete[]( void* a_memory, std::size_t, std::align_val_t ) noexcept { FreeAligned( a_memory ); }
+
+uint64_t AllocationCounter::GetCount()
+{
+	return allocationCount;
+}
+#else
+uint64_t AllocationCounter::GetCount()
+{
+	return 0;
+}
+#endif
@@ -0,0 +1,16 @@
+#pragma once
+
+// Global heap allocations (operator new) made by the calling thread.
+// Counted in debug builds only, where this module replaces operator new of the binary it is linked into.
+// Used to check that the steady state hit path leaves the global heap alone.
+namespace AllocationCounter
+{
+#ifdef NDEBUG
+	inline constexpr bool kIsEnabled = false;
+#else
+	inline constexpr bool kIsEnabled = true;
+#endif
+
+	// Always 0 when not enabled
+	uint64_t GetCount();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// Minimal binary archives used by the settings cache.
+// Both archives expose the same operator() so a single Serialize() member describes the layout for reading and writing.
+class BinaryWriter
+{
+public:
+	static constexpr bool IsLoading = false;
+
+	template <class T>
+	void operator()( T& a_value )
+	{
+		if constexpr( std::is_trivially_copyable_v<T> )
+		{
+			auto bytes = reinterpret_cast<const uint8_t*>( &a_value );
+			buffer.insert( buffer.end(), bytes, bytes + sizeof( T ) );
+		}
+		else
+			a_value.Serialize( *this );
+	}
+
+	void operator()( std::string& a_value )
+	{
+		auto length = (uint32_t)a_value.size();
+		(*this)( length );
+		buffer.insert( buffer.end(), a_value.begin(), a_value.end() );
+	}
+
+	template <class T>
+	void operator()( std::vector<T>& a_value )
+	{
+		auto count = (uint32_t)a_value.size();
+		(*this)( count );
+		for( auto& element : a_value )
+			(*this)( element );
+	}
+
+	bool IsGood() const { return true; }
+
+	const std::vector<uint8_t>& GetBuffer() const { return buffer; }
+
+private:
+	std::vector<uint8_t> buffer;
+};
+
+class BinaryReader
+{
+public:
+	static constexpr bool IsLoading = true;
+
+	BinaryReader( const uint8_t* a_data, size_t a_size ) :
+		cursor( a_data ), end( a_data + a_size ) {}
+
+	template <class T>
+	void operator()( T& a_value )
+	{
+		if constexpr( std::is_trivially_copyable_v<T> )
+		{
+			if( !Require( sizeof( T ) ) )
+				return;
+
+			memcpy( &a_value, cursor, sizeof( T ) );
+			cursor += sizeof( T );
+		}
+		else
+			a_value.Serialize( *this );
+	}
+
+	void operator()( std::string& a_value )
+	{
+		uint32_t length = 0;
+		(*this)( length );
+		if( !Require( length ) )
+			return;
+
+		a_value.assign( (const char*)cursor, length );
+		cursor += length;
+	}
+
+	template <class T>
+	void operator()( std::vector<T>& a_value )
+	{
+		uint32_t count = 0;
+		(*this)( count );
+
+		// Every element takes at least one byte, reject counts that cannot fit in the remaining data
+		if( !Require( count ) )
+			return;
+
+		a_value.clear();
+		a_value.resize( count );
+		for( auto& element : a_value )
+		{
+			(*this)( element );
+			if( !good )
+				return;
+		}
+	}
+
+	bool IsGood() const { return good; }
+	bool IsEnd() const { return cursor == end; }
+
+private:
+	bool Require( size_t a_size )
+	{
+		if( !good || (size_t)( end - cursor ) < a_size )
+			good = false;
+
+		return good;
+	}
+
+	const uint8_t*	cursor;
+	const uint8_t*	end;
+	bool			good = true;
+};
+
+inline uint64_t HashFNV1a( const void* a_data, size_t a_size, uint64_t a_hash = 0xCBF29CE484222325 )
+{
+	auto bytes = static_cast<const uint8_t*>( a_data );
+	for( size_t i = 0; i < a_size; ++i )
+	{
+		a_hash ^= bytes[ i ];
+		a_hash *= 0x100000001B3;
+	}
+
+	return a_hash;
+}
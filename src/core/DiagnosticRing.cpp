@@ -0,0 +1,98 @@
+#include "DiagnosticRing.h"
+
+DiagnosticRing::DiagnosticRing( size_t a_capacity )
+{
+	size_t capacity = 2;
+	while( capacity < a_capacity )
+		capacity *= 2;
+
+	cells = std::make_unique<Cell[]>( capacity );
+	mask = capacity - 1;
+
+	// A cell is free for the producer whose position equals its sequence
+	for( size_t i = 0; i < capacity; ++i )
+		cells[ i ].sequence.store( i, std::memory_order_relaxed );
+}
+
+bool DiagnosticRing::Push( const DiagnosticRecord& a_record )
+{
+	auto position = enqueuePosition.load( std::memory_order_relaxed );
+	while( true )
+	{
+		auto& cell		= cells[ position & mask ];
+		auto sequence	= cell.sequence.load( std::memory_order_acquire );
+		auto difference	= (intptr_t)sequence - (intptr_t)position;
+		if( difference == 0 )
+		{
+			// Claim the cell, another producer may have taken it first
+			if( enqueuePosition.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+			{
+				cell.record = a_record;
+				cell.sequence.store( position + 1, std::memory_order_release );
+				return true;
+			}
+		}
+		else if( difference < 0 )
+		{
+			// The consumer has not freed the cell of the previous lap yet
+			dropped[ a_record.category % kCategoryCount ].fetch_add( 1, std::memory_order_relaxed );
+			return false;
+		}
+		else
+			position = enqueuePosition.load( std::memory_order_relaxed );
+	}
+}
+
+bool DiagnosticRing::Pop( DiagnosticRecord& a_record )
+{
+	auto position	= dequeuePosition.load( std::memory_order_relaxed );
+	auto& cell		= cells[ position & mask ];
+	auto sequence	= cell.sequence.load( std::memory_order_acquire );
+
+	// Empty, or the producer of the cell has not finished writing it
+	if( (intptr_t)sequence - (intptr_t)( position + 1 ) < 0 )
+		return false;
+
+	a_record = cell.record;
+	dequeuePosition.store( position + 1, std::memory_order_relaxed );
+
+	// Free for the producer one lap later
+	cell.sequence.store( position + mask + 1, std::memory_order_release );
+	return true;
+}
+
+void DiagnosticRateLimit::Roll( Category& a_category, double a_now )
+{
+	if( a_now - a_category.windowStart < 1 )
+		return;
+
+	a_category.unreported	+= a_category.suppressed;
+	a_category.suppressed	= 0;
+	a_category.count		= 0;
+	a_category.windowStart	= a_now;
+}
+
+bool DiagnosticRateLimit::IsAllowed( uint16_t a_category, double a_now )
+{
+	auto& category = categories[ a_category % DiagnosticRing::kCategoryCount ];
+	if( category.limit == 0 )
+		return true;
+
+	Roll( category, a_now );
+	if( category.count < category.limit )
+	{
+		++category.count;
+		return true;
+	}
+
+	++category.suppressed;
+	return false;
+}
+
+uint64_t DiagnosticRateLimit::TakeSuppressed( uint16_t a_category, double a_now )
+{
+	auto& category = categories[ a_category % DiagnosticRing::kCategoryCount ];
+	Roll( category, a_now );
+
+	return std::exchange( category.unreported, 0 );
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+// Diagnostic event of the hit path, plain data formatted later by the consumer.
+// Names are copied truncated: the node or rule they come from may be gone when the record is formatted.
+struct DiagnosticRecord
+{
+	static constexpr size_t kMaxValues	= 8;
+	static constexpr size_t kTextSize	= 48;
+
+	uint16_t						category = 0;
+	uint16_t						event = 0;
+	uint32_t						id = 0;			// Form ID, index or any integer of the event
+	std::array<float, kMaxValues>	values{};
+	std::array<char, kTextSize>		text{};
+
+	void SetText( std::string_view a_text )
+	{
+		auto length = std::min<size_t>( a_text.size(), kTextSize - 1 );
+		std::memcpy( text.data(), a_text.data(), length );
+		text[ length ] = 0;
+	}
+
+	const char* GetText() const { return text.data(); }
+};
+
+// Bounded lock-free queue of diagnostic records, many producers and one consumer.
+// Push never blocks nor allocates: a full ring drops the record and counts the drop for its category.
+// Every cell carries a sequence number that tells the producers and the consumer whose turn it is (bounded MPMC queue
+// by Dmitry Vyukov), so a producer only contends on the enqueue position.
+class DiagnosticRing
+{
+public:
+	static constexpr size_t kCategoryCount = 16;
+
+	// a_capacity is rounded up to a power of two
+	explicit DiagnosticRing( size_t a_capacity );
+
+	DiagnosticRing( const DiagnosticRing& ) = delete;
+	DiagnosticRing& operator=( const DiagnosticRing& ) = delete;
+
+	size_t GetCapacity() const { return mask + 1; }
+
+	// Any thread, false when the ring is full and the record was dropped
+	bool Push( const DiagnosticRecord& a_record );
+
+	// Consumer thread only, false when the ring is empty
+	bool Pop( DiagnosticRecord& a_record );
+
+	// Records of a category dropped since the last call
+	uint64_t TakeDropped( uint16_t a_category ) { return dropped[ a_category % kCategoryCount ].exchange( 0, std::memory_order_relaxed ); }
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t>	sequence = 0;
+		DiagnosticRecord	record;
+	};
+
+	std::unique_ptr<Cell[]>								cells;
+	size_t												mask = 0;
+	alignas( 64 ) std::atomic<size_t>					enqueuePosition = 0;
+	alignas( 64 ) std::atomic<size_t>					dequeuePosition = 0;
+	std::array<std::atomic<uint64_t>, kCategoryCount>	dropped{};
+};
+
+// Records per second a consumer lets through for each category, the others are counted as suppressed.
+// Consumer thread only.
+class DiagnosticRateLimit
+{
+public:
+	// 0 lets every record through, the default
+	void SetLimit( uint16_t a_category, uint32_t a_perSecond ) { categories[ a_category % DiagnosticRing::kCategoryCount ].limit = a_perSecond; }
+
+	// a_now in seconds, from any monotonic clock
+	bool IsAllowed( uint16_t a_category, double a_now );
+
+	// Records of a category suppressed in the windows that ended before a_now, reported once per window
+	uint64_t TakeSuppressed( uint16_t a_category, double a_now );
+
+private:
+	struct Category
+	{
+		uint32_t	limit = 0;
+		uint32_t	count = 0;			// Records let through in the current window
+		double		windowStart = 0;
+		uint64_t	suppressed = 0;		// In the current window
+		uint64_t	unreported = 0;		// In the windows that ended
+	};
+
+	void Roll( Category& a_category, double a_now );
+
+	std::array<Category, DiagnosticRing::kCategoryCount>	categories;
+};
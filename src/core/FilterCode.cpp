@@ -0,0 +1,211 @@
+#include "FilterCode.h"
+
+void FilterCode::Compile( std::vector<LocationRule>& a_locations, const Forms& a_forms )
+{
+	for( uint32_t i = 0; i < a_forms.races.size(); ++i )
+		raceIndices.emplace( a_forms.races[ i ].first, i );
+
+	// Shared entry for every predicate that is not configured
+	Emit( Op::kReturnTrue );
+	segments.emplace_back( 0, 1 );
+
+	for( auto& location : a_locations )
+	{
+		for( auto filter : { &location.targetFilter, &location.shooterFilter } )
+		{
+			auto begin = (uint32_t)code.size();
+			for( uint32_t i = 0; i < ActorFilter::kPredicateCount; ++i )
+				filter->programEntries[ i ] = CompileFilter( (ActorFilter::Predicate)i, *filter, a_forms );
+
+			// Every predicate of the filter was emitted after begin, the shared entry tests no clause
+			auto& mask = filterClauses.emplace_back();
+			for( uint32_t pc = begin; pc < code.size(); ++pc )
+			{
+				auto arg = code[ pc ].arg;
+				if( code[ pc ].op == Op::kClause && arg < FilterSnapshot::kMaxClauses )
+					mask[ arg / 64 ] |= 1ull << ( arg % 64 );
+			}
+		}
+	}
+}
+
+bool FilterCode::TestBase( const FilterFields& a_fields, uint32_t a_set ) const
+{
+	// Same as the interpreted filter: an actor without base passes
+	if( !a_fields.hasBase )
+		return true;
+
+	auto& set = baseSets[ a_set ];
+	bool isException = std::binary_search( set.exceptions.begin(), set.exceptions.end(), a_fields.baseID );
+	return isException != set.defaultResult;
+}
+
+uint32_t FilterCode::CompileFilter( ActorFilter::Predicate a_predicate, const ActorFilter& a_filter, const Forms& a_forms )
+{
+	auto begin = (uint32_t)code.size();
+	std::vector<uint32_t> fixups;
+
+	switch( a_predicate )
+	{
+	case ActorFilter::kKeywords:
+		{
+			if( a_filter.keywordInclude.empty() && a_filter.keywordExclude.empty() )
+				return 0;
+
+			// Any include list with all its clauses true, jump to the exclusion lists
+			for( auto& list : a_filter.keywordInclude )
+			{
+				std::vector<uint32_t> nextList;
+				for( auto& clause : list.GetFilters() )
+				{
+					Emit( Op::kClause, AddClause( clause ) );
+					nextList.push_back( Emit( Op::kJumpIfFalse ) );
+				}
+
+				fixups.push_back( Emit( Op::kJump ) );
+
+				for( auto jump : nextList )
+					code[ jump ].arg = (uint32_t)code.size();
+			}
+
+			if( !a_filter.keywordInclude.empty() )
+				Emit( Op::kReturnFalse );
+
+			for( auto jump : fixups )
+				code[ jump ].arg = (uint32_t)code.size();
+
+			// Any exclude list with all its clauses true fails the filter
+			for( auto& list : a_filter.keywordExclude )
+			{
+				std::vector<uint32_t> nextList;
+				for( auto& clause : list.GetFilters() )
+				{
+					Emit( Op::kClause, AddClause( clause ) );
+					nextList.push_back( Emit( Op::kJumpIfFalse ) );
+				}
+
+				Emit( Op::kReturnFalse );
+
+				for( auto jump : nextList )
+					code[ jump ].arg = (uint32_t)code.size();
+			}
+
+			Emit( Op::kReturnTrue );
+		}
+		break;
+
+	case ActorFilter::kRaces:
+		if( a_filter.raceInclude.empty() && a_filter.raceExclude.empty() )
+			return 0;
+
+		Emit( Op::kHasActor );
+		Emit( Op::kReturnIfFalse );
+
+		if( !a_filter.raceInclude.empty() )
+		{
+			Emit( Op::kRace, AddRaceSet( a_filter.raceInclude, a_forms ) );
+			Emit( Op::kReturnIfFalse );
+		}
+
+		if( !a_filter.raceExclude.empty() )
+		{
+			Emit( Op::kRace, AddRaceSet( a_filter.raceExclude, a_forms ) );
+			Emit( Op::kNot );
+		}
+
+		Emit( Op::kReturn );
+		break;
+
+	case ActorFilter::kSex:
+		if( a_filter.sex == Sex::kNone )
+			return 0;
+
+		Emit( Op::kHasActor );
+		Emit( Op::kReturnIfFalse );
+		Emit( Op::kSex, (uint32_t)a_filter.sex );
+		Emit( Op::kReturn );
+		break;
+
+	case ActorFilter::kEditorID:
+		if( a_filter.editorID.empty() )
+			return 0;
+
+		Emit( Op::kHasActor );
+		Emit( Op::kReturnIfFalse );
+		Emit( Op::kBase, AddBaseSet( a_filter.editorID, a_forms ) );
+		Emit( Op::kReturn );
+		break;
+
+	case ActorFilter::kAmmo:
+		if( a_filter.ammoType == AmmoType::Both )
+			return 0;
+
+		Emit( Op::kAmmo, (uint32_t)a_filter.ammoType );
+		Emit( Op::kReturn );
+		break;
+
+	default:
+		return 0;
+	}
+
+	segments.emplace_back( begin, (uint32_t)code.size() );
+
+	return begin;
+}
+
+uint32_t FilterCode::AddClause( const StringFilter& a_clause )
+{
+	auto isSame = [ &a_clause ]( const StringFilter& a_other )
+	{
+		return a_other.type == a_clause.type &&
+			std::equal( a_other.data.begin(), a_other.data.end(), a_clause.data.begin(), a_clause.data.end(), []( auto& x, auto& y )
+			{
+				return x.str == y.str && x.isNegate == y.isNegate;
+			});
+	};
+
+	auto iter = std::find_if( clauses.begin(), clauses.end(), isSame );
+	if( iter != clauses.end() )
+		return (uint32_t)( iter - clauses.begin() );
+
+	clauses.push_back( a_clause );
+	return (uint32_t)clauses.size() - 1;
+}
+
+uint32_t FilterCode::AddRaceSet( const std::vector<RegexPattern>& a_patterns, const Forms& a_forms )
+{
+	auto& races = a_forms.races;
+	auto offset = (uint32_t)raceWords.size();
+	raceWords.resize( raceWords.size() + ( races.size() + 63 ) / 64 );
+
+	for( uint32_t i = 0; i < races.size(); ++i )
+	{
+		auto& editorID = races[ i ].second;
+		for( auto& pattern : a_patterns )
+		{
+			if( std::regex_match( editorID.begin(), editorID.end(), pattern.regex ) )
+			{
+				raceWords[ offset + i / 64 ] |= 1ull << ( i % 64 );
+				break;
+			}
+		}
+	}
+
+	return offset;
+}
+
+uint32_t FilterCode::AddBaseSet( const RegexPattern& a_pattern, const Forms& a_forms )
+{
+	auto& set = baseSets.emplace_back();
+	set.defaultResult = std::regex_match( "", a_pattern.regex );
+
+	for( auto& [ formID, editorID ] : a_forms.npcs )
+	{
+		if( std::regex_match( editorID.begin(), editorID.end(), a_pattern.regex ) != set.defaultResult )
+			set.exceptions.push_back( formID );
+	}
+
+	std::sort( set.exceptions.begin(), set.exceptions.end() );
+
+	return (uint32_t)baseSets.size() - 1;
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "Rules.h"
+
+// Plain facts of one actor read by the filter code, filled by the engine adapter once per hit
+struct FilterFields
+{
+	static constexpr uint32_t	kNoRace = 0xFFFFFFFF;
+	static constexpr uint8_t	kNoSex = 0xFF;
+
+	const void*	actor = nullptr;
+	uint32_t	raceIndex = kNoRace;
+	uint32_t	baseID = 0;
+	uint8_t		sex = kNoSex;
+	uint8_t		ammo = (uint8_t)AmmoType::Both;	// Both when the projectile has no ammo
+	bool		hasBase = false;
+};
+
+// Fields and keyword clause results of one actor, a plain copy of its facts that refers to no game object.
+// The thread that owns the actor captures the clauses its rules can test, any thread can then run the code over it.
+struct FilterSnapshot
+{
+	static constexpr uint32_t kMaxClauses = 256;
+
+	using ClauseMask = std::array<uint64_t, kMaxClauses / 64>;
+
+	FilterFields	fields;
+	ClauseMask		clauseValue{};
+
+	// A clause left out of the capture reads false
+	bool TestClause( uint32_t a_clause ) const { return a_clause < kMaxClauses && ( clauseValue[ a_clause / 64 ] >> ( a_clause % 64 ) ) & 1; }
+
+	// Facts provide the fields and bool TestClause( uint32_t ), as for FilterCode::Interpret
+	template <class Facts>
+	void Capture( Facts& a_facts, const ClauseMask& a_clauses )
+	{
+		fields = a_facts.fields;
+		clauseValue = {};
+		for( uint32_t word = 0; word < a_clauses.size(); ++word )
+		{
+			for( auto bits = a_clauses[ word ]; bits; bits &= bits - 1 )
+			{
+				auto clause = word * 64 + (uint32_t)std::countr_zero( bits );
+				if( a_facts.TestClause( clause ) )
+					clauseValue[ word ] |= 1ull << ( clause % 64 );
+			}
+		}
+	}
+};
+
+// Rule filters lowered into a flat bytecode over FilterFields.
+// Every ActorFilter predicate is a segment of the code and runs in the filter's adaptive order.
+// Race and editor ID patterns are matched against every loaded form at compile time, so a hit only tests set membership.
+// Keyword clauses need the game and are delegated to the facts.
+class FilterCode
+{
+public:
+	enum class Op : uint8_t
+	{
+		kHasActor,		// acc = actor != null
+		kClause,		// acc = keyword clause arg holds
+		kRace,			// acc = race is in race set arg
+		kSex,			// acc = sex is unknown or equals arg
+		kBase,			// acc = base NPC is in editor ID set arg
+		kAmmo,			// acc = ammo is unknown or equals arg
+		kNot,
+		kJump,			// goto arg
+		kJumpIfFalse,	// if !acc goto arg
+		kReturnIfFalse,
+		kReturn,		// return acc
+		kReturnTrue,
+		kReturnFalse,
+	};
+
+	struct Instruction
+	{
+		Op			op;
+		uint32_t	arg = 0;
+	};
+
+	// Editor ID pattern result of every NPC. Forms without editor ID are tested as an empty string
+	// and give defaultResult, exceptions are the NPCs whose editor ID gives the other result.
+	struct BaseSet
+	{
+		std::vector<uint32_t>	exceptions;	// Sorted form IDs
+		bool					defaultResult = false;
+	};
+
+	// Loaded forms the patterns are matched against, gathered by the engine adapter
+	struct Forms
+	{
+		std::vector<std::pair<uint32_t, std::string_view>>	races;	// Form ID and editor ID of every race
+		std::vector<std::pair<uint32_t, std::string_view>>	npcs;	// Form ID and editor ID of every NPC that has one
+	};
+
+	// Lower every filter of the rules and assign their ActorFilter::programEntries
+	void Compile( std::vector<LocationRule>& a_locations, const Forms& a_forms );
+
+	// Keyword clauses the target or shooter filter of a rule can test
+	const FilterSnapshot::ClauseMask& GetClauses( uint32_t a_rule, bool a_isTarget ) const { return filterClauses[ a_rule * 2 + ( a_isTarget ? 0 : 1 ) ]; }
+
+	// Every clause fits in a FilterSnapshot
+	bool CanSnapshot() const { return clauses.size() <= FilterSnapshot::kMaxClauses; }
+
+	// Reference implementation. Facts provide the FilterFields as fields and bool TestClause( uint32_t ).
+	template <class Facts>
+	bool Interpret( uint32_t a_entry, Facts& a_facts ) const
+	{
+		const FilterFields& fields = a_facts.fields;
+		bool acc = false;
+		for( uint32_t pc = a_entry; ; ++pc )
+		{
+			auto& instruction = code[ pc ];
+			switch( instruction.op )
+			{
+			case Op::kHasActor:
+				acc = fields.actor != nullptr;
+				break;
+
+			case Op::kClause:
+				acc = a_facts.TestClause( instruction.arg );
+				break;
+
+			case Op::kRace:
+				acc = TestRace( fields, instruction.arg );
+				break;
+
+			case Op::kSex:
+				acc = fields.sex == FilterFields::kNoSex || fields.sex == instruction.arg;
+				break;
+
+			case Op::kBase:
+				acc = TestBase( fields, instruction.arg );
+				break;
+
+			case Op::kAmmo:
+				acc = fields.ammo == (uint8_t)AmmoType::Both || fields.ammo == instruction.arg;
+				break;
+
+			case Op::kNot:
+				acc = !acc;
+				break;
+
+			case Op::kJump:
+				pc = instruction.arg - 1;
+				break;
+
+			case Op::kJumpIfFalse:
+				if( !acc )
+					pc = instruction.arg - 1;
+				break;
+
+			case Op::kReturnIfFalse:
+				if( !acc )
+					return false;
+				break;
+
+			case Op::kReturn:
+				return acc;
+
+			case Op::kReturnTrue:
+				return true;
+
+			case Op::kReturnFalse:
+				return false;
+			}
+		}
+	}
+
+	bool TestRace( const FilterFields& a_fields, uint32_t a_set ) const
+	{
+		return a_fields.raceIndex != FilterFields::kNoRace && ( raceWords[ a_set + a_fields.raceIndex / 64 ] >> ( a_fields.raceIndex % 64 ) ) & 1;
+	}
+
+	bool TestBase( const FilterFields& a_fields, uint32_t a_set ) const;
+
+	// Index of a race in the race sets, kNoRace when the race was not loaded at compile time
+	uint32_t GetRaceIndex( uint32_t a_raceID ) const
+	{
+		auto iter = raceIndices.find( a_raceID );
+		return iter != raceIndices.end() ? iter->second : FilterFields::kNoRace;
+	}
+
+	const std::vector<Instruction>& GetCode() const { return code; }
+	const std::vector<std::pair<uint32_t, uint32_t>>& GetSegments() const { return segments; }
+
+	std::vector<StringFilter>				clauses;
+	std::unordered_map<uint32_t, uint32_t>	raceIndices;
+	std::vector<uint64_t>					raceWords;	// Race sets, one bit per race
+	std::vector<BaseSet>					baseSets;
+	std::vector<FilterSnapshot::ClauseMask>	filterClauses;	// Target then shooter filter of every rule
+
+protected:
+	uint32_t CompileFilter( ActorFilter::Predicate a_predicate, const ActorFilter& a_filter, const Forms& a_forms );
+	uint32_t AddClause( const StringFilter& a_clause );
+	uint32_t AddRaceSet( const std::vector<RegexPattern>& a_patterns, const Forms& a_forms );
+	uint32_t AddBaseSet( const RegexPattern& a_pattern, const Forms& a_forms );
+
+	uint32_t Emit( Op a_op, uint32_t a_arg = 0 )
+	{
+		code.push_back( { a_op, a_arg } );
+		return (uint32_t)code.size() - 1;
+	}
+
+	std::vector<Instruction>					code;
+	std::vector<std::pair<uint32_t, uint32_t>>	segments;	// [begin, end) of every predicate
+};
@@ -0,0 +1,180 @@
+#include "FilterJIT.h"
+
+#if defined( ALD_FILTER_JIT ) && ( defined( _M_X64 ) || defined( __x86_64__ ) )
+#	define ALD_FILTER_JIT_X64
+#	include <xbyak/xbyak.h>
+#endif
+
+#ifdef ALD_FILTER_JIT_X64
+
+// Every segment is a function of the facts and the fields, registers follow the platform calling convention
+struct FilterJIT::Generator : Xbyak::CodeGenerator
+{
+	Generator( const FilterCode& a_code, ClauseHelper a_testClause, std::vector<Function>& a_entries ) :
+		Xbyak::CodeGenerator( a_code.GetCode().size() * 48 + a_code.GetSegments().size() * 64 + 4096 )
+	{
+#ifdef _WIN32
+		const Xbyak::Reg64& arg1 = rcx;
+		const Xbyak::Reg64& arg2 = rdx;
+		const Xbyak::Reg64& arg3 = r8;
+#else
+		const Xbyak::Reg64& arg1 = rdi;
+		const Xbyak::Reg64& arg2 = rsi;
+		const Xbyak::Reg64& arg3 = rdx;
+#endif
+		auto& code = a_code.GetCode();
+		a_entries.assign( code.size(), nullptr );
+
+		for( auto [ begin, end ] : a_code.GetSegments() )
+		{
+			std::vector<Xbyak::Label> labels( end - begin );
+			Xbyak::Label returnLbl;
+
+			align( 16 );
+			a_entries[ begin ] = getCurr<Function>();
+
+			// rbx = facts, r12 = fields. Two pushes and 40 bytes keep the stack aligned and reserve the Win64 shadow space.
+			push( rbx );
+			push( r12 );
+			sub( rsp, 40 );
+			mov( rbx, arg1 );
+			mov( r12, arg2 );
+
+			for( uint32_t i = begin; i < end; ++i )
+			{
+				L( labels[ i - begin ] );
+
+				auto arg = code[ i ].arg;
+				switch( code[ i ].op )
+				{
+				case FilterCode::Op::kHasActor:
+					cmp( qword[ r12 + offsetof( FilterFields, actor ) ], 0 );
+					setne( al );
+					break;
+
+				case FilterCode::Op::kClause:
+					mov( arg1, rbx );
+					mov( arg2.cvt32(), arg );
+					mov( rax, (size_t)a_testClause );
+					call( rax );
+					break;
+
+				case FilterCode::Op::kRace:
+					{
+						Xbyak::Label noRaceLbl, nextLbl;
+						mov( eax, dword[ r12 + offsetof( FilterFields, raceIndex ) ] );
+						cmp( eax, FilterFields::kNoRace );
+						je( noRaceLbl );
+						mov( rcx, (size_t)( a_code.raceWords.data() + arg ) );
+						bt( qword[ rcx ], rax );
+						setc( al );
+						jmp( nextLbl );
+						L( noRaceLbl );
+						xor_( eax, eax );
+						L( nextLbl );
+					}
+					break;
+
+				case FilterCode::Op::kSex:
+				case FilterCode::Op::kAmmo:
+					{
+						// Unknown value passes: sex kNoSex, ammo Both
+						bool isSex = code[ i ].op == FilterCode::Op::kSex;
+						movzx( ecx, byte[ r12 + ( isSex ? offsetof( FilterFields, sex ) : offsetof( FilterFields, ammo ) ) ] );
+						cmp( cl, isSex ? FilterFields::kNoSex : (uint8_t)AmmoType::Both );
+						sete( al );
+						cmp( cl, (uint8_t)arg );
+						sete( dl );
+						or_( al, dl );
+					}
+					break;
+
+				case FilterCode::Op::kBase:
+					mov( arg1, (size_t)&a_code );
+					mov( arg2, r12 );
+					mov( arg3.cvt32(), arg );
+					mov( rax, (size_t)&FilterJIT::TestBase );
+					call( rax );
+					break;
+
+				case FilterCode::Op::kNot:
+					xor_( al, 1 );
+					break;
+
+				case FilterCode::Op::kJump:
+					jmp( labels[ arg - begin ], T_NEAR );
+					break;
+
+				case FilterCode::Op::kJumpIfFalse:
+					test( al, al );
+					jz( labels[ arg - begin ], T_NEAR );
+					break;
+
+				case FilterCode::Op::kReturnIfFalse:
+					test( al, al );
+					jz( returnLbl, T_NEAR );
+					break;
+
+				case FilterCode::Op::kReturn:
+					jmp( returnLbl, T_NEAR );
+					break;
+
+				case FilterCode::Op::kReturnTrue:
+					mov( al, 1 );
+					jmp( returnLbl, T_NEAR );
+					break;
+
+				case FilterCode::Op::kReturnFalse:
+					xor_( eax, eax );
+					jmp( returnLbl, T_NEAR );
+					break;
+				}
+			}
+
+			L( returnLbl );
+			add( rsp, 40 );
+			pop( r12 );
+			pop( rbx );
+			ret();
+		}
+
+		ready();
+	}
+};
+
+bool FilterJIT::IsAvailable()
+{
+	return true;
+}
+
+FilterJIT::FilterJIT( const FilterCode& a_code, ClauseHelper a_testClause )
+{
+	try
+	{
+		generator = std::make_unique<Generator>( a_code, a_testClause, entries );
+	}
+	catch( Xbyak::Error& e )
+	{
+		throw std::runtime_error( e.what() );
+	}
+}
+
+#else
+
+struct FilterJIT::Generator
+{
+};
+
+bool FilterJIT::IsAvailable()
+{
+	return false;
+}
+
+FilterJIT::FilterJIT( const FilterCode&, ClauseHelper )
+{
+	throw std::runtime_error( "built without xbyak" );
+}
+
+#endif
+
+FilterJIT::~FilterJIT() = default;
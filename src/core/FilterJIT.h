@@ -0,0 +1,42 @@
+#pragma once
+
+#include "FilterCode.h"
+
+// Native x86-64 code for every predicate segment of a FilterCode, generated with xbyak.
+// Only built where xbyak is found (ALD_FILTER_JIT), FilterCode::Interpret is the reference and the fallback.
+// Keyword clauses call back into the facts, the other instructions read FilterFields directly.
+class FilterJIT
+{
+public:
+	using Function		= bool (*)( void* a_facts, const FilterFields* a_fields );
+	using ClauseHelper	= bool (*)( void* a_facts, uint32_t a_clause );
+
+	static bool IsAvailable();
+
+	// Facts provide the fields and bool TestClause( uint32_t ), as for FilterCode::Interpret.
+	// Throws std::runtime_error when the code cannot be generated, a_code must outlive the JIT.
+	template <class Facts>
+	static std::unique_ptr<FilterJIT> Create( const FilterCode& a_code )
+	{
+		return std::unique_ptr<FilterJIT>( new FilterJIT( a_code, []( void* a_facts, uint32_t a_clause ) { return static_cast<Facts*>( a_facts )->TestClause( a_clause ); } ) );
+	}
+
+	~FilterJIT();
+
+	FilterJIT( const FilterJIT& ) = delete;
+	FilterJIT& operator=( const FilterJIT& ) = delete;
+
+	// Same result as FilterCode::Interpret( a_entry, a_facts ), with the facts type the JIT was created for
+	template <class Facts>
+	bool Run( uint32_t a_entry, Facts& a_facts ) const { return entries[ a_entry ]( &a_facts, &a_facts.fields ); }
+
+private:
+	struct Generator;
+
+	FilterJIT( const FilterCode& a_code, ClauseHelper a_testClause );
+
+	static bool TestBase( const FilterCode* a_code, const FilterFields* a_fields, uint32_t a_set ) { return a_code->TestBase( *a_fields, a_set ); }
+
+	std::unique_ptr<Generator>	generator;
+	std::vector<Function>		entries;	// Indexed by entry, null for other instructions
+};
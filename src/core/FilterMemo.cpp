@@ -0,0 +1,34 @@
+#include "FilterMemo.h"
+
+FilterMemo::Entry& FilterMemo::GetEntry( const Key& a_key )
+{
+	thread_local std::array<Entry, kSize> entries;
+
+	// Weapon and ammo rarely change between the hits of a pair, they are left out of the slot
+	auto hash = ( a_key.rule * 0x9E3779B1 ) ^ ( a_key.shooter * 0x85EBCA6B ) ^ ( a_key.target * 0xC2B2AE35 );
+	return entries[ ( hash ^ ( hash >> 16 ) ) % kSize ];
+}
+
+FilterMemo::Result FilterMemo::Find( const Key& a_key )
+{
+	auto& entry = GetEntry( a_key );
+	if( entry.key != a_key ||
+		entry.shooterGeneration != GetGeneration( a_key.shooter ).load( std::memory_order_relaxed ) ||
+		entry.targetGeneration != GetGeneration( a_key.target ).load( std::memory_order_relaxed ) )
+		return Result::kUnknown;
+
+	if( Clock::now() >= entry.expireTime )
+		return Result::kUnknown;
+
+	return entry.isPassed ? Result::kPassed : Result::kFailed;
+}
+
+void FilterMemo::Store( const Key& a_key, bool a_isPassed, long a_durationMs )
+{
+	auto& entry = GetEntry( a_key );
+	entry.key				= a_key;
+	entry.shooterGeneration	= GetGeneration( a_key.shooter ).load( std::memory_order_relaxed );
+	entry.targetGeneration	= GetGeneration( a_key.target ).load( std::memory_order_relaxed );
+	entry.isPassed			= a_isPassed;
+	entry.expireTime		= Clock::now() + std::chrono::milliseconds( a_durationMs );
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Short lived per thread cache of the deterministic part of a rule evaluation, keyed by (rule, shooter, target, weapon, ammo).
+// A volley from the same archer at the same target reuses the filter outcome instead of evaluating every filter again.
+// The plugin invalidates the entries of an actor on its equip and active effect events, the success chance roll is never cached.
+class FilterMemo
+{
+public:
+	enum class Result : uint8_t
+	{
+		kUnknown,
+		kFailed,
+		kPassed
+	};
+
+	struct Key
+	{
+		uint32_t	ruleSetGeneration = 0;	// Settings::RuleSet::generation, 0 is never published
+		uint32_t	rule = 0;
+		uint32_t	shooter = 0;			// Form IDs, 0 without shooter
+		uint32_t	target = 0;
+		uint32_t	weapon = 0;				// Of the projectile, weapon keyword clauses test it and its ammo
+		uint32_t	ammo = 0;				// Ammo type clauses test it too
+
+		bool operator==( const Key& ) const = default;
+	};
+
+	static constexpr uint32_t kSize = 256;	// Entries per thread, direct mapped
+
+	// Callers skip the memo when '[Settings] FilterMemoMs' of their rule set is 0
+	static Result Find( const Key& a_key );
+	static void Store( const Key& a_key, bool a_isPassed, long a_durationMs );
+
+	// Entries of the actor, and of the few actors sharing its generation, are evaluated again
+	static void Invalidate( uint32_t a_actor ) { GetGeneration( a_actor ).fetch_add( 1, std::memory_order_relaxed ); }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Entry
+	{
+		Key					key;
+		uint32_t			shooterGeneration = 0;
+		uint32_t			targetGeneration = 0;
+		Clock::time_point	expireTime;
+		bool				isPassed = false;
+	};
+
+	static constexpr uint32_t kGenerationCount = 1024;
+
+	static Entry& GetEntry( const Key& a_key );
+
+	static std::atomic<uint32_t>& GetGeneration( uint32_t a_actor ) { return generations[ ( a_actor * 0x9E3779B1 ) >> 22 ]; }
+
+	static inline std::array<std::atomic<uint32_t>, kGenerationCount> generations{};	// Indexed by actor hash
+};
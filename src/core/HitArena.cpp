@@ -0,0 +1,44 @@
+#include "HitArena.h"
+
+HitArena& HitArena::Get()
+{
+	thread_local HitArena arena;
+	return arena;
+}
+
+void* HitArena::Allocate( size_t a_size, size_t a_alignment )
+{
+	// Blocks left by an earlier hit are used again before a new one is allocated
+	for( ; current < blocks.size(); ++current, offset = 0 )
+	{
+		auto& block	= blocks[ current ];
+		auto base	= (uintptr_t)block.data.get();
+		auto begin	= ( ( base + offset + a_alignment - 1 ) & ~( (uintptr_t)a_alignment - 1 ) ) - base;
+		if( begin + a_size <= block.size )
+		{
+			offset = begin + a_size;
+			return block.data.get() + begin;
+		}
+	}
+
+	// Oversized requests get a block of their own
+	auto& block	= blocks.emplace_back();
+	block.size	= std::max<size_t>( kBlockSize, a_size + a_alignment );
+	block.data	= std::make_unique_for_overwrite<std::byte[]>( block.size );
+
+	auto base	= (uintptr_t)block.data.get();
+	auto begin	= ( ( base + a_alignment - 1 ) & ~( (uintptr_t)a_alignment - 1 ) ) - base;
+	current		= blocks.size() - 1;
+	offset		= begin + a_size;
+
+	return block.data.get() + begin;
+}
+
+size_t HitArena::GetCapacity() const
+{
+	size_t capacity = 0;
+	for( auto& block : blocks )
+		capacity += block.size;
+
+	return capacity;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// Bump allocator for the transient data of one hit, one per thread.
+// Memory comes from blocks kept from hit to hit: a Scope rewinds the arena when the hit ends, so once the blocks cover
+// the largest hit the pipeline stops using the global heap. Deallocating is a no-op, everything goes at once.
+class HitArena
+{
+public:
+	static constexpr size_t kBlockSize = 16 * 1024;
+
+	HitArena() = default;
+
+	HitArena( const HitArena& ) = delete;
+	HitArena& operator=( const HitArena& ) = delete;
+
+	// Arena of the calling thread
+	static HitArena& Get();
+
+	void* Allocate( size_t a_size, size_t a_alignment );
+
+	// Bytes owned by the blocks, used or not
+	size_t GetCapacity() const;
+
+	struct Mark
+	{
+		size_t	block = 0;
+		size_t	offset = 0;
+	};
+
+	Mark GetMark() const { return { current, offset }; }
+
+	// Free everything allocated since the mark, the blocks are kept
+	void Rewind( const Mark& a_mark )
+	{
+		current	= a_mark.block;
+		offset	= a_mark.offset;
+	}
+
+	// Rewinds the thread arena to where it was when the scope started. Scopes nest, a hit inside a hit keeps the outer data.
+	class Scope
+	{
+	public:
+		Scope() :
+			arena( Get() ), mark( arena.GetMark() ) {}
+
+		~Scope() { arena.Rewind( mark ); }
+
+		Scope( const Scope& ) = delete;
+		Scope& operator=( const Scope& ) = delete;
+
+	private:
+		HitArena&	arena;
+		Mark		mark;
+	};
+
+	// Standard allocator over an arena, for containers that do not outlive the Scope they are created in
+	// and do not grow inside a nested Scope
+	template <class T>
+	class Allocator
+	{
+	public:
+		using value_type = T;
+
+		Allocator() :
+			arena( &Get() ) {}
+
+		explicit Allocator( HitArena& a_arena ) :
+			arena( &a_arena ) {}
+
+		template <class U>
+		Allocator( const Allocator<U>& a_other ) :
+			arena( a_other.arena ) {}
+
+		T* allocate( size_t a_count ) { return static_cast<T*>( arena->Allocate( a_count * sizeof( T ), alignof( T ) ) ); }
+		void deallocate( T*, size_t ) {}
+
+		template <class U>
+		bool operator==( const Allocator<U>& a_other ) const { return arena == a_other.arena; }
+
+	private:
+		template <class U>
+		friend class Allocator;
+
+		HitArena*	arena;
+	};
+
+private:
+	struct Block
+	{
+		std::unique_ptr<std::byte[]>	data;
+		size_t							size = 0;
+	};
+
+	std::vector<Block>	blocks;
+	size_t				current = 0;	// Block in use, the ones after it are free
+	size_t				offset = 0;		// Bytes used in the current block
+};
+
+template <class T>
+using ArenaVector = std::vector<T, HitArena::Allocator<T>>;
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, HitArena::Allocator<char>>;
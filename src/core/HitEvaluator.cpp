@@ -0,0 +1,261 @@
+#include "HitEvaluator.h"
+#include "NodeSearch.h"
+#include "ShotDifficulty.h"
+#include "SnapshotFilter.h"
+
+// Filters of one recorded hit, with facts for the compiled filters shared by every rule
+class HitEvaluator::Filters
+{
+public:
+	Filters( const FilterCode* a_code, const HitRecord& a_record ) :
+		record( a_record ), code( a_code ),
+		target( &a_record.target ), shooter( a_record.hasShooter ? &a_record.shooter : nullptr ), projectile( &a_record.projectile )
+	{
+		if( code )
+		{
+			targetFacts.emplace( *code, target, projectile );
+			shooterFacts.emplace( *code, shooter, projectile );
+		}
+	}
+
+	// Predicates of a rule whose chance passed. A deferred perk condition is left to the caller.
+	bool IsRulePassed( const LocationRule& a_location, uint32_t a_rule, bool a_defersCondition )
+	{
+		return a_location.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+		{
+			switch( a_predicate )
+			{
+			case LocationRule::kTargetFilter:
+				return IsPassed( a_location.targetFilter, target, targetFacts );
+
+			case LocationRule::kShooterFilter:
+				return IsPassed( a_location.shooterFilter, shooter, shooterFacts );
+
+			case LocationRule::kCondition:
+				return a_defersCondition || IsConditionPassed( a_location, a_rule );
+			}
+
+			return true;
+		}, a_location.isConditionPinned ? 1 << LocationRule::kCondition : 0 );
+	}
+
+	bool IsConditionPassed( const LocationRule& a_location, uint32_t a_rule ) const
+	{
+		return a_location.perkConditionCopy.empty() || !record.IsConditionFailed( a_rule );
+	}
+
+private:
+	bool IsPassed( const ActorFilter& a_filter, const ActorSnapshot* a_actor, std::optional<SnapshotFacts>& a_facts )
+	{
+		return code ? a_facts->Evaluate( a_filter ) : SnapshotFilter::IsVaild( a_filter, a_actor, projectile );
+	}
+
+	const HitRecord&				record;
+	const FilterCode*				code;
+	const ActorSnapshot*			target;
+	const ActorSnapshot*			shooter;
+	const ProjectileSnapshot*		projectile;
+	std::optional<SnapshotFacts>	targetFacts;
+	std::optional<SnapshotFacts>	shooterFacts;
+};
+
+HitEvaluator::HitEvaluator( const RuleData& a_rules, const RuleCompiler::Options& a_options, const FilterCode* a_code ) :
+	rules( a_rules ), options( a_options ), code( a_code )
+{
+}
+
+HitDecision HitEvaluator::Evaluate( const HitRecord& a_record, std::minstd_rand& a_random ) const
+{
+	HitDecision decision;
+	Evaluate( a_record, a_random, decision );
+
+	return decision;
+}
+
+void HitEvaluator::Evaluate( const HitRecord& a_record, std::minstd_rand& a_random, HitDecision& a_decision, std::minstd_rand* a_effectRandom ) const
+{
+	auto& decision = a_decision;
+	decision.node		= -1;
+	decision.damageMult	= 1;
+	decision.damage		= a_record.damage;
+	decision.expMult	= 1;
+	decision.rules.clear();
+	decision.effects.clear();
+
+	auto hitPart = FindHitNode( a_record );
+	if( !hitPart )
+		return;
+
+	decision.node = a_record.skeleton.IndexOf( hitPart );
+
+	auto& effectRandom	= a_effectRandom ? *a_effectRandom : a_random;
+	float difficulty	= 1;
+	Filters filters( code, a_record );
+
+	auto& hotRules = rules.hotRules;
+	auto& nodeMatch = rules.MatchNode( hitPart->name );
+	for( uint32_t ruleIndex = 0; ruleIndex < hotRules.size(); ++ruleIndex )
+	{
+		if( !nodeMatch.IsRuleMatched( ruleIndex ) )
+			continue;
+
+		// The chance is always rolled first so the random sequence does not depend on the predicate order
+		if( !RandomPercent( a_random, GetSuccessChance( ruleIndex, a_record.target.maxHealth, decision.damage ) ) )
+			continue;
+
+		if( !filters.IsRulePassed( rules.locations[ ruleIndex ], ruleIndex, false ) )
+			continue;
+
+		TriggerRule( ruleIndex, a_record, effectRandom, decision, difficulty );
+
+		// Stop processing further locations if not required to do so.
+		if( !hotRules.Has( ruleIndex, HotRules::kContinue ) )
+			break;
+	}
+
+	FinishHit( a_record, difficulty, decision );
+}
+
+bool HitEvaluator::EvaluateBatched( const HitRecord& a_record, std::minstd_rand& a_scanRandom, std::minstd_rand& a_effectRandom, HitDecision& a_decision ) const
+{
+	auto& decision = a_decision;
+	decision.node		= -1;
+	decision.damageMult	= 1;
+	decision.damage		= a_record.damage;
+	decision.expMult	= 1;
+	decision.rules.clear();
+	decision.effects.clear();
+
+	auto hitPart = FindHitNode( a_record );
+	if( !hitPart )
+		return true;
+
+	auto& hotRules = rules.hotRules;
+	auto& nodeMatch = rules.MatchNode( hitPart->name );
+	if( !nodeMatch.isBatchable )
+		return false;
+
+	decision.node = a_record.skeleton.IndexOf( hitPart );
+
+	// Scan: a rule with a perk condition is a candidate, only a rule sure to trigger scales the damage or ends the scan
+	struct Candidate
+	{
+		uint32_t	rule;
+		bool		isConditionPending;
+	};
+
+	std::vector<Candidate> candidates;
+	Filters filters( code, a_record );
+	float damage = a_record.damage;
+	for( uint32_t ruleIndex = 0; ruleIndex < hotRules.size(); ++ruleIndex )
+	{
+		if( !nodeMatch.IsRuleMatched( ruleIndex ) )
+			continue;
+
+		if( !RandomPercent( a_scanRandom, GetSuccessChance( ruleIndex, a_record.target.maxHealth, damage ) ) )
+			continue;
+
+		if( !filters.IsRulePassed( rules.locations[ ruleIndex ], ruleIndex, true ) )
+			continue;
+
+		bool isConditionPending = hotRules.Has( ruleIndex, HotRules::kCondition );
+		candidates.push_back( { ruleIndex, isConditionPending } );
+		if( !isConditionPending )
+		{
+			if( !hotRules.Has( ruleIndex, HotRules::kContinue ) )
+				break;
+
+			damage *= hotRules.damageMult[ ruleIndex ];
+		}
+	}
+
+	// Apply: conditions, then the triggered rules in order
+	float difficulty = 1;
+	for( auto& candidate : candidates )
+	{
+		if( candidate.isConditionPending && !filters.IsConditionPassed( rules.locations[ candidate.rule ], candidate.rule ) )
+			continue;
+
+		TriggerRule( candidate.rule, a_record, a_effectRandom, decision, difficulty );
+		if( !hotRules.Has( candidate.rule, HotRules::kContinue ) )
+			break;
+	}
+
+	FinishHit( a_record, difficulty, decision );
+	return true;
+}
+
+const SkeletonSnapshot::Node* HitEvaluator::FindHitNode( const HitRecord& a_record ) const
+{
+	auto& skeleton = a_record.skeleton;
+	const SkeletonSnapshot::Node* hitPart = nullptr;
+
+	// Use impact result directly
+	if( a_record.impactNode >= 0 && a_record.impactNode < (int32_t)skeleton.nodes.size() )
+		hitPart = &skeleton.nodes[ a_record.impactNode ];
+
+	// Search manually if no impact data
+	if( ( !hitPart || options.ignoreHitboxCheck ) && !skeleton.empty() )
+	{
+		float hitDist;
+		hitPart = NodeSearch::FindClosestHitNode<SkeletonAdapter>( skeleton.GetRoot(), a_record.impact, hitDist, a_record.target.isPlayer, rules, options.ignoreHitboxCheck );
+	}
+
+	if( !hitPart )
+		return nullptr;
+
+	// Shield node has a strange name, need to check parent
+	if( hitPart->parent >= 0 && skeleton.nodes[ hitPart->parent ].name == "SHIELD" )
+		hitPart = &skeleton.nodes[ hitPart->parent ];
+
+	return hitPart;
+}
+
+int HitEvaluator::GetSuccessChance( uint32_t a_rule, float a_maxHealth, float a_damage ) const
+{
+	auto& hotRules = rules.hotRules;
+	int finalSuccessChance = hotRules.successChance[ a_rule ];
+	if( hotRules.successHPFactor[ a_rule ] != 0 )
+	{
+		float successHPFactor = GetHPFactor( a_maxHealth, hotRules.successHPFactor[ a_rule ], a_damage, hotRules.Has( a_rule, HotRules::kSuccessHPFactorCap ) );
+		finalSuccessChance = (int)( hotRules.successChance[ a_rule ] * successHPFactor );
+	}
+
+	return finalSuccessChance;
+}
+
+void HitEvaluator::TriggerRule( uint32_t a_rule, const HitRecord& a_record, std::minstd_rand& a_effectRandom, HitDecision& a_decision, float& a_difficulty ) const
+{
+	auto& hotRules = rules.hotRules;
+	auto& location = rules.locations[ a_rule ];
+
+	a_decision.rules.push_back( a_rule );
+	a_decision.damageMult	*= hotRules.damageMult[ a_rule ];
+	a_decision.damage		*= hotRules.damageMult[ a_rule ];
+	a_difficulty			= std::max<float>( a_difficulty, hotRules.difficulty[ a_rule ] );
+
+	for( uint32_t effectIndex = 0; effectIndex < location.effects.size(); ++effectIndex )
+	{
+		auto& effect		= location.effects[ effectIndex ];
+		auto hpFactor		= GetHPFactor( a_record.target.maxHealth, options.hpFactor, a_decision.damage, options.effectChanceCap );
+		int finalChance		= (int)( effect.effectChance * hpFactor );
+
+		if( effect.effectID.length() > 0 && RandomPercent( a_effectRandom, finalChance ) )
+			a_decision.effects.emplace_back( a_rule, effectIndex );
+	}
+}
+
+void HitEvaluator::FinishHit( const HitRecord& a_record, float a_difficulty, HitDecision& a_decision ) const
+{
+	bool shooterIsPlayer = a_record.hasShooter && a_record.shooter.isPlayer;
+	if( shooterIsPlayer && ( options.enableDifficultyBonus || options.enableLocationMultiplier ) )
+	{
+		if( !a_decision.rules.empty() && options.enableLocationMultiplier && a_difficulty > 1 )
+			a_decision.expMult += a_difficulty - 1;
+
+		if( options.enableDifficultyBonus )
+			a_decision.expMult *= ShotDifficulty::Compute( a_record.projectile.shot, options.shotDifficultyTimeFactor, options.shotDifficultyDistFactor, options.shotDifficultyMoveFactor );
+
+		a_decision.expMult = std::min<float>( options.shotDifficultyMax, a_decision.expMult );
+	}
+}
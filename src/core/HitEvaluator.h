@@ -0,0 +1,75 @@
+#pragma once
+
+#include "HitRecord.h"
+#include "RuleCompiler.h"
+#include "FilterCode.h"
+
+// Rules triggered by one recorded hit and the multipliers they produce
+struct HitDecision
+{
+	int32_t										node = -1;			// Skeleton index of the hit node, -1 when no node was found
+	std::vector<uint32_t>						rules;				// Triggered rules in evaluation order
+	std::vector<std::pair<uint32_t, uint32_t>>	effects;			// Rule and effect index of every effect that passed its chance
+	float										damageMult = 1;
+	float										damage = 0;			// Hit damage after the triggered multipliers, as g_fLastHitDamage
+	float										expMult = 1;		// Experience multiplier of a player shooter, clamped like the plugin
+};
+
+// Decision part of ApplyLocationalDamageVariant over a HitRecord: node search, rule scan, success and effect rolls,
+// filters, conditions and experience. Side effects (casts, sounds, notifications) are left to the caller.
+class HitEvaluator
+{
+public:
+	// Filters run through a_code when given, through SnapshotFilter otherwise
+	HitEvaluator( const RuleData& a_rules, const RuleCompiler::Options& a_options, const FilterCode* a_code = nullptr );
+
+	// Rolls use a_random the way the plugin uses rand(), the same seed gives the same decision
+	HitDecision Evaluate( const HitRecord& a_record, std::minstd_rand& a_random ) const;
+
+	// Same into a reused decision, whose vectors keep their capacity from hit to hit.
+	// Effect chances roll from a_effectRandom when given, a_random otherwise.
+	void Evaluate( const HitRecord& a_record, std::minstd_rand& a_random, HitDecision& a_decision, std::minstd_rand* a_effectRandom = nullptr ) const;
+
+	// Decision of the frame batch, LocationalDamage::ScanBatchedHit then ApplyBatchedHitVariant: success chances and filters
+	// are scanned with a_scanRandom before any perk condition is known, conditions and effect rolls follow in rule order.
+	// Returns false for a hit the batch leaves to the inline pipeline (NodeMatchCache::Entry::isBatchable).
+	bool EvaluateBatched( const HitRecord& a_record, std::minstd_rand& a_scanRandom, std::minstd_rand& a_effectRandom, HitDecision& a_decision ) const;
+
+	// Same formula as LocationalDamage::GetHPFactor
+	static float GetHPFactor( float a_maxHealth, float a_factor, float a_damage, bool a_isCap )
+	{
+		// Prevent divide by zero
+		if( a_maxHealth == 0 )
+			return 1;
+
+		float factor = 1;
+		if( a_factor > 0 )
+			factor = a_damage / a_maxHealth / a_factor;
+		else if( a_factor < 0 )
+			factor = 1 / ( a_damage / a_maxHealth / -a_factor );
+
+		return a_isCap ? std::min<float>( factor, 1 ) : factor;
+	}
+
+	static bool RandomPercent( std::minstd_rand& a_random, int a_percent )
+	{
+		return (int)( a_random() % 100 ) <= a_percent;
+	}
+
+private:
+	class Filters;
+
+	// Hit node of the record, null when there is none
+	const SkeletonSnapshot::Node* FindHitNode( const HitRecord& a_record ) const;
+
+	int GetSuccessChance( uint32_t a_rule, float a_maxHealth, float a_damage ) const;
+
+	// Multipliers and effect rolls of a triggered rule
+	void TriggerRule( uint32_t a_rule, const HitRecord& a_record, std::minstd_rand& a_effectRandom, HitDecision& a_decision, float& a_difficulty ) const;
+
+	void FinishHit( const HitRecord& a_record, float a_difficulty, HitDecision& a_decision ) const;
+
+	const RuleData&					rules;
+	const RuleCompiler::Options&	options;
+	const FilterCode*				code;
+};
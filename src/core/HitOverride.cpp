@@ -0,0 +1,23 @@
+#include "HitOverride.h"
+
+bool HitOverrideList::Take( const void* a_aggressor, const void* a_target, const Point3& a_location, HitOverride& a_override )
+{
+	for( auto iter = overrides.begin(); iter != overrides.end(); ++iter )
+	{
+		if( iter->aggressor == a_aggressor &&
+			iter->target == a_target &&
+			iter->location == a_location )
+		{
+			a_override = *iter;
+			overrides.erase( iter );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void HitOverrideList::Expire( unsigned long long a_now )
+{
+	std::erase_if( overrides, [ a_now ]( const HitOverride& a_override ) { return a_override.expireTimestamp <= a_now; } );
+}
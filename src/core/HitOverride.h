@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Point3.h"
+
+// Damage override decided at the projectile impact and applied when the engine handles the attack of the same hit.
+// The two are correlated by aggressor, target and hit location. References and impact data are opaque engine pointers.
+struct HitOverride
+{
+	const void*			aggressor = nullptr;
+	const void*			target = nullptr;
+	Point3				location;
+	float				damageMult = 1.0f;
+	void*				impactData = nullptr;
+	unsigned long long	expireTimestamp = 0;
+};
+
+// Pending overrides, the caller serializes access
+class HitOverrideList
+{
+public:
+	// Room for the arrows of a large fight, the list only grows past it in bursts and keeps the capacity
+	static constexpr size_t kInitialCapacity = 64;
+
+	HitOverrideList() { overrides.reserve( kInitialCapacity ); }
+
+	void Add( const HitOverride& a_override ) { overrides.push_back( a_override ); }
+
+	// Remove the override recorded for the hit, false when the impact did not record one
+	bool Take( const void* a_aggressor, const void* a_target, const Point3& a_location, HitOverride& a_override );
+
+	// Drop overrides whose attack was not handled in time
+	void Expire( unsigned long long a_now );
+
+	size_t size() const { return overrides.size(); }
+	bool empty() const { return overrides.empty(); }
+
+private:
+	std::vector<HitOverride>	overrides;
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "Point3.h"
+#include "Rules.h"
+#include "ShotDifficulty.h"
+#include "IniDocument.h"
+
+// Engine independent snapshot of one impact: everything ApplyLocationalDamage reads to decide which rules fire.
+// Captured by the plugin and replayed or generated by the native tools.
+
+// Scene graph of the target flattened depth first. Children of a node follow it directly,
+// subtreeSize skips to the next sibling.
+struct SkeletonSnapshot
+{
+	struct Node
+	{
+		std::string	name;
+		Point3		position;
+		int32_t		parent = -1;
+		uint32_t	subtreeSize = 1;	// This node and all its descendants
+		bool		hasCollision = false;
+
+		template <class Archive>
+		void Serialize( Archive& a_ar )
+		{
+			a_ar( name );
+			a_ar( position );
+			a_ar( parent );
+			a_ar( subtreeSize );
+			a_ar( hasCollision );
+		}
+	};
+
+	std::vector<Node>	nodes;
+
+	bool empty() const { return nodes.empty(); }
+
+	const Node* GetRoot() const { return nodes.empty() ? nullptr : &nodes.front(); }
+	int32_t IndexOf( const Node* a_node ) const { return a_node ? (int32_t)( a_node - nodes.data() ) : -1; }
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( nodes );
+	}
+};
+
+// NodeSearch adapter of the flattened skeleton
+struct SkeletonAdapter
+{
+	using Node = const SkeletonSnapshot::Node;
+
+	static const char* GetName( Node* a_node ) { return a_node->name.c_str(); }
+
+	static bool HasCollision( Node* a_node ) { return a_node->hasCollision; }
+
+	static Point3 GetPosition( Node* a_node ) { return a_node->position; }
+
+	template <class Callback>
+	static void ForEachChild( Node* a_node, Callback&& a_callback )
+	{
+		for( auto child = a_node + 1, end = a_node + a_node->subtreeSize; child < end; child += child->subtreeSize )
+			a_callback( child );
+	}
+};
+
+// Actor facts read by the rule filters and the effect chance
+struct ActorSnapshot
+{
+	struct Effect
+	{
+		std::vector<std::string>	keywords;
+		bool						isInactive = false;
+
+		template <class Archive>
+		void Serialize( Archive& a_ar )
+		{
+			a_ar( keywords );
+			a_ar( isInactive );
+		}
+	};
+
+	uint32_t								raceID = 0;		// 0 when the actor has no race
+	std::string								raceEditorID;
+	uint32_t								baseID = 0;		// Root face NPC of the base
+	std::string								baseEditorID;	// Empty when the base has no editor ID
+	bool									hasBase = true;
+	Sex										sex = Sex::kMale;
+	float									health = 0;
+	float									maxHealth = 0;	// Base health actor value, divides the damage in the HP factors
+	bool									isPlayer = false;
+	std::vector<std::string>				keywords;		// Keywords of the base NPC, as Actor::HasKeywordString
+	std::vector<std::vector<std::string>>	wornArmors;		// Keywords of every worn armor
+	std::vector<Effect>						activeEffects;	// Keywords of the base effect of every active effect
+
+	// Keywords compare like BSFixedString, without case
+	static bool HasKeyword( const std::vector<std::string>& a_keywords, std::string_view a_keyword )
+	{
+		return std::any_of( a_keywords.begin(), a_keywords.end(), [ a_keyword ]( const std::string& a_other ) { return IniDocument::EqualsNoCase( a_other, a_keyword ); } );
+	}
+
+	bool HasKeyword( std::string_view a_keyword ) const { return HasKeyword( keywords, a_keyword ); }
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( raceID );
+		a_ar( raceEditorID );
+		a_ar( baseID );
+		a_ar( baseEditorID );
+		a_ar( hasBase );
+		a_ar( sex );
+		a_ar( health );
+		a_ar( maxHealth );
+		a_ar( isPlayer );
+		a_ar( keywords );
+		a_ar( wornArmors );
+		a_ar( activeEffects );
+	}
+};
+
+struct ProjectileSnapshot
+{
+	std::vector<std::string>	weaponKeywords;
+	std::vector<std::string>	ammoKeywords;
+	AmmoType					ammo = AmmoType::Arrow;
+	bool						hasSource = true;	// Weapon and ammo are known
+	ShotDifficultyParams		shot;
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( weaponKeywords );
+		a_ar( ammoKeywords );
+		a_ar( ammo );
+		a_ar( hasSource );
+		a_ar( shot );
+	}
+};
+
+struct HitRecord
+{
+	uint64_t				timestamp = 0;			// Microseconds since the capture started
+	Point3					impact;
+	int32_t					impactNode = -1;		// Skeleton index of the node reported by the engine, -1 when the node is searched
+	float					damage = 0;				// Damage of the hit before the location multipliers
+	bool					hasShooter = false;
+	SkeletonSnapshot		skeleton;
+	ActorSnapshot			target;
+	ActorSnapshot			shooter;
+	ProjectileSnapshot		projectile;
+	std::vector<uint32_t>	failedConditions;		// Sorted rules whose perk condition was false. Random conditions are not evaluated and pass.
+
+	bool IsConditionFailed( uint32_t a_rule ) const { return std::binary_search( failedConditions.begin(), failedConditions.end(), a_rule ); }
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( timestamp );
+		a_ar( impact );
+		a_ar( impactNode );
+		a_ar( damage );
+		a_ar( hasShooter );
+		a_ar( skeleton );
+		a_ar( target );
+		a_ar( shooter );
+		a_ar( projectile );
+		a_ar( failedConditions );
+	}
+};
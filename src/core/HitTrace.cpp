@@ -0,0 +1,123 @@
+#include "HitTrace.h"
+
+std::vector<uint8_t> TraceWriter::TakeFrame()
+{
+	BinaryWriter frame;
+	frame( newStrings );
+
+	std::vector<uint8_t> result = frame.GetBuffer();
+	result.insert( result.end(), buffer.begin(), buffer.end() );
+
+	newStrings.clear();
+	buffer.clear();
+
+	return result;
+}
+
+bool TraceReader::BeginFrame( const uint8_t* a_data, size_t a_size )
+{
+	BinaryReader frame( a_data, a_size );
+
+	std::vector<std::string> newStrings;
+	frame( newStrings );
+	if( !frame.IsGood() )
+		return false;
+
+	// Values start after the string table, its size is the size of writing it back
+	BinaryWriter table;
+	table( newStrings );
+
+	strings.insert( strings.end(), std::make_move_iterator( newStrings.begin() ), std::make_move_iterator( newStrings.end() ) );
+
+	cursor	= a_data + table.GetBuffer().size();
+	end		= a_data + a_size;
+	good	= true;
+
+	return true;
+}
+
+bool HitTraceWriter::Open( const std::filesystem::path& a_path, std::string_view a_iniText )
+{
+	Close();
+
+	stream.open( a_path, std::ios::binary | std::ios::trunc );
+	if( !stream )
+		return false;
+
+	archive = TraceWriter();
+	count	= 0;
+
+	BinaryWriter header;
+	uint32_t magic		= kMagic;
+	uint32_t version	= kVersion;
+	std::string iniText( a_iniText );
+	header( magic );
+	header( version );
+	header( iniText );
+
+	auto& buffer = header.GetBuffer();
+	stream.write( (const char*)buffer.data(), buffer.size() );
+
+	return (bool)stream;
+}
+
+void HitTraceWriter::Close()
+{
+	if( stream.is_open() )
+		stream.close();
+}
+
+bool HitTraceWriter::Write( HitRecord& a_record )
+{
+	if( !stream )
+		return false;
+
+	a_record.Serialize( archive );
+	auto frame = archive.TakeFrame();
+
+	auto frameSize = (uint32_t)frame.size();
+	stream.write( (const char*)&frameSize, sizeof( frameSize ) );
+	stream.write( (const char*)frame.data(), frame.size() );
+	++count;
+
+	return (bool)stream;
+}
+
+bool HitTraceReader::Open( const std::filesystem::path& a_path )
+{
+	stream.open( a_path, std::ios::binary );
+	if( !stream )
+		return false;
+
+	uint32_t magic = 0, version = 0, iniSize = 0;
+	stream.read( (char*)&magic, sizeof( magic ) );
+	stream.read( (char*)&version, sizeof( version ) );
+	stream.read( (char*)&iniSize, sizeof( iniSize ) );
+	if( !stream || magic != HitTraceWriter::kMagic || version != HitTraceWriter::kVersion )
+		return false;
+
+	iniText.resize( iniSize );
+	stream.read( iniText.data(), iniSize );
+	archive = TraceReader();
+
+	return (bool)stream;
+}
+
+bool HitTraceReader::Read( HitRecord& a_record )
+{
+	uint32_t frameSize = 0;
+	if( !stream.read( (char*)&frameSize, sizeof( frameSize ) ) )
+		return false;
+
+	frame.resize( frameSize );
+	if( !stream.read( (char*)frame.data(), frameSize ) )
+		return false;
+
+	if( !archive.BeginFrame( frame.data(), frame.size() ) )
+		return false;
+
+	a_record = HitRecord();
+	a_record.Serialize( archive );
+
+	return archive.IsGood() && archive.IsEnd();
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "HitRecord.h"
+#include "BinaryArchive.h"
+
+// Hit trace file: the INI the hits were captured with followed by one frame per HitRecord.
+//   header:	magic, version, INI text
+//   frame:		u32 frame size, strings first seen in this frame, record
+// Node names and keywords repeat in every hit, each string is stored once and records refer to it by index.
+
+// Archives of the same shape as BinaryWriter and BinaryReader with interned strings
+class TraceWriter
+{
+public:
+	static constexpr bool IsLoading = false;
+
+	template <class T>
+	void operator()( T& a_value )
+	{
+		if constexpr( std::is_trivially_copyable_v<T> )
+		{
+			auto bytes = reinterpret_cast<const uint8_t*>( &a_value );
+			buffer.insert( buffer.end(), bytes, bytes + sizeof( T ) );
+		}
+		else
+			a_value.Serialize( *this );
+	}
+
+	void operator()( std::string& a_value )
+	{
+		auto [ iter, isNew ] = stringIndices.try_emplace( a_value, (uint32_t)stringIndices.size() );
+		if( isNew )
+			newStrings.push_back( a_value );
+
+		(*this)( iter->second );
+	}
+
+	template <class T>
+	void operator()( std::vector<T>& a_value )
+	{
+		auto count = (uint32_t)a_value.size();
+		(*this)( count );
+		for( auto& element : a_value )
+			(*this)( element );
+	}
+
+	bool IsGood() const { return true; }
+
+	// Frame of everything written since the last call, the string table stays for the next frames
+	std::vector<uint8_t> TakeFrame();
+
+private:
+	std::unordered_map<std::string, uint32_t>	stringIndices;
+	std::vector<std::string>					newStrings;
+	std::vector<uint8_t>						buffer;
+};
+
+class TraceReader
+{
+public:
+	static constexpr bool IsLoading = true;
+
+	// Reads the string table part of a frame, values follow
+	bool BeginFrame( const uint8_t* a_data, size_t a_size );
+
+	template <class T>
+	void operator()( T& a_value )
+	{
+		if constexpr( std::is_trivially_copyable_v<T> )
+		{
+			if( !Require( sizeof( T ) ) )
+				return;
+
+			memcpy( &a_value, cursor, sizeof( T ) );
+			cursor += sizeof( T );
+		}
+		else
+			a_value.Serialize( *this );
+	}
+
+	void operator()( std::string& a_value )
+	{
+		uint32_t index = 0;
+		(*this)( index );
+		if( good && index >= strings.size() )
+			good = false;
+
+		if( good )
+			a_value = strings[ index ];
+	}
+
+	template <class T>
+	void operator()( std::vector<T>& a_value )
+	{
+		uint32_t count = 0;
+		(*this)( count );
+
+		// Every element takes at least one byte, reject counts that cannot fit in the remaining data
+		if( !Require( count ) )
+			return;
+
+		a_value.clear();
+		a_value.resize( count );
+		for( auto& element : a_value )
+		{
+			(*this)( element );
+			if( !good )
+				return;
+		}
+	}
+
+	bool IsGood() const { return good; }
+	bool IsEnd() const { return cursor == end; }
+
+private:
+	bool Require( size_t a_size )
+	{
+		if( !good || (size_t)( end - cursor ) < a_size )
+			good = false;
+
+		return good;
+	}
+
+	std::vector<std::string>	strings;
+	const uint8_t*				cursor = nullptr;
+	const uint8_t*				end = nullptr;
+	bool						good = true;
+};
+
+class HitTraceWriter
+{
+public:
+	static constexpr uint32_t kMagic	= 0x54444C41;	// "ALDT"
+	static constexpr uint32_t kVersion	= 1;			// Increase when HitRecord changes
+
+	bool Open( const std::filesystem::path& a_path, std::string_view a_iniText );
+	bool IsOpen() const { return stream.is_open(); }
+	void Close();
+
+	// Records are flushed by Close, a trace cut by a crash keeps every complete frame
+	bool Write( HitRecord& a_record );
+
+	uint32_t GetCount() const { return count; }
+
+private:
+	std::ofstream	stream;
+	TraceWriter		archive;
+	uint32_t		count = 0;
+};
+
+class HitTraceReader
+{
+public:
+	// Fails on a missing file or a trace of another version
+	bool Open( const std::filesystem::path& a_path );
+
+	const std::string& GetIni() const { return iniText; }
+
+	// False at the end of the trace or on a truncated frame
+	bool Read( HitRecord& a_record );
+
+private:
+	std::ifstream			stream;
+	std::string				iniText;
+	TraceReader				archive;
+	std::vector<uint8_t>	frame;
+};
@@ -0,0 +1,251 @@
+#include "IniDocument.h"
+
+static bool IsSpace( char a_char )
+{
+	return a_char == ' ' || a_char == '\t' || a_char == '\r' || a_char == '\n' || a_char == '\v' || a_char == '\f';
+}
+
+static char ToLower( char a_char )
+{
+	return a_char >= 'A' && a_char <= 'Z' ? a_char - 'A' + 'a' : a_char;
+}
+
+bool IniDocument::EqualsNoCase( std::string_view a_lhs, std::string_view a_rhs )
+{
+	if( a_lhs.size() != a_rhs.size() )
+		return false;
+
+	for( size_t i = 0; i < a_lhs.size(); ++i )
+	{
+		if( ToLower( a_lhs[ i ] ) != ToLower( a_rhs[ i ] ) )
+			return false;
+	}
+
+	return true;
+}
+
+std::string_view IniDocument::Trim( std::string_view a_str )
+{
+	while( !a_str.empty() && IsSpace( a_str.front() ) )
+		a_str.remove_prefix( 1 );
+
+	while( !a_str.empty() && IsSpace( a_str.back() ) )
+		a_str.remove_suffix( 1 );
+
+	return a_str;
+}
+
+void IniDocument::Load( std::string a_data )
+{
+	data = std::move( a_data );
+	sections.clear();
+
+	std::string_view content( data );
+
+	// Skip UTF-8 BOM
+	if( content.starts_with( "\xEF\xBB\xBF" ) )
+		content.remove_prefix( 3 );
+
+	std::unordered_map<std::string, size_t> sectionIndex;
+	Section* currentSection = nullptr;
+
+	while( !content.empty() )
+	{
+		auto lineEnd = content.find( '\n' );
+		auto line = Trim( content.substr( 0, lineEnd ) );
+		content.remove_prefix( lineEnd == std::string_view::npos ? content.size() : lineEnd + 1 );
+
+		if( line.empty() || line.front() == ';' || line.front() == '#' )
+			continue;
+
+		if( line.front() == '[' )
+		{
+			auto nameEnd = line.find( ']' );
+			if( nameEnd == std::string_view::npos )
+				continue;
+
+			auto name = Trim( line.substr( 1, nameEnd - 1 ) );
+
+			// Repeated sections are merged into the first one
+			std::string lowerName( name );
+			std::transform( lowerName.begin(), lowerName.end(), lowerName.begin(), ToLower );
+
+			auto [ iter, isNew ] = sectionIndex.try_emplace( std::move( lowerName ), sections.size() );
+			if( isNew )
+				sections.push_back( { name, {} } );
+
+			currentSection = &sections[ iter->second ];
+			continue;
+		}
+
+		auto separator = line.find( '=' );
+		if( separator == std::string_view::npos )
+			continue;
+
+		// Keys outside of any section go to the unnamed section
+		if( !currentSection )
+		{
+			auto [ iter, isNew ] = sectionIndex.try_emplace( std::string(), sections.size() );
+			if( isNew )
+				sections.push_back( { std::string_view(), {} } );
+
+			currentSection = &sections[ iter->second ];
+		}
+
+		currentSection->entries.push_back( { Trim( line.substr( 0, separator ) ), Trim( line.substr( separator + 1 ) ) } );
+	}
+}
+
+const IniDocument::Section* IniDocument::GetSection( std::string_view a_name ) const
+{
+	for( auto& section : sections )
+	{
+		if( EqualsNoCase( section.name, a_name ) )
+			return &section;
+	}
+
+	return nullptr;
+}
+
+std::string_view IniDocument::Section::GetValue( std::string_view a_key, std::string_view a_default ) const
+{
+	for( auto& entry : entries )
+	{
+		if( EqualsNoCase( entry.key, a_key ) )
+			return entry.value;
+	}
+
+	return a_default;
+}
+
+long IniDocument::Section::GetLongValue( std::string_view a_key, long a_default ) const
+{
+	for( auto& entry : entries )
+	{
+		if( EqualsNoCase( entry.key, a_key ) )
+			return ToLong( entry.value, a_default );
+	}
+
+	return a_default;
+}
+
+double IniDocument::Section::GetDoubleValue( std::string_view a_key, double a_default ) const
+{
+	for( auto& entry : entries )
+	{
+		if( EqualsNoCase( entry.key, a_key ) )
+			return ToDouble( entry.value, a_default );
+	}
+
+	return a_default;
+}
+
+bool IniDocument::Section::GetBoolValue( std::string_view a_key, bool a_default ) const
+{
+	for( auto& entry : entries )
+	{
+		if( EqualsNoCase( entry.key, a_key ) )
+			return ToBool( entry.value, a_default );
+	}
+
+	return a_default;
+}
+
+std::string_view IniDocument::GetValue( std::string_view a_section, std::string_view a_key, std::string_view a_default ) const
+{
+	auto section = GetSection( a_section );
+	return section ? section->GetValue( a_key, a_default ) : a_default;
+}
+
+long IniDocument::GetLongValue( std::string_view a_section, std::string_view a_key, long a_default ) const
+{
+	auto section = GetSection( a_section );
+	return section ? section->GetLongValue( a_key, a_default ) : a_default;
+}
+
+double IniDocument::GetDoubleValue( std::string_view a_section, std::string_view a_key, double a_default ) const
+{
+	auto section = GetSection( a_section );
+	return section ? section->GetDoubleValue( a_key, a_default ) : a_default;
+}
+
+bool IniDocument::GetBoolValue( std::string_view a_section, std::string_view a_key, bool a_default ) const
+{
+	auto section = GetSection( a_section );
+	return section ? section->GetBoolValue( a_key, a_default ) : a_default;
+}
+
+long IniDocument::ToLong( std::string_view a_value, long a_default )
+{
+	if( a_value.empty() )
+		return a_default;
+
+	// strtol needs a terminated string
+	char buffer[ 64 ];
+	if( a_value.size() >= sizeof( buffer ) )
+		return a_default;
+
+	memcpy( buffer, a_value.data(), a_value.size() );
+	buffer[ a_value.size() ] = '\0';
+
+	// Hexadecimal when prefixed with 0x
+	char* suffix = buffer;
+	long value;
+	if( buffer[ 0 ] == '0' && ( buffer[ 1 ] == 'x' || buffer[ 1 ] == 'X' ) )
+	{
+		if( buffer[ 2 ] == '\0' )
+			return a_default;
+
+		value = strtol( &buffer[ 2 ], &suffix, 16 );
+	}
+	else
+		value = strtol( buffer, &suffix, 10 );
+
+	return *suffix == '\0' ? value : a_default;
+}
+
+double IniDocument::ToDouble( std::string_view a_value, double a_default )
+{
+	if( a_value.empty() )
+		return a_default;
+
+	char buffer[ 64 ];
+	if( a_value.size() >= sizeof( buffer ) )
+		return a_default;
+
+	memcpy( buffer, a_value.data(), a_value.size() );
+	buffer[ a_value.size() ] = '\0';
+
+	char* suffix = buffer;
+	double value = strtod( buffer, &suffix );
+
+	return *suffix == '\0' ? value : a_default;
+}
+
+bool IniDocument::ToBool( std::string_view a_value, bool a_default )
+{
+	if( a_value.empty() )
+		return a_default;
+
+	switch( a_value[ 0 ] )
+	{
+	case 't': case 'T': // true
+	case 'y': case 'Y': // yes
+	case '1':
+		return true;
+
+	case 'f': case 'F': // false
+	case 'n': case 'N': // no
+	case '0':
+		return false;
+
+	case 'o': case 'O':
+		if( a_value.size() > 1 && ( a_value[ 1 ] == 'n' || a_value[ 1 ] == 'N' ) )
+			return true;	// on
+		if( a_value.size() > 1 && ( a_value[ 1 ] == 'f' || a_value[ 1 ] == 'F' ) )
+			return false;	// off
+		break;
+	}
+
+	return a_default;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+// Single pass INI reader that keeps the file content and hands out views into it.
+// Follows the SimpleIni conventions the settings rely on: case insensitive section and key lookup,
+// repeated keys are kept in file order, repeated sections are merged and comments start a line with ';' or '#'.
+class IniDocument
+{
+public:
+	struct Entry
+	{
+		std::string_view	key;
+		std::string_view	value;
+	};
+
+	struct Section
+	{
+		std::string_view	name;
+		std::vector<Entry>	entries;
+
+		// First value of the key, a_default if the key does not exist
+		std::string_view GetValue( std::string_view a_key, std::string_view a_default = {} ) const;
+		long GetLongValue( std::string_view a_key, long a_default ) const;
+		double GetDoubleValue( std::string_view a_key, double a_default ) const;
+		bool GetBoolValue( std::string_view a_key, bool a_default ) const;
+	};
+
+	void Load( std::string a_data );
+
+	const std::vector<Section>& GetSections() const { return sections; }
+	const Section* GetSection( std::string_view a_name ) const;
+
+	std::string_view GetValue( std::string_view a_section, std::string_view a_key, std::string_view a_default = {} ) const;
+	long GetLongValue( std::string_view a_section, std::string_view a_key, long a_default ) const;
+	double GetDoubleValue( std::string_view a_section, std::string_view a_key, double a_default ) const;
+	bool GetBoolValue( std::string_view a_section, std::string_view a_key, bool a_default ) const;
+
+	static bool EqualsNoCase( std::string_view a_lhs, std::string_view a_rhs );
+	static std::string_view Trim( std::string_view a_str );
+
+	// Value conversions with SimpleIni semantic, a_default is returned for malformed values
+	static long ToLong( std::string_view a_value, long a_default );
+	static double ToDouble( std::string_view a_value, double a_default );
+	static bool ToBool( std::string_view a_value, bool a_default );
+
+private:
+	std::string				data;
+	std::vector<Section>	sections;
+};
+
+// Split a string on every run of delimiter characters.
+// Same tokens as the regex based split: an empty input or a leading delimiter produces an empty token, a trailing delimiter does not.
+inline std::vector<std::string_view> SplitString( std::string_view a_input, std::string_view a_delimiters, bool a_mergeDelimiters )
+{
+	std::vector<std::string_view> tokens;
+	if( a_input.empty() )
+	{
+		tokens.push_back( a_input );
+		return tokens;
+	}
+
+	size_t start = 0;
+	while( start < a_input.size() )
+	{
+		auto delimiter = a_input.find_first_of( a_delimiters, start );
+		if( delimiter == std::string_view::npos )
+			break;
+
+		tokens.push_back( a_input.substr( start, delimiter - start ) );
+
+		start = delimiter + 1;
+		if( a_mergeDelimiters )
+		{
+			start = a_input.find_first_not_of( a_delimiters, start );
+			if( start == std::string_view::npos )
+				start = a_input.size();
+		}
+	}
+
+	if( start < a_input.size() )
+		tokens.push_back( a_input.substr( start ) );
+
+	return tokens;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Point3.h"
+#include "Rules.h"
+
+namespace NodeSearch
+{
+	// Closest node with a hit box to a point, over any scene graph.
+	// The adapter gives access to the nodes with static members:
+	//   const char* GetName( const Node* )
+	//   bool HasCollision( const Node* )
+	//   Point3 GetPosition( const Node* )
+	//   void ForEachChild( Node*, callback( Node* ) ), children that are not nodes are skipped
+	// Exclude and player node patterns of the rule set are looked up in its node match cache.
+	template <class Adapter, class Node>
+	Node* FindClosestHitNode( Node* a_root, const Point3& a_pos, float& a_dist, bool a_isPlayer, const RuleData& a_rules, bool a_ignoreHitboxCheck = false )
+	{
+		float childMinDist = 1000000;
+		Node* childNode = nullptr;
+		Adapter::ForEachChild( a_root, [ & ]( Node* a_child )
+		{
+			float childDist;
+			auto childHit = FindClosestHitNode<Adapter>( a_child, a_pos, childDist, a_isPlayer, a_rules );
+
+			if( childDist < childMinDist )
+			{
+				childMinDist = childDist;
+				childNode = childHit;
+			}
+		});
+
+		// Only check against node with collision object
+		// Or if player is in first person mode then all of the nodes will not having any collision object
+		if( a_ignoreHitboxCheck || a_isPlayer || Adapter::HasCollision( a_root ) )
+		{
+			// Do not check excluded node
+			auto& match = a_rules.MatchNode( Adapter::GetName( a_root ) );
+			if( !match.isExcluded )
+			{
+				if( !a_isPlayer || match.isPlayerNode )
+				{
+					a_dist = Adapter::GetPosition( a_root ).GetSquaredDistance( a_pos );
+
+					if( childMinDist < a_dist )
+					{
+						a_dist = childMinDist;
+						return childNode;
+					}
+
+					return a_root;
+				}
+			}
+		}
+
+		if( childNode )
+		{
+			a_dist = childMinDist;
+			return childNode;
+		}
+
+		a_dist = 1000000;
+		return nullptr;
+	}
+
+	// Hit node candidates of a player tree, as FindClosestHitNode with a_isPlayer sees them: nodes that are not excluded
+	// and match the player node pattern, whatever their hit box. Valid as long as the tree and the rule set do not change.
+	template <class Node>
+	struct PlayerNodes
+	{
+		Node*				root = nullptr;		// The root when it is a candidate, it is picked on a tie like in the search
+		std::vector<Node*>	nodes;				// Candidates below the root in visiting order
+	};
+
+	template <class Adapter, class Node>
+	void CollectPlayerNodes( Node* a_root, const RuleData& a_rules, PlayerNodes<Node>& a_result, bool a_isRoot = true )
+	{
+		auto& match = a_rules.MatchNode( Adapter::GetName( a_root ) );
+		if( !match.isExcluded && match.isPlayerNode )
+		{
+			if( a_isRoot )
+				a_result.root = a_root;
+			else
+				a_result.nodes.push_back( a_root );
+		}
+
+		Adapter::ForEachChild( a_root, [ & ]( Node* a_child )
+		{
+			CollectPlayerNodes<Adapter>( a_child, a_rules, a_result, false );
+		});
+	}
+
+	// Same node and distance as FindClosestHitNode with a_isPlayer over the tree the candidates come from.
+	// The first of equal candidates in visiting order wins and only the root may be farther than the search range.
+	template <class Adapter, class Node>
+	Node* FindClosestPlayerNode( const PlayerNodes<Node>& a_candidates, const Point3& a_pos, float& a_dist )
+	{
+		float minDist = 1000000;
+		Node* closest = nullptr;
+		for( auto node : a_candidates.nodes )
+		{
+			float dist = Adapter::GetPosition( node ).GetSquaredDistance( a_pos );
+			if( dist < minDist )
+			{
+				minDist = dist;
+				closest = node;
+			}
+		}
+
+		if( a_candidates.root )
+		{
+			a_dist = Adapter::GetPosition( a_candidates.root ).GetSquaredDistance( a_pos );
+			if( minDist < a_dist )
+			{
+				a_dist = minDist;
+				return closest;
+			}
+
+			return a_candidates.root;
+		}
+
+		a_dist = closest ? minDist : 1000000;
+		return closest;
+	}
+}
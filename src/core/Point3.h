@@ -0,0 +1,19 @@
+#pragma once
+
+// Position in game units, same layout as RE::NiPoint3
+struct Point3
+{
+	float	x = 0;
+	float	y = 0;
+	float	z = 0;
+
+	bool operator==( const Point3& a_rhs ) const { return x == a_rhs.x && y == a_rhs.y && z == a_rhs.z; }
+
+	float GetSquaredDistance( const Point3& a_other ) const
+	{
+		float dx = x - a_other.x;
+		float dy = y - a_other.y;
+		float dz = z - a_other.z;
+		return dx * dx + dy * dy + dz * dz;
+	}
+};
@@ -0,0 +1,147 @@
+#pragma once
+
+// Runtime ordering of independent predicates, cheapest and most selective first.
+// Predicates must not have side effects: only the evaluation order changes, never the result.
+// Only a random sample of the evaluations is measured, the others leave the shared statistics untouched.
+template <uint32_t N>
+class PredicateOrder
+{
+public:
+	static_assert( N <= 8, "Order is packed with 4 bits per predicate" );
+
+	static constexpr uint32_t kSampleInterval	= 16;	// One evaluation out of kSampleInterval is measured, on average
+	static constexpr uint32_t kReorderSamples	= 16;	// Measured evaluations between two reorders
+
+	PredicateOrder() { Reset(); }
+
+	// Statistics belong to a rule set instance, a copy starts over
+	PredicateOrder( const PredicateOrder& ) : PredicateOrder() {}
+	PredicateOrder& operator=( const PredicateOrder& )
+	{
+		Reset();
+		return *this;
+	}
+
+	// Evaluate a_predicate( index ) for every predicate until one fails.
+	// Pinned predicates are evaluated last in index order, for predicates whose short circuit must not change.
+	template <class Predicate>
+	bool Evaluate( Predicate&& a_predicate, uint32_t a_pinnedMask = 0 ) const
+	{
+		bool isSampled = IsSampled();
+		if( isSampled && ( sampleCount.fetch_add( 1, std::memory_order_relaxed ) + 1 ) % kReorderSamples == 0 )
+			Reorder();
+
+		auto order = packedOrder.load( std::memory_order_relaxed );
+		for( uint32_t i = 0; i < N; ++i )
+		{
+			auto index = ( order >> ( i * 4 ) ) & 0xF;
+			if( !( a_pinnedMask & ( 1 << index ) ) && !Test( a_predicate, index, isSampled ) )
+				return false;
+		}
+
+		for( uint32_t index = 0; index < N; ++index )
+		{
+			if( ( a_pinnedMask & ( 1 << index ) ) && !Test( a_predicate, index, isSampled ) )
+				return false;
+		}
+
+		return true;
+	}
+
+	uint32_t GetIndex( uint32_t a_position ) const { return ( packedOrder.load( std::memory_order_relaxed ) >> ( a_position * 4 ) ) & 0xF; }
+
+	void Reset()
+	{
+		uint32_t order = 0;
+		for( uint32_t i = 0; i < N; ++i )
+		{
+			order |= i << ( i * 4 );
+			stats[ i ].evaluated.store( 0, std::memory_order_relaxed );
+			stats[ i ].rejected.store( 0, std::memory_order_relaxed );
+			stats[ i ].nanoseconds.store( 0, std::memory_order_relaxed );
+		}
+
+		packedOrder.store( order, std::memory_order_relaxed );
+		sampleCount.store( 0, std::memory_order_relaxed );
+	}
+
+private:
+	struct Stats
+	{
+		std::atomic<uint32_t>	evaluated;
+		std::atomic<uint32_t>	rejected;
+		std::atomic<uint64_t>	nanoseconds;
+	};
+
+	// Per thread xorshift, sampling does not depend on how evaluations of several instances interleave
+	static bool IsSampled()
+	{
+		thread_local uint32_t state = (uint32_t)reinterpret_cast<uintptr_t>( &state ) | 1;
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return ( state & ( kSampleInterval - 1 ) ) == 0;
+	}
+
+	template <class Predicate>
+	bool Test( Predicate& a_predicate, uint32_t a_index, bool a_isSampled ) const
+	{
+		if( !a_isSampled )
+			return a_predicate( a_index );
+
+		auto start = std::chrono::steady_clock::now();
+		bool result = a_predicate( a_index );
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - start ).count();
+
+		auto& stat = stats[ a_index ];
+		stat.evaluated.fetch_add( 1, std::memory_order_relaxed );
+		stat.nanoseconds.fetch_add( (uint64_t)elapsed, std::memory_order_relaxed );
+		if( !result )
+			stat.rejected.fetch_add( 1, std::memory_order_relaxed );
+
+		return result;
+	}
+
+	// Sort by expected cost per rejection (cost / rejection rate) and decay the statistics so the order follows the current fight.
+	// A predicate that was never reached ranks first, which gives it a chance to be measured.
+	// Samples recorded meanwhile are kept, a reorder still running skips the next one instead of halving twice.
+	void Reorder() const
+	{
+		if( isReordering.exchange( true, std::memory_order_acquire ) )
+			return;
+
+		std::array<uint32_t, N> indices;
+		std::array<double, N> ranks;
+		for( uint32_t i = 0; i < N; ++i )
+		{
+			auto& stat = stats[ i ];
+			auto evaluated		= stat.evaluated.load( std::memory_order_relaxed );
+			auto rejected		= stat.rejected.load( std::memory_order_relaxed );
+			auto nanoseconds	= stat.nanoseconds.load( std::memory_order_relaxed );
+			double cost			= evaluated ? (double)nanoseconds / evaluated : 0;
+			double rejection	= evaluated ? (double)std::min( rejected, evaluated ) / evaluated : 0;
+
+			indices[ i ] = GetIndex( i );
+			ranks[ i ] = cost / std::clamp( rejection, 0.001, 1.0 );
+
+			stat.evaluated.fetch_sub( evaluated / 2, std::memory_order_relaxed );
+			stat.rejected.fetch_sub( rejected / 2, std::memory_order_relaxed );
+			stat.nanoseconds.fetch_sub( nanoseconds / 2, std::memory_order_relaxed );
+		}
+
+		// Stable to keep the current order between predicates of equal rank
+		std::stable_sort( indices.begin(), indices.end(), [ &ranks ]( uint32_t a_lhs, uint32_t a_rhs ) { return ranks[ a_lhs ] < ranks[ a_rhs ]; } );
+
+		uint32_t order = 0;
+		for( uint32_t i = 0; i < N; ++i )
+			order |= indices[ i ] << ( i * 4 );
+
+		packedOrder.store( order, std::memory_order_relaxed );
+		isReordering.store( false, std::memory_order_release );
+	}
+
+	mutable std::array<Stats, N>	stats;
+	mutable std::atomic<uint32_t>	packedOrder;
+	mutable std::atomic<uint32_t>	sampleCount;
+	mutable std::atomic<bool>		isReordering = false;
+};
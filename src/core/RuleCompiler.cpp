@@ -0,0 +1,210 @@
+#include "RuleCompiler.h"
+
+StringFilter RuleCompiler::CreateFilterFromString( std::string_view a_filter )
+{
+	auto filterOption = SplitString( a_filter, ":", false );
+	if( filterOption.size() == 2 )
+	{
+		StringFilter filter;
+		if( filterOption[ 0 ] == "A" )
+			filter.type = StringFilter::Type::kActorKeyword;
+		else if( filterOption[ 0 ] == "E" )
+			filter.type = StringFilter::Type::kEquipKeyword;
+		else if( filterOption[ 0 ] == "M" )
+			filter.type = StringFilter::Type::kMagicKeyword;
+		else if( filterOption[ 0 ] == "W" )
+			filter.type = StringFilter::Type::kWeaponKeyword;
+		else
+			throw std::runtime_error( "Unknown keyword type: " + std::string( filterOption[ 0 ] ) + "." );
+
+		auto keywordList = SplitString( filterOption[ 1 ], "+", false );
+		for( auto keyword : keywordList )
+		{
+			bool isNegate = false;
+			if( !keyword.empty() && keyword[ 0 ] == '-' )
+			{
+				isNegate = true;
+				keyword.remove_prefix( 1 );
+			}
+
+			filter.AddFilter( std::string( IniDocument::Trim( keyword ) ), isNegate );
+		}
+
+		return filter;
+	}
+
+	throw std::runtime_error( "Invalid keyword format. Expecting 1 of ':' but found " + std::to_string( filterOption.size() - 1 ) + ". (" + std::string( a_filter ) + ")" );
+}
+
+void RuleCompiler::ExtractFilterStrings( std::vector<StringFilterList>& a_settingList, std::string_view a_filter )
+{
+	auto keywords = SplitString( a_filter, " \t\n\v\f\r,", true );
+	StringFilterList filterList;
+	for( auto str : keywords )
+		filterList.Add( CreateFilterFromString( str ) );
+
+	a_settingList.push_back( filterList );
+}
+
+void RuleCompiler::SetLocationEffect( LocationRule& a_setting, int a_index, std::string a_effect )
+{
+	if( a_setting.effects.size() < (size_t)a_index + 1 )
+		a_setting.effects.resize( a_index + 1 );
+
+	a_setting.effects[ a_index ].effectID = a_effect;
+}
+
+void RuleCompiler::SetLocationChance( LocationRule& a_setting, int a_index, int a_chance )
+{
+	if( a_setting.effects.size() < (size_t)a_index + 1 )
+		a_setting.effects.resize( a_index + 1 );
+
+	a_setting.effects[ a_index ].effectChance = a_chance;
+}
+
+void RuleCompiler::ParseLocationEffect( LocationRule& a_setting, std::string_view a_str )
+{
+	auto effectSetting = SplitString( a_str, " \t\n\v\f\r%", true );
+	if( effectSetting.size() == 2 )
+	{
+		LocationRule::Effect effect;
+		effect.effectChance = atoi( std::string( effectSetting[ 0 ] ).c_str() );
+		effect.effectID		= effectSetting[ 1 ];
+		a_setting.effects.push_back( effect );
+
+		return;
+	}
+
+	throw std::runtime_error( "Invalid effect format" );
+}
+
+void RuleCompiler::Parse( std::string a_data, RuleData& a_rules, Options& a_options )
+{
+	IniDocument iniFile;
+	iniFile.Load( std::move( a_data ) );
+
+	if( iniFile.GetLongValue( "Version", "Major", 1 ) < 2 )
+		throw std::runtime_error( "You are using an old version of the INI file. Please download the new version or read the mod description page on how to upgrade the INI to the new version before continuing." );
+
+	auto& options = a_options;
+	options.enableLocationMultiplier	= iniFile.GetBoolValue( "Experience", "EnableLocationMultiplier", options.enableLocationMultiplier );
+	options.enableDifficultyBonus		= iniFile.GetBoolValue( "Experience", "EnableDifficultyBonus", options.enableDifficultyBonus );
+	options.shotDifficultyTimeFactor	= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyTimeFactor", options.shotDifficultyTimeFactor );
+	options.shotDifficultyDistFactor	= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyDistFactor", options.shotDifficultyDistFactor );
+	options.shotDifficultyMoveFactor	= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyMoveFactor", options.shotDifficultyMoveFactor );
+	options.shotDifficultyMax			= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyMax", options.shotDifficultyMax );
+	options.shotDifficultyReportMin		= (float)iniFile.GetDoubleValue( "Experience", "ShotDifficultyReportMin", options.shotDifficultyReportMin );
+
+	options.debugNotification			= iniFile.GetBoolValue( "Settings", "DebugNotification", options.debugNotification );
+	options.playerNotification			= iniFile.GetBoolValue( "Settings", "PlayerHitNotification", options.playerNotification );
+	options.playerHitSound				= iniFile.GetBoolValue( "Settings", "PlayerHitSound", options.playerHitSound );
+	options.notificationMode			= iniFile.GetLongValue( "Settings", "HitNotificationMode", options.notificationMode );
+	options.expNotificationMode			= iniFile.GetLongValue( "Settings", "EXPNotificationMode", options.expNotificationMode );
+	options.hitEffectNotification		= iniFile.GetBoolValue( "Settings", "HitEffectNotification", options.hitEffectNotification );
+	options.npcFloatingNotification		= iniFile.GetBoolValue( "Settings", "NPCHitNotification", options.npcFloatingNotification );
+	options.ignoreHitboxCheck			= iniFile.GetBoolValue( "Settings", "IgnoreHitboxCheck", options.ignoreHitboxCheck );
+	options.filterJIT					= iniFile.GetBoolValue( "Settings", "FilterJIT", options.filterJIT );
+	options.filterMemoMs				= iniFile.GetLongValue( "Settings", "FilterMemoMs", options.filterMemoMs );
+	options.batchedEvaluation			= iniFile.GetBoolValue( "Settings", "BatchedEvaluation", options.batchedEvaluation );
+	options.batchThreads				= iniFile.GetLongValue( "Settings", "BatchThreads", options.batchThreads );
+	a_rules.excludeRegexp.pattern		= iniFile.GetValue( "Settings", "LocationExclude", "" );
+	a_rules.playerNodes.pattern			= iniFile.GetValue( "Settings", "PlayerNodeInclude", ".*" );
+	options.hpFactor					= (float)iniFile.GetDoubleValue( "Settings", "HPFactor", 25 ) / 100.0f;
+	options.effectChanceCap				= iniFile.GetBoolValue( "Settings", "HPFactorCap", options.effectChanceCap );
+	options.amplifyEnchantment			= iniFile.GetBoolValue( "Settings", "AmplifyEnchantment", options.amplifyEnchantment );
+	options.floatingOffsetX				= (float)iniFile.GetDoubleValue( "Settings", "FloatingTextOffsetX", options.floatingOffsetX );
+	options.floatingOffsetY				= (float)iniFile.GetDoubleValue( "Settings", "FloatingTextOffsetY", options.floatingOffsetY );
+
+	// Collect "Location<number>" sections and sort them by their number
+	std::vector<std::pair<long, const IniDocument::Section*>> sectionList;
+	for( auto& section : iniFile.GetSections() )
+	{
+		constexpr auto prefix = "Location"sv;
+
+		auto& name = section.name;
+		if( name.size() > prefix.size() && name.starts_with( prefix ) &&
+			std::all_of( name.begin() + prefix.size(), name.end(), []( char c ) { return c >= '0' && c <= '9'; } ) )
+		{
+			sectionList.emplace_back( atol( std::string( name.substr( prefix.size() ) ).c_str() ), &section );
+		}
+	}
+
+	std::stable_sort( sectionList.begin(), sectionList.end(), []( auto& x, auto& y ) { return x.first < y.first; } );
+
+	a_rules.locations.reserve( sectionList.size() );
+	for( auto& [ number, section ] : sectionList )
+	{
+		auto& setting = a_rules.locations.emplace_back();
+
+		setting.id					= section->name;
+		setting.shouldContinue		= section->GetBoolValue( "Continue", false );
+		setting.damageMult			= (float)section->GetDoubleValue( "Multiplier", 1.0 );
+		setting.difficulty			= (float)section->GetDoubleValue( "Difficulty", setting.damageMult );
+		setting.successHPFactor		= (float)section->GetDoubleValue( "SuccessHPFactor", 0 ) / 100.0f;
+		setting.successChance		= section->GetLongValue( "SuccessChance", 100 );
+		setting.successHPFactorCap	= section->GetBoolValue( "SuccessHPFactorCap", true );
+		setting.floatingColorEnemy	= section->GetLongValue( "FloatingColorEnemy", 0xFF8000 );
+		setting.floatingColorSelf	= section->GetLongValue( "FloatingColorSelf", 0xFF4040 );
+		setting.floatingSize		= section->GetLongValue( "FloatingTextSize", 24 );
+		setting.deflectProjectile	= section->GetBoolValue( "Deflect", false );
+		setting.impactData			= section->GetValue( "ImpactData" );
+		setting.message				= section->GetValue( "Message" );
+		setting.messageFloating		= section->GetValue( "MessageFloating" );
+		setting.sound				= section->GetValue( "HitSound" );
+		auto regexp					= section->GetValue( "Regexp" );
+
+		// Copy condition from perk if specified
+		setting.perkConditionCopy	= section->GetValue( "UsePerkCondition" );
+
+		setting.enable		= !regexp.empty();
+		setting.regexp		= CreateRegex( regexp );
+
+		auto sex = section->GetValue( "Sex" );
+		if( !sex.empty() )
+			setting.targetFilter.sex = IniDocument::EqualsNoCase( sex, "M" ) ? Sex::kMale : Sex::kFemale;
+		else
+			setting.targetFilter.sex = Sex::kNone;
+
+		auto shooterSex = section->GetValue( "ShooterSex" );
+		if( !shooterSex.empty() )
+			setting.shooterFilter.sex = IniDocument::EqualsNoCase( shooterSex, "M" ) ? Sex::kMale : Sex::kFemale;
+		else
+			setting.shooterFilter.sex = Sex::kNone;
+
+		setting.targetFilter.editorID	= CreateRegex( section->GetValue( "EditorID" ) );
+		setting.targetFilter.ammoType	= (AmmoType)section->GetLongValue( "AmmoType", 0 );
+
+		setting.shooterFilter.editorID	= CreateRegex( section->GetValue( "ShooterEditorID" ) );
+		setting.shooterFilter.ammoType	= setting.targetFilter.ammoType; // Ammo type is the same for both filters
+
+		int effectIdx = 0;
+		int chanceIdx = 0;
+		for( auto& [ key, value ] : section->entries )
+		{
+			if( key == "Effect" )
+				ParseLocationEffect( setting, value );
+			else if( key == "EffectName" )
+				SetLocationEffect( setting, effectIdx++, std::string( value ) );
+			else if( key == "EffectChance" )
+				SetLocationChance( setting, chanceIdx++, atoi( std::string( value ).c_str() ) );
+			else if( value.empty() )
+				continue;
+			else if( key == "KeywordInclude" )
+				ExtractFilterStrings( setting.targetFilter.keywordInclude, value );
+			else if( key == "KeywordExclude" )
+				ExtractFilterStrings( setting.targetFilter.keywordExclude, value );
+			else if( key == "ShooterKeywordInclude" )
+				ExtractFilterStrings( setting.shooterFilter.keywordInclude, value );
+			else if( key == "ShooterKeywordExclude" )
+				ExtractFilterStrings( setting.shooterFilter.keywordExclude, value );
+			else if( key == "RaceInclude" )
+				setting.targetFilter.raceInclude.push_back( CreateRegex( value ) );
+			else if( key == "RaceExclude" )
+				setting.targetFilter.raceExclude.push_back( CreateRegex( value ) );
+			else if( key == "ShooterRaceInclude" )
+				setting.shooterFilter.raceInclude.push_back( CreateRegex( value ) );
+			else if( key == "ShooterRaceExclude" )
+				setting.shooterFilter.raceExclude.push_back( CreateRegex( value ) );
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Rules.h"
+#include "IniDocument.h"
+
+// Builds RuleData and the scalar options from the INI text.
+// Errors in the INI throw std::runtime_error, the plugin reports them and stops loading.
+struct RuleCompiler
+{
+	// Scalar settings, the plugin publishes them with the rule set
+	struct Options
+	{
+		bool	enableLocationMultiplier = true;
+		bool	enableDifficultyBonus = true;
+		float	shotDifficultyTimeFactor = 1;
+		float	shotDifficultyDistFactor = 1;
+		float	shotDifficultyMoveFactor = 1;
+		float	shotDifficultyMax = 15.0f;
+		float	shotDifficultyReportMin = 1.1f;
+		bool	debugNotification = true;
+		bool	playerNotification = true;
+		bool	playerHitSound = true;
+		long	notificationMode = NotificationMode::Floating;
+		long	expNotificationMode = NotificationMode::Screen;
+		bool	hitEffectNotification = true;
+		bool	npcFloatingNotification = false;
+		bool	ignoreHitboxCheck = false;
+		bool	filterJIT = false;
+		long	filterMemoMs = 1000;	// Equip and active effect events invalidate earlier
+		bool	batchedEvaluation = false;
+		long	batchThreads = 0;
+		float	hpFactor = 0.25f;
+		bool	effectChanceCap = true;
+		bool	amplifyEnchantment = true;
+		float	floatingOffsetX = 0;
+		float	floatingOffsetY = 0.04f;
+
+		// Same order as the settings cache always had
+		template <class Archive>
+		void Serialize( Archive& a_ar )
+		{
+			a_ar( enableLocationMultiplier );
+			a_ar( enableDifficultyBonus );
+			a_ar( shotDifficultyTimeFactor );
+			a_ar( shotDifficultyDistFactor );
+			a_ar( shotDifficultyMoveFactor );
+			a_ar( shotDifficultyMax );
+			a_ar( shotDifficultyReportMin );
+			a_ar( debugNotification );
+			a_ar( playerNotification );
+			a_ar( playerHitSound );
+			a_ar( notificationMode );
+			a_ar( expNotificationMode );
+			a_ar( hitEffectNotification );
+			a_ar( npcFloatingNotification );
+			a_ar( ignoreHitboxCheck );
+			a_ar( filterJIT );
+			a_ar( filterMemoMs );
+			a_ar( batchedEvaluation );
+			a_ar( batchThreads );
+			a_ar( hpFactor );
+			a_ar( effectChanceCap );
+			a_ar( amplifyEnchantment );
+			a_ar( floatingOffsetX );
+			a_ar( floatingOffsetY );
+		}
+	};
+
+	// Missing scalar keys keep the value already in a_options
+	static void Parse( std::string a_data, RuleData& a_rules, Options& a_options );
+
+	static StringFilter CreateFilterFromString( std::string_view a_filter );
+	static void ExtractFilterStrings( std::vector<StringFilterList>& a_settingList, std::string_view a_filter );
+
+	static void SetLocationEffect( LocationRule& a_setting, int a_index, std::string a_effect );
+	static void SetLocationChance( LocationRule& a_setting, int a_index, int a_chance );
+	static void ParseLocationEffect( LocationRule& a_setting, std::string_view a_str );
+};
@@ -0,0 +1,180 @@
+#include "Rules.h"
+
+void RuleData::CompilePatterns()
+{
+	// Global patterns are compiled even when empty to keep std::regex("") semantic
+	excludeRegexp.Compile();
+	playerNodes.Compile();
+
+	std::vector<RegexPattern*> patterns;
+	auto addPattern = [ &patterns ]( RegexPattern& a_pattern )
+	{
+		if( !a_pattern.empty() )
+			patterns.push_back( &a_pattern );
+	};
+
+	for( auto& location : locations )
+	{
+		addPattern( location.regexp );
+
+		for( auto filter : { &location.targetFilter, &location.shooterFilter } )
+		{
+			addPattern( filter->editorID );
+
+			for( auto& race : filter->raceInclude )
+				addPattern( race );
+
+			for( auto& race : filter->raceExclude )
+				addPattern( race );
+		}
+	}
+
+	// std::regex construction is slow, compile in parallel and report the first error afterward
+	std::atomic<size_t> nextPattern = 0;
+	std::mutex errorMutex;
+	std::string error;
+	auto worker = [ & ]()
+	{
+		for( size_t index = nextPattern++; index < patterns.size(); index = nextPattern++ )
+		{
+			try
+			{
+				patterns[ index ]->Compile();
+			}
+			catch( std::regex_error& e )
+			{
+				std::lock_guard<std::mutex> lock( errorMutex );
+				if( error.empty() )
+					error = "Regular expression error: " + patterns[ index ]->pattern + " is not vaild.\n" + e.what();
+			}
+		}
+	};
+
+	auto threadCount = std::clamp<size_t>( std::thread::hardware_concurrency(), 1, patterns.size() / 16 + 1 );
+	std::vector<std::thread> threads;
+	for( size_t i = 1; i < threadCount; ++i )
+		threads.emplace_back( worker );
+
+	worker();
+
+	for( auto& thread : threads )
+		thread.join();
+
+	if( !error.empty() )
+		throw std::runtime_error( error );
+
+	BuildHotRules();
+}
+
+void RuleData::BuildHotRules()
+{
+	hotRules = HotRules();
+	hasImpactRules = false;
+	nodeMatches = std::make_shared<NodeMatchCache>();
+	for( auto& location : locations )
+	{
+		if( location.enable && ( location.deflectProjectile || !location.impactData.empty() ) )
+			hasImpactRules = true;
+
+		uint8_t flags = 0;
+		if( location.enable )
+			flags |= HotRules::kEnable;
+		if( location.shouldContinue )
+			flags |= HotRules::kContinue;
+		if( location.deflectProjectile )
+			flags |= HotRules::kDeflect;
+		if( location.successHPFactorCap )
+			flags |= HotRules::kSuccessHPFactorCap;
+		if( !location.perkConditionCopy.empty() )
+			flags |= HotRules::kCondition;
+
+		hotRules.flags.push_back( flags );
+		hotRules.regexps.push_back( std::move( location.regexp.regex ) );
+		hotRules.successChance.push_back( location.successChance );
+		hotRules.successHPFactor.push_back( location.successHPFactor );
+		hotRules.damageMult.push_back( location.damageMult );
+		hotRules.difficulty.push_back( location.difficulty );
+	}
+}
+
+NodeMatchCache::NodeMatchCache() :
+	slots( std::make_unique<std::atomic<const Entry*>[]>( kSlotCount ) )
+{
+}
+
+NodeMatchCache::~NodeMatchCache()
+{
+	for( size_t i = 0; i < kSlotCount; ++i )
+		delete slots[ i ].load( std::memory_order_relaxed );
+}
+
+const NodeMatchCache::Entry& NodeMatchCache::Find( const RuleData& a_rules, std::string_view a_name ) const
+{
+	auto hash = std::hash<std::string_view>()( a_name );
+	for( size_t probe = 0; probe < kSlotCount; ++probe )
+	{
+		auto entry = slots[ ( hash + probe ) & ( kSlotCount - 1 ) ].load( std::memory_order_acquire );
+		if( !entry )
+			break;
+
+		if( entry->name == a_name )
+			return *entry;
+	}
+
+	// Matched outside of the table, nothing waits on the patterns of another thread
+	if( count.load( std::memory_order_relaxed ) < kMaxEntries )
+	{
+		auto entry = std::make_unique<Entry>();
+		entry->name = a_name;
+		Match( a_rules, a_name, *entry );
+
+		for( size_t probe = 0; probe < kSlotCount; ++probe )
+		{
+			const Entry* expected = nullptr;
+			auto& slot = slots[ ( hash + probe ) & ( kSlotCount - 1 ) ];
+			if( slot.compare_exchange_strong( expected, entry.get(), std::memory_order_acq_rel, std::memory_order_acquire ) )
+			{
+				count.fetch_add( 1, std::memory_order_relaxed );
+				return *entry.release();
+			}
+
+			// Another thread stored the same name first, its entry is as good as this one
+			if( expected->name == a_name )
+				return *expected;
+		}
+	}
+
+	static thread_local Entry overflow;
+	overflow.isStored = false;
+	Match( a_rules, a_name, overflow );
+	return overflow;
+}
+
+void NodeMatchCache::Match( const RuleData& a_rules, std::string_view a_name, Entry& a_entry )
+{
+	auto isMatched = [ & ]( const std::regex& a_regex )
+	{
+		return std::regex_match( a_name.begin(), a_name.end(), a_regex );
+	};
+
+	auto& hotRules = a_rules.hotRules;
+	a_entry.rules.assign( ( hotRules.size() + 63 ) / 64, 0 );
+	a_entry.isBatchable = true;
+	bool hasConditionalDamage = false;
+	for( size_t rule = 0; rule < hotRules.size(); ++rule )
+	{
+		if( !hotRules.Has( rule, HotRules::kEnable ) || !isMatched( hotRules.regexps[ rule ] ) )
+			continue;
+
+		a_entry.rules[ rule / 64 ] |= 1ull << ( rule % 64 );
+
+		if( hasConditionalDamage && hotRules.successHPFactor[ rule ] != 0 )
+			a_entry.isBatchable = false;
+
+		if( hotRules.Has( rule, HotRules::kContinue ) && hotRules.Has( rule, HotRules::kCondition ) )
+			hasConditionalDamage = true;
+	}
+
+	a_entry.isExcluded		= isMatched( a_rules.excludeRegexp.regex );
+	a_entry.isPlayerNode	= isMatched( a_rules.playerNodes.regex );
+}
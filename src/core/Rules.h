@@ -0,0 +1,350 @@
+#pragma once
+
+#include "PredicateOrder.h"
+
+// Rule data of the settings, independent of the game. The plugin evaluates the filters on live actors,
+// FilterCode lowers them to bytecode and RuleCompiler builds them from the INI.
+
+enum NotificationMode
+{
+	None,
+	Floating,
+	Screen,
+	Both
+};
+
+// Compiled regular expression that keeps its source pattern for the settings cache
+struct RegexPattern
+{
+	std::string	pattern;
+	std::regex	regex;
+
+	bool empty() const { return pattern.empty(); }
+
+	void Compile() { regex = std::regex( pattern ); }
+
+	// Only the pattern is stored, the rule set compiles all patterns after loading
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( pattern );
+	}
+};
+
+// Pattern is compiled later with RuleData::CompilePatterns
+inline RegexPattern CreateRegex( std::string_view a_str )
+{
+	RegexPattern result;
+	result.pattern = a_str;
+	return result;
+}
+
+enum class AmmoType
+{
+	Both,
+	Arrow,
+	Bolt
+};
+
+// Same values as RE::SEX
+enum class Sex : uint32_t
+{
+	kMale	= 0,
+	kFemale	= 1,
+	kNone	= 0xFFFFFFFF
+};
+
+struct StringFilter
+{
+	enum class Type
+	{
+		kNone = -1,
+		kActorKeyword,
+		kEquipKeyword,
+		kMagicKeyword,
+		kWeaponKeyword,
+
+		kTotal
+	};
+
+	struct FilterData
+	{
+		std::string	str;
+		bool		isNegate = false;
+
+		template <class Archive>
+		void Serialize( Archive& a_ar )
+		{
+			a_ar( str );
+			a_ar( isNegate );
+		}
+	};
+
+	std::vector<FilterData>	data;
+	Type					type = Type::kNone;
+
+	void AddFilter( std::string a_filter, bool isNegate = false )
+	{
+		FilterData newFilter;
+		newFilter.str = a_filter;
+		newFilter.isNegate = isNegate;
+
+		data.push_back( newFilter );
+	}
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( data );
+		a_ar( type );
+	}
+};
+
+class StringFilterList
+{
+	std::vector<StringFilter>	data;
+	uint32_t					flags = 0;	// One bit per StringFilter::Type present
+
+public:
+	const std::vector<StringFilter>& GetFilters() const { return data; }
+
+	void Add( StringFilter a_filter )
+	{
+		data.push_back( a_filter );
+		flags |= 1 << (uint32_t)a_filter.type;
+	}
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( data );
+		a_ar( flags );
+	}
+
+	bool HasFilterType( StringFilter::Type a_type ) const
+	{
+		return flags & ( 1 << (uint32_t)a_type );
+	}
+};
+
+struct ActorFilter
+{
+	AmmoType						ammoType = AmmoType::Both;
+	RegexPattern					editorID;
+	Sex								sex = Sex::kNone;
+	std::vector<StringFilterList>	keywordInclude;
+	std::vector<StringFilterList>	keywordExclude;
+	std::vector<RegexPattern>		raceInclude;
+	std::vector<RegexPattern>		raceExclude;
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( ammoType );
+		a_ar( editorID );
+		a_ar( sex );
+		a_ar( keywordInclude );
+		a_ar( keywordExclude );
+		a_ar( raceInclude );
+		a_ar( raceExclude );
+	}
+
+	// Independent tests of the filter, each one passes when it is not configured
+	enum Predicate : uint32_t
+	{
+		kKeywords,
+		kRaces,
+		kSex,
+		kEditorID,
+		kAmmo,
+
+		kPredicateCount
+	};
+
+	// Evaluated in adaptive order, the statistics are specific to this filter
+	mutable PredicateOrder<kPredicateCount>	predicateOrder;
+
+	// Code of every predicate in the rule set FilterCode, assigned when the filters are compiled
+	std::array<uint32_t, kPredicateCount>	programEntries{};
+};
+
+// One [Location<number>] section
+struct LocationRule
+{
+	struct Effect
+	{
+		std::string effectID = "";
+		int			effectChance = 0;
+
+		template <class Archive>
+		void Serialize( Archive& a_ar )
+		{
+			a_ar( effectID );
+			a_ar( effectChance );
+		}
+	};
+
+	bool							enable = false;
+	bool							shouldContinue = false;
+	float							damageMult = 1.0f;
+	float							difficulty = 1.0f;
+	bool							deflectProjectile = false;
+	int								successChance = 100;
+	float							successHPFactor = 0;
+	bool							successHPFactorCap = true;
+	unsigned int					floatingColorEnemy = 0xFFC800;
+	unsigned int					floatingColorSelf = 0xFF4040;
+	int								floatingSize = 24;
+	std::string						id;
+	std::string						message;
+	std::string						messageFloating;
+	std::string						sound;
+	std::string						impactData;
+	RegexPattern					regexp;
+	std::vector<Effect>				effects;
+	ActorFilter						targetFilter;
+	ActorFilter						shooterFilter;
+	std::string						perkConditionCopy;
+	bool							isConditionPinned = false;	// Condition rolls a random number and must keep its place in the evaluation order
+
+	// Predicates evaluated after the success chance roll
+	enum Predicate : uint32_t
+	{
+		kTargetFilter,
+		kShooterFilter,
+		kCondition,
+
+		kPredicateCount
+	};
+
+	mutable PredicateOrder<kPredicateCount>	predicateOrder;
+
+	// Condition is resolved from perkConditionCopy after data is loaded and is not serialized
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( enable );
+		a_ar( shouldContinue );
+		a_ar( damageMult );
+		a_ar( difficulty );
+		a_ar( deflectProjectile );
+		a_ar( successChance );
+		a_ar( successHPFactor );
+		a_ar( successHPFactorCap );
+		a_ar( floatingColorEnemy );
+		a_ar( floatingColorSelf );
+		a_ar( floatingSize );
+		a_ar( id );
+		a_ar( message );
+		a_ar( messageFloating );
+		a_ar( sound );
+		a_ar( impactData );
+		a_ar( regexp );
+		a_ar( effects );
+		a_ar( targetFilter );
+		a_ar( shooterFilter );
+		a_ar( perkConditionCopy );
+	}
+};
+
+// Fields read while scanning the rules for a hit, one array per field indexed by rule.
+// The scan only touches these arrays, the LocationRule of a rule is read once it matched.
+struct HotRules
+{
+	enum Flag : uint8_t
+	{
+		kEnable				= 1 << 0,
+		kContinue			= 1 << 1,
+		kDeflect			= 1 << 2,
+		kSuccessHPFactorCap	= 1 << 3,
+		kCondition			= 1 << 4,	// Perk condition, a batched hit only knows it when it is applied
+	};
+
+	std::vector<uint8_t>	flags;
+	std::vector<std::regex>	regexps;
+	std::vector<int>		successChance;
+	std::vector<float>		successHPFactor;
+	std::vector<float>		damageMult;
+	std::vector<float>		difficulty;
+
+	size_t size() const { return flags.size(); }
+
+	bool Has( size_t a_rule, Flag a_flag ) const { return flags[ a_rule ] & a_flag; }
+
+	// Rule is enabled and its pattern matches the hit node name
+	bool IsMatched( size_t a_rule, const char* a_nodeName ) const
+	{
+		return Has( a_rule, kEnable ) && std::regex_match( a_nodeName, regexps[ a_rule ] );
+	}
+};
+
+struct RuleData;
+
+// Node pattern results of a rule set per node name. The few hundred node names of the skeletons come back hit after hit
+// and std::regex_match allocates on every call: each name is matched once against every pattern, then looked up.
+// Insert-only open addressing table without lock: a lookup is a few atomic loads, a new name is matched by the thread
+// that first sees it and published with a compare exchange. Two threads missing the same name both match it, one wins.
+class NodeMatchCache
+{
+public:
+	struct Entry
+	{
+		std::string				name;
+		std::vector<uint64_t>	rules;					// One bit per rule, set when the rule is enabled and its pattern matches
+		bool					isExcluded = false;		// RuleData::excludeRegexp matches
+		bool					isPlayerNode = false;	// RuleData::playerNodes matches
+		bool					isStored = true;		// False past kMaxEntries: valid on its thread until the next overflow
+		bool					isBatchable = true;		// False when a continuing rule with a perk condition scales the damage
+														// seen by the success chance of a later rule, the batch scan cannot know it
+
+		bool IsRuleMatched( size_t a_rule ) const { return ( rules[ a_rule / 64 ] >> ( a_rule % 64 ) ) & 1; }
+	};
+
+	// Names past the limit are matched on every call instead of growing the cache without bound
+	static constexpr size_t kMaxEntries	= 4096;
+	static constexpr size_t kSlotCount	= kMaxEntries * 2;	// Power of two, half empty keeps the probes short
+
+	NodeMatchCache();
+	~NodeMatchCache();
+
+	NodeMatchCache( const NodeMatchCache& ) = delete;
+	NodeMatchCache& operator=( const NodeMatchCache& ) = delete;
+
+	// Thread safe, a stored entry stays valid as long as the cache
+	const Entry& Find( const RuleData& a_rules, std::string_view a_name ) const;
+
+private:
+	static void Match( const RuleData& a_rules, std::string_view a_name, Entry& a_entry );
+
+	std::unique_ptr<std::atomic<const Entry*>[]>	slots;
+	mutable std::atomic<size_t>						count = 0;
+};
+
+// Rules of the INI, the part of a rule set that does not depend on loaded forms
+struct RuleData
+{
+	std::vector<LocationRule>	locations;
+	HotRules					hotRules;
+	RegexPattern				excludeRegexp;
+	RegexPattern				playerNodes;
+	bool						hasImpactRules = false;	// A rule deflects the projectile or replaces its impact, set by BuildHotRules
+	std::shared_ptr<NodeMatchCache>	nodeMatches;			// Created by BuildHotRules, shared by copies as they have the same patterns
+
+	template <class Archive>
+	void Serialize( Archive& a_ar )
+	{
+		a_ar( locations );
+		a_ar( excludeRegexp.pattern );
+		a_ar( playerNodes.pattern );
+	}
+
+	// Compile every pattern of the rule set, spread across all cores, and build the hot rule table.
+	// Throws std::runtime_error for an invalid pattern.
+	void CompilePatterns();
+
+	// Compiled location patterns are moved into the table, LocationRule::regexp keeps only its source
+	void BuildHotRules();
+
+	// Rules, exclude and player node patterns matched against a node name, through the cache
+	const NodeMatchCache::Entry& MatchNode( std::string_view a_name ) const { return nodeMatches->Find( *this, a_name ); }
+};
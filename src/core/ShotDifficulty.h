@@ -0,0 +1,58 @@
+#pragma once
+
+// Inputs of the shot difficulty formula, gathered once per hit.
+struct ShotDifficultyParams
+{
+	float	flightTime = 0;			// Seconds since the tracked launch, else Projectile::lifeRemaining (actually the elapsed lifetime)
+	float	distanceMoved = 0;
+	float	projectileSpeed = 0;
+	float	targetSpeed = 0;
+	float	crossFactor = 0;		// |targetDirection x attackDirection|
+	bool	hasBound = false;		// Target has a character controller
+	float	boundHeight = 0;		// collisionBound.extents.z
+	float	boundWidth = 0;			// collisionBound.extents.y
+	bool	isFlying = false;
+};
+
+namespace ShotDifficulty
+{
+	// Experience multiplier of a hit, 1 for an easy shot
+	inline float Compute( const ShotDifficultyParams& a_params, float a_flightTimeFactor, float a_distanceFactor, float a_moveFactor )
+	{
+		// First 0.1 second of flight time do not count as time bonus
+		float timeBonus = std::max<float>( a_params.flightTime - 0.1f, 0 );
+		float timeDifficulty = ( powf( 1 + timeBonus, 2 ) - 1 ) / 2;
+		timeDifficulty *= a_flightTimeFactor;
+
+		// Bonus for a short target like a rabbit or a penalty on tall target. (65 is normal sized NPC)
+		float sizeFactor = a_params.hasBound ? 65.0f / a_params.boundHeight : 1;
+
+		// First 0.1 second of travelled distance does not count
+		float distBonus = std::max<float>( a_params.distanceMoved - a_params.projectileSpeed * 0.1f, 0 );
+		float distDifficulty = ( powf( 1 + distBonus / 6000.0f, 2 ) - 1 ) / 2;
+		distDifficulty *= a_distanceFactor;
+
+		// A target moving toward or away from the player is not that hard to shoot
+		// But it becomes a lot harder when they're moving perpendicular to the player, especially when they're really far away
+		float movementDifficulty = 0;
+		if( a_params.targetSpeed != 0 )
+		{
+			// extents.y is the width of the side of an actor when it's moving forward
+			float movementFactor = 0;
+			if( a_params.hasBound && a_params.boundWidth != 0 )
+				movementFactor = a_params.targetSpeed / a_params.boundWidth / 2.5f * a_params.crossFactor;
+
+			movementDifficulty = powf( 2.0f, 1 + a_params.flightTime * 2 ) - 2;
+			movementDifficulty *= movementFactor * a_params.crossFactor * a_moveFactor;
+		}
+
+		float shotDifficulty = timeDifficulty + ( distDifficulty + movementDifficulty ) * sizeFactor;
+
+		// Multiply difficulty by 2 if the target is flying (A flying dragon is very hard to hit)
+		if( a_params.isFlying )
+			shotDifficulty *= 2;
+
+		// Convert to multiplier
+		return shotDifficulty + 1;
+	}
+}
@@ -0,0 +1,267 @@
+#include "SnapshotFilter.h"
+
+bool SnapshotFilter::FormHasKeywords( const std::vector<std::string>& a_form, const StringFilter& a_filter )
+{
+	for( auto& keyword : a_filter.data )
+	{
+		bool hasKeyword = ActorSnapshot::HasKeyword( a_form, keyword.str );
+		if( keyword.isNegate )
+			hasKeyword = !hasKeyword;
+
+		if( !hasKeyword )
+			return false;
+	}
+
+	return true;
+}
+
+// Same structure as EngineFilter::ActorHasKeywords and the armor, active effect and weapon lookups
+bool SnapshotFilter::Evaluate( const StringFilterList& a_list, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source )
+{
+	// Keywords of a missing actor are never found
+	if( !a_actor &&
+		( a_list.HasFilterType( StringFilter::Type::kActorKeyword ) ||
+		  a_list.HasFilterType( StringFilter::Type::kEquipKeyword ) ||
+		  a_list.HasFilterType( StringFilter::Type::kMagicKeyword ) ) )
+		return false;
+
+	auto matchAll = [ &a_list ]( StringFilter::Type a_type, auto&& a_forEachForm )
+	{
+		if( !a_list.HasFilterType( a_type ) )
+			return true;
+
+		std::vector<const StringFilter*> lookupFilter;
+		for( auto& filter : a_list.GetFilters() )
+		{
+			if( filter.type == a_type )
+				lookupFilter.push_back( &filter );
+		}
+
+		a_forEachForm( [ &lookupFilter ]( const std::vector<std::string>& a_form )
+		{
+			std::erase_if( lookupFilter, [ &a_form ]( const StringFilter* a_filter ) { return FormHasKeywords( a_form, *a_filter ); } );
+			return lookupFilter.empty();
+		});
+
+		return lookupFilter.empty();
+	};
+
+	bool isActorHasKeyword = true;
+	if( a_list.HasFilterType( StringFilter::Type::kActorKeyword ) )
+	{
+		for( auto& keywordList : a_list.GetFilters() )
+		{
+			for( auto& keyword : keywordList.data )
+			{
+				bool hasKeyword = a_actor->HasKeyword( keyword.str );
+				if( keyword.isNegate )
+					hasKeyword = !hasKeyword;
+
+				if( !hasKeyword && keywordList.type == StringFilter::Type::kActorKeyword )
+					isActorHasKeyword = false;
+			}
+		}
+	}
+
+	bool isArmorHasKeyword = matchAll( StringFilter::Type::kEquipKeyword, [ a_actor ]( auto&& a_visit )
+	{
+		for( auto& armor : a_actor->wornArmors )
+		{
+			if( a_visit( armor ) )
+				break;
+		}
+	});
+
+	bool isMagicHasKeyword = matchAll( StringFilter::Type::kMagicKeyword, [ a_actor ]( auto&& a_visit )
+	{
+		for( auto& effect : a_actor->activeEffects )
+		{
+			if( !effect.isInactive && a_visit( effect.keywords ) )
+				break;
+		}
+	});
+
+	bool isWeaponHasKeyword = false;
+	if( a_source )
+	{
+		isWeaponHasKeyword = !a_list.HasFilterType( StringFilter::Type::kWeaponKeyword ) ||
+			( a_source->hasSource && std::all_of( a_list.GetFilters().begin(), a_list.GetFilters().end(), [ a_source ]( const StringFilter& a_filter )
+			{
+				return a_filter.type != StringFilter::Type::kWeaponKeyword ||
+					FormHasKeywords( a_source->weaponKeywords, a_filter ) || FormHasKeywords( a_source->ammoKeywords, a_filter );
+			}) );
+	}
+
+	return isActorHasKeyword && isArmorHasKeyword && isMagicHasKeyword && isWeaponHasKeyword;
+}
+
+bool SnapshotFilter::IsVaild( const ActorFilter& a_filter, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source )
+{
+	return a_filter.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+	{
+		return Test( a_filter, (ActorFilter::Predicate)a_predicate, a_actor, a_source );
+	});
+}
+
+bool SnapshotFilter::Test( const ActorFilter& a_filter, ActorFilter::Predicate a_predicate, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source )
+{
+	switch( a_predicate )
+	{
+	case ActorFilter::kKeywords:
+		{
+			bool isVaild = a_filter.keywordInclude.size() == 0;
+
+			for( auto& filter : a_filter.keywordInclude )
+			{
+				if( Evaluate( filter, a_actor, a_source ) )
+				{
+					isVaild = true;
+					break;
+				}
+			}
+
+			if( isVaild )
+			{
+				for( auto& filter : a_filter.keywordExclude )
+				{
+					if( Evaluate( filter, a_actor, a_source ) )
+						return false;
+				}
+			}
+
+			return isVaild;
+		}
+
+	case ActorFilter::kRaces:
+		{
+			if( a_filter.raceInclude.size() == 0 && a_filter.raceExclude.size() == 0 )
+				return true;
+
+			if( !a_actor )
+				return false;
+
+			if( a_filter.raceInclude.size() > 0 )
+			{
+				bool isIncluded = false;
+				for( auto& filter : a_filter.raceInclude )
+				{
+					isIncluded = std::regex_match( a_actor->raceEditorID, filter.regex );
+					if( isIncluded )
+						break;
+				}
+
+				if( !isIncluded )
+					return false;
+			}
+
+			for( auto& filter : a_filter.raceExclude )
+			{
+				if( std::regex_match( a_actor->raceEditorID, filter.regex ) )
+					return false;
+			}
+
+			return true;
+		}
+
+	case ActorFilter::kSex:
+		if( a_filter.sex == Sex::kNone )
+			return true;
+
+		if( !a_actor )
+			return false;
+
+		// An actor without base has no sex to test, as FilterFacts
+		return !a_actor->hasBase || a_actor->sex == Sex::kNone || a_actor->sex == a_filter.sex;
+
+	case ActorFilter::kEditorID:
+		{
+			if( a_filter.editorID.empty() )
+				return true;
+
+			if( !a_actor )
+				return false;
+
+			if( !a_actor->hasBase )
+				return true;
+
+			// Forms without editor ID test against an empty string
+			return std::regex_match( a_actor->baseEditorID, a_filter.editorID.regex );
+		}
+
+	case ActorFilter::kAmmo:
+		if( a_filter.ammoType == AmmoType::Both || !a_source || !a_source->hasSource )
+			return true;
+
+		return a_source->ammo == a_filter.ammoType;
+
+	default:
+		return true;
+	}
+}
+
+SnapshotFacts::SnapshotFacts( const FilterCode& a_code, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source ) :
+	code( a_code ), actor( a_actor ), source( a_source )
+{
+	fields.actor = a_actor;
+
+	if( a_actor )
+	{
+		fields.raceIndex = code.GetRaceIndex( a_actor->raceID );
+
+		if( a_actor->hasBase )
+		{
+			fields.sex		= a_actor->sex == Sex::kNone ? FilterFields::kNoSex : (uint8_t)a_actor->sex;
+			fields.baseID	= a_actor->baseID;
+			fields.hasBase	= true;
+		}
+	}
+
+	if( a_source && a_source->hasSource )
+		fields.ammo = (uint8_t)a_source->ammo;
+}
+
+bool SnapshotFacts::TestClause( uint32_t a_clause )
+{
+	if( a_clause >= kCachedClauses )
+		return EvaluateClause( code.clauses[ a_clause ] );
+
+	auto word	= a_clause / 64;
+	auto bit	= 1ull << ( a_clause % 64 );
+	if( !( clauseKnown[ word ] & bit ) )
+	{
+		clauseKnown[ word ] |= bit;
+		if( EvaluateClause( code.clauses[ a_clause ] ) )
+			clauseValue[ word ] |= bit;
+	}
+
+	return clauseValue[ word ] & bit;
+}
+
+bool SnapshotFacts::EvaluateClause( const StringFilter& a_clause ) const
+{
+	if( a_clause.type == StringFilter::Type::kWeaponKeyword )
+	{
+		if( !source || !source->hasSource )
+			return false;
+
+		return SnapshotFilter::FormHasKeywords( source->weaponKeywords, a_clause ) || SnapshotFilter::FormHasKeywords( source->ammoKeywords, a_clause );
+	}
+
+	if( !actor )
+		return false;
+
+	switch( a_clause.type )
+	{
+	case StringFilter::Type::kActorKeyword:
+		return SnapshotFilter::FormHasKeywords( actor->keywords, a_clause );
+
+	case StringFilter::Type::kEquipKeyword:
+		return std::any_of( actor->wornArmors.begin(), actor->wornArmors.end(), [ &a_clause ]( auto& a_armor ) { return SnapshotFilter::FormHasKeywords( a_armor, a_clause ); } );
+
+	case StringFilter::Type::kMagicKeyword:
+		return std::any_of( actor->activeEffects.begin(), actor->activeEffects.end(), [ &a_clause ]( auto& a_effect ) { return !a_effect.isInactive && SnapshotFilter::FormHasKeywords( a_effect.keywords, a_clause ); } );
+
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "HitRecord.h"
+#include "FilterCode.h"
+
+// Rule filters over snapshots, the engine independent twin of EngineFilter.
+// Reference semantic: std::regex on editor IDs and keyword string lookups, in the structure of EngineFilter::IsVaild.
+struct SnapshotFilter
+{
+	// A null source fails every keyword list, as the plugin does for a hit without projectile
+	static bool IsVaild( const ActorFilter& a_filter, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source );
+	static bool Test( const ActorFilter& a_filter, ActorFilter::Predicate a_predicate, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source );
+	static bool Evaluate( const StringFilterList& a_list, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source );
+
+	// Every keyword of the clause must be on the same form
+	static bool FormHasKeywords( const std::vector<std::string>& a_form, const StringFilter& a_filter );
+};
+
+// Facts of one snapshot for FilterCode, same clause caching as the plugin FilterFacts
+class SnapshotFacts
+{
+public:
+	SnapshotFacts( const FilterCode& a_code, const ActorSnapshot* a_actor, const ProjectileSnapshot* a_source );
+
+	bool TestClause( uint32_t a_clause );
+
+	bool Evaluate( const ActorFilter& a_filter )
+	{
+		return a_filter.predicateOrder.Evaluate( [ & ]( uint32_t a_predicate )
+		{
+			return code.Interpret( a_filter.programEntries[ a_predicate ], *this );
+		});
+	}
+
+	FilterFields	fields;
+
+private:
+	static constexpr uint32_t kCachedClauses = 256;	// Clauses past this index are evaluated every time
+
+	bool EvaluateClause( const StringFilter& a_clause ) const;
+
+	const FilterCode&							code;
+	const ActorSnapshot*						actor;
+	const ProjectileSnapshot*					source;
+	std::array<uint64_t, kCachedClauses / 64>	clauseKnown{};
+	std::array<uint64_t, kCachedClauses / 64>	clauseValue{};
+};
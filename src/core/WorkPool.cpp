@@ -0,0 +1,126 @@
+#include "WorkPool.h"
+
+WorkPool::WorkPool( uint32_t a_threadCount )
+{
+	if( a_threadCount == 0 )
+		a_threadCount = std::max<uint32_t>( std::thread::hardware_concurrency(), 1 );
+
+	for( uint32_t i = 0; i < a_threadCount; ++i )
+		queues.push_back( std::make_unique<Queue>() );
+
+	for( uint32_t i = 1; i < a_threadCount; ++i )
+		workers.emplace_back( &WorkPool::WorkerLoop, this, i );
+}
+
+WorkPool::~WorkPool()
+{
+	{
+		std::lock_guard<std::mutex> lock( stateMutex );
+		isStopping = true;
+	}
+
+	wakeCondition.notify_all();
+	for( auto& worker : workers )
+		worker.join();
+}
+
+void WorkPool::Run( size_t a_count, size_t a_grain, std::function<void( size_t, uint32_t )> a_task )
+{
+	a_grain = std::max<size_t>( a_grain, 1 );
+	if( workers.empty() || a_count <= a_grain )
+	{
+		for( size_t i = 0; i < a_count; ++i )
+			a_task( i, 0 );
+
+		return;
+	}
+
+	task = std::move( a_task );
+
+	// Contiguous blocks of chunks per thread, stealing evens out the blocks that turn out slower
+	size_t chunkCount	= ( a_count + a_grain - 1 ) / a_grain;
+	auto threadCount	= queues.size();
+	remaining			= chunkCount;
+	for( size_t thread = 0; thread < threadCount; ++thread )
+	{
+		auto& queue = *queues[ thread ];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		for( size_t chunk = chunkCount * thread / threadCount; chunk < chunkCount * ( thread + 1 ) / threadCount; ++chunk )
+			queue.chunks.push_back( { chunk * a_grain, std::min<size_t>( ( chunk + 1 ) * a_grain, a_count ) } );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( stateMutex );
+		++generation;
+	}
+
+	wakeCondition.notify_all();
+	RunChunks( 0 );
+
+	// Stolen chunks may still be running
+	std::unique_lock<std::mutex> lock( stateMutex );
+	doneCondition.wait( lock, [ this ]() { return remaining.load( std::memory_order_acquire ) == 0; } );
+}
+
+void WorkPool::WorkerLoop( uint32_t a_thread )
+{
+	uint64_t seenGeneration = 0;
+	while( true )
+	{
+		{
+			std::unique_lock<std::mutex> lock( stateMutex );
+			wakeCondition.wait( lock, [ & ]() { return isStopping || generation != seenGeneration; } );
+			if( isStopping )
+				return;
+
+			seenGeneration = generation;
+		}
+
+		RunChunks( a_thread );
+	}
+}
+
+void WorkPool::RunChunks( uint32_t a_thread )
+{
+	Chunk chunk;
+	while( Pop( a_thread, chunk ) || Steal( a_thread, chunk ) )
+	{
+		for( size_t i = chunk.begin; i < chunk.end; ++i )
+			task( i, a_thread );
+
+		if( remaining.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		{
+			std::lock_guard<std::mutex> lock( stateMutex );
+			doneCondition.notify_one();
+		}
+	}
+}
+
+bool WorkPool::Pop( uint32_t a_thread, Chunk& a_chunk )
+{
+	auto& queue = *queues[ a_thread ];
+	std::lock_guard<std::mutex> lock( queue.mutex );
+	if( queue.chunks.empty() )
+		return false;
+
+	a_chunk = queue.chunks.back();
+	queue.chunks.pop_back();
+	return true;
+}
+
+bool WorkPool::Steal( uint32_t a_thread, Chunk& a_chunk )
+{
+	for( size_t i = 1; i < queues.size(); ++i )
+	{
+		auto& queue = *queues[ ( a_thread + i ) % queues.size() ];
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		if( !queue.chunks.empty() )
+		{
+			a_chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+			return true;
+		}
+	}
+
+	return false;
+}
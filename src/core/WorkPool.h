@@ -0,0 +1,58 @@
+#pragma once
+
+// Worker threads that run the indices of a range in parallel, the calling thread included.
+// The range is cut in chunks dealt out to one queue per thread. A thread takes chunks from the back of its own queue
+// and steals from the front of the others once it runs dry, so a few expensive indices do not hold the range back.
+class WorkPool
+{
+public:
+	// a_threadCount counts the calling thread, 0 uses every hardware thread
+	explicit WorkPool( uint32_t a_threadCount = 0 );
+	~WorkPool();
+
+	WorkPool( const WorkPool& ) = delete;
+	WorkPool& operator=( const WorkPool& ) = delete;
+
+	uint32_t GetThreadCount() const { return (uint32_t)queues.size(); }
+
+	// Run a_task( index, thread ) for every index below a_count and return once all are done.
+	// thread is 0 for the caller and below GetThreadCount(), for per thread scratch data.
+	// One range at a time: the pool is driven by a single thread.
+	template <class Task>
+	void ParallelFor( size_t a_count, Task&& a_task, size_t a_grain = 1 )
+	{
+		Run( a_count, a_grain, [ &a_task ]( size_t a_index, uint32_t a_thread ) { a_task( a_index, a_thread ); } );
+	}
+
+private:
+	struct Chunk
+	{
+		size_t	begin = 0;
+		size_t	end = 0;
+	};
+
+	struct alignas( 64 ) Queue
+	{
+		std::mutex			mutex;
+		std::deque<Chunk>	chunks;
+	};
+
+	void Run( size_t a_count, size_t a_grain, std::function<void( size_t, uint32_t )> a_task );
+	void WorkerLoop( uint32_t a_thread );
+
+	// Run chunks until no queue has any left
+	void RunChunks( uint32_t a_thread );
+	bool Pop( uint32_t a_thread, Chunk& a_chunk );
+	bool Steal( uint32_t a_thread, Chunk& a_chunk );
+
+	std::vector<std::unique_ptr<Queue>>		queues;
+	std::vector<std::thread>				workers;
+	std::function<void( size_t, uint32_t )>	task;
+	std::atomic<size_t>						remaining = 0;	// Chunks of the current range not finished yet
+
+	std::mutex								stateMutex;
+	std::condition_variable					wakeCondition;
+	std::condition_variable					doneCondition;
+	uint64_t								generation = 0;
+	bool									isStopping = false;
+};
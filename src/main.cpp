@@ -1,4 +1,6 @@
 #include "LocationalDamage.h"
+#include "FilterMemoEvents.h"
+#include "PlayerSkeleton.h"
 
 namespace
 {
@@ -79,6 +81,8 @@ static void SKSEMessageHandler(SKSE::MessagingInterface::Message* message)
 	{
 		LocationalDamage::InitFormEditorIDMap();
 		LocationalDamage::InitPerkConditions();
+		FilterMemoEvents::Register();
+		PlayerSkeleton::RegisterEvents();
 	}
 }
 
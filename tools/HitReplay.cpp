@@ -0,0 +1,226 @@
+#include "core/HitTrace.h"
+#include "core/HitEvaluator.h"
+
+#include <cstdio>
+#include <map>
+
+// Offline replay of a hit trace captured in game with 'ald capture start'.
+//
+//   ArcheryLocationalDamageReplay <trace> [--ini <file>] [--decisions <out>] [--repeat <n>] [--reference]
+//     Evaluates every hit with the INI stored in the trace, or with --ini to try other rules on the same hits.
+//     Prints the throughput of the decision logic and writes one line per hit to --decisions.
+//     --reference evaluates the filters with SnapshotFilter instead of the compiled FilterCode.
+//
+//   ArcheryLocationalDamageReplay --diff <decisions a> <decisions b>
+//     Lists the hits decided differently, exits with 1 when there is any.
+//
+// Rolls use a generator seeded with the hit index, two replays of the same trace and INI make the same decisions.
+
+static int PrintUsage()
+{
+	std::printf( "usage: ArcheryLocationalDamageReplay <trace> [--ini <file>] [--decisions <out>] [--repeat <n>] [--reference]\n" );
+	std::printf( "       ArcheryLocationalDamageReplay --diff <decisions a> <decisions b>\n" );
+	return 2;
+}
+
+static bool ReadFile( const std::filesystem::path& a_path, std::string& a_text )
+{
+	std::ifstream stream( a_path, std::ios::binary );
+	if( !stream )
+		return false;
+
+	a_text.assign( std::istreambuf_iterator<char>( stream ), std::istreambuf_iterator<char>() );
+	return true;
+}
+
+static std::string FormatDecision( size_t a_index, const HitRecord& a_record, const HitDecision& a_decision )
+{
+	char number[ 32 ];
+	std::string line = std::to_string( a_index ) + " node=";
+	line += a_decision.node >= 0 ? a_record.skeleton.nodes[ a_decision.node ].name : "-";
+
+	line += " rules=";
+	for( size_t i = 0; i < a_decision.rules.size(); ++i )
+	{
+		line += i ? "," : "";
+		line += std::to_string( a_decision.rules[ i ] );
+	}
+
+	line += " effects=";
+	for( size_t i = 0; i < a_decision.effects.size(); ++i )
+	{
+		line += i ? "," : "";
+		line += std::to_string( a_decision.effects[ i ].first ) + ":" + std::to_string( a_decision.effects[ i ].second );
+	}
+
+	std::snprintf( number, sizeof( number ), " damage=%.3f", a_decision.damage );
+	line += number;
+	std::snprintf( number, sizeof( number ), " exp=%.3f", a_decision.expMult );
+	line += number;
+
+	return line;
+}
+
+static int Diff( const char* a_left, const char* a_right )
+{
+	std::ifstream left( a_left ), right( a_right );
+	if( !left || !right )
+	{
+		std::printf( "Cannot open %s\n", !left ? a_left : a_right );
+		return 2;
+	}
+
+	std::string leftLine, rightLine;
+	uint32_t lineCount = 0, diffCount = 0;
+	while( true )
+	{
+		bool hasLeft	= (bool)std::getline( left, leftLine );
+		bool hasRight	= (bool)std::getline( right, rightLine );
+		if( !hasLeft && !hasRight )
+			break;
+
+		++lineCount;
+		if( hasLeft != hasRight || leftLine != rightLine )
+		{
+			++diffCount;
+			std::printf( "- %s\n+ %s\n", hasLeft ? leftLine.c_str() : "<missing>", hasRight ? rightLine.c_str() : "<missing>" );
+		}
+	}
+
+	std::printf( "%u of %u hits differ\n", diffCount, lineCount );
+	return diffCount ? 1 : 0;
+}
+
+int main( int a_argc, char** a_argv )
+{
+	if( a_argc == 4 && std::string_view( a_argv[ 1 ] ) == "--diff" )
+		return Diff( a_argv[ 2 ], a_argv[ 3 ] );
+
+	if( a_argc < 2 )
+		return PrintUsage();
+
+	const char* tracePath		= a_argv[ 1 ];
+	const char* iniPath			= nullptr;
+	const char* decisionsPath	= nullptr;
+	uint32_t repeat				= 1;
+	bool isReference			= false;
+	for( int i = 2; i < a_argc; ++i )
+	{
+		std::string_view arg = a_argv[ i ];
+		if( arg == "--ini" && i + 1 < a_argc )
+			iniPath = a_argv[ ++i ];
+		else if( arg == "--decisions" && i + 1 < a_argc )
+			decisionsPath = a_argv[ ++i ];
+		else if( arg == "--repeat" && i + 1 < a_argc )
+			repeat = std::max<uint32_t>( 1, (uint32_t)std::strtoul( a_argv[ ++i ], nullptr, 10 ) );
+		else if( arg == "--reference" )
+			isReference = true;
+		else
+			return PrintUsage();
+	}
+
+	HitTraceReader reader;
+	if( !reader.Open( tracePath ) )
+	{
+		std::printf( "Cannot open trace %s\n", tracePath );
+		return 2;
+	}
+
+	std::vector<HitRecord> records;
+	for( HitRecord record; reader.Read( record ); )
+		records.push_back( std::move( record ) );
+
+	std::string iniText = reader.GetIni();
+	if( iniPath && !ReadFile( iniPath, iniText ) )
+	{
+		std::printf( "Cannot read INI %s\n", iniPath );
+		return 2;
+	}
+
+	RuleData rules;
+	RuleCompiler::Options options;
+	try
+	{
+		RuleCompiler::Parse( std::move( iniText ), rules, options );
+		rules.CompilePatterns();
+	}
+	catch( std::exception& e )
+	{
+		std::printf( "Invalid INI: %s\n", e.what() );
+		return 2;
+	}
+
+	// Forms of the load order are unknown offline, the races and NPCs of the trace are the only ones the filters can meet
+	std::map<uint32_t, std::string> races, npcs;
+	for( auto& record : records )
+	{
+		for( auto actor : { &record.target, &record.shooter } )
+		{
+			if( actor->raceID )
+				races.emplace( actor->raceID, actor->raceEditorID );
+			if( actor->hasBase && !actor->baseEditorID.empty() )
+				npcs.emplace( actor->baseID, actor->baseEditorID );
+		}
+	}
+
+	FilterCode::Forms forms;
+	forms.races.assign( races.begin(), races.end() );
+	forms.npcs.assign( npcs.begin(), npcs.end() );
+
+	FilterCode code;
+	code.Compile( rules.locations, forms );
+
+	HitEvaluator evaluator( rules, options, isReference ? nullptr : &code );
+
+	using clock = std::chrono::steady_clock;
+	std::vector<HitDecision> decisions( records.size() );
+	std::vector<float> nanoseconds;
+	nanoseconds.reserve( records.size() * repeat );
+
+	auto start = clock::now();
+	for( uint32_t pass = 0; pass < repeat; ++pass )
+	{
+		for( size_t i = 0; i < records.size(); ++i )
+		{
+			std::minstd_rand random( (uint32_t)i + 1 );
+
+			auto hitStart = clock::now();
+			decisions[ i ] = evaluator.Evaluate( records[ i ], random );
+			nanoseconds.push_back( std::chrono::duration<float, std::nano>( clock::now() - hitStart ).count() );
+		}
+	}
+	std::chrono::duration<double> elapsed = clock::now() - start;
+
+	std::printf( "%zu hits, %zu rules, %s filters\n", records.size(), rules.locations.size(), isReference ? "reference" : "compiled" );
+	if( !nanoseconds.empty() )
+	{
+		double total = 0;
+		for( auto value : nanoseconds )
+			total += value;
+
+		auto percentile = [ &nanoseconds ]( double a_rank )
+		{
+			auto nth = nanoseconds.begin() + (size_t)( a_rank * ( nanoseconds.size() - 1 ) );
+			std::nth_element( nanoseconds.begin(), nth, nanoseconds.end() );
+			return *nth;
+		};
+
+		std::printf( "%.0f hits/s, mean %.0f ns, p50 %.0f ns, p99 %.0f ns\n",
+			nanoseconds.size() / elapsed.count(), total / nanoseconds.size(), percentile( 0.5 ), percentile( 0.99 ) );
+	}
+
+	if( decisionsPath )
+	{
+		std::ofstream output( decisionsPath, std::ios::trunc );
+		for( size_t i = 0; i < records.size(); ++i )
+			output << FormatDecision( i, records[ i ], decisions[ i ] ) << '\n';
+
+		if( !output )
+		{
+			std::printf( "Cannot write %s\n", decisionsPath );
+			return 2;
+		}
+	}
+
+	return 0;
+}
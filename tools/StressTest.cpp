@@ -0,0 +1,566 @@
+#include "Fixtures.h"
+#include "core/HitEvaluator.h"
+#include "core/HitOverride.h"
+#include "core/WorkPool.h"
+#include "core/BinaryArchive.h"
+#include "core/AllocationCounter.h"
+
+#include <barrier>
+#include <cstdio>
+
+// Mass combat load generator for the portable hit pipeline.
+//
+//   ArcheryLocationalDamageStress [--actors <n>] [--projectiles <m>] [--frames <f>] [--rules <r>] [--threads <t>]
+//                                 [--budget-ms <ms>] [--seed <s>] [--batched] [--inline-effects] [--sweep] [--csv <file>]
+//                                 [--zero-alloc]
+//
+// Every frame, each of the n actors fires m arrows at another actor with a random skeleton. An impact runs the rule
+// decision and records its damage override and side effects like ApplyLocationalDamage does, then the attacks take the
+// overrides back and the side effect queue is drained, as HandleProjectileAttackHook and the SKSE task queue do.
+// Impacts are spread over t threads to model projectiles impacting outside the main thread. With --batched the impacts of
+// a frame are queued instead, decided on a t thread WorkPool and applied in impact order, as BatchedEvaluation does.
+// Side effect text is formatted when the queue is drained, --inline-effects formats it in the impact instead, as the
+// impact hook did before side effects were queued. The engine calls that follow it in game are not modeled.
+//
+// Reported per configuration: frame time against the budget, CPU time of the rule decisions, contention on the
+// override and task locks, the deepest override list and task queue seen, and the latency of an impact from the
+// decision to its return (inline impacts only, the first frame excluded). --sweep runs a grid of actors and
+// projectiles, --csv appends one line per configuration to track the scaling curve from release to release.
+// The order hash covers the side effect queue in drain order: batched runs print the same hash for any thread count.
+// Debug builds also count the global heap allocations of the decisions after the first frame, --zero-alloc exits with 1
+// when there is any.
+
+using Clock = std::chrono::steady_clock;
+
+// Mutex that counts the lockers that had to wait and for how long. Counters are written while the lock is held.
+class MeasuredMutex
+{
+public:
+	void lock()
+	{
+		if( !mutex.try_lock() )
+		{
+			auto start = Clock::now();
+			mutex.lock();
+			waitNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>( Clock::now() - start ).count();
+			++contended;
+		}
+
+		++acquired;
+	}
+
+	void unlock() { mutex.unlock(); }
+
+	uint64_t	acquired = 0;
+	uint64_t	contended = 0;
+	uint64_t	waitNanoseconds = 0;
+
+private:
+	std::mutex	mutex;
+};
+
+struct StressOptions
+{
+	uint32_t	actors = 50;
+	uint32_t	projectiles = 2;	// Per actor and frame
+	uint32_t	frames = 300;
+	uint32_t	rules = 100;
+	uint32_t	threads = 1;
+	bool		isBatched = false;
+	bool		isInlineEffects = false;
+	float		budgetMs = 16.67f;
+	uint32_t	seed = 1;
+};
+
+struct StressResult
+{
+	uint32_t	hitsPerFrame = 0;
+	double		frameMean = 0;		// Milliseconds
+	double		frameP99 = 0;
+	double		frameMax = 0;
+	uint32_t	overBudget = 0;		// Frames over the budget
+	double		evaluateMean = 0;	// Milliseconds of rule decisions per frame, summed over threads
+	double		overrideContention = 0;	// Share of lock acquisitions that waited
+	double		overrideWaitUs = 0;		// Per frame
+	double		taskContention = 0;
+	double		taskWaitUs = 0;
+	size_t		maxOverrides = 0;
+	size_t		maxTasks = 0;
+	uint64_t	triggered = 0;
+	uint64_t	orderHash = 0;	// Side effects in the order they were drained
+	uint64_t	allocations = 0;	// Global heap allocations of the decisions, first frame excluded
+	double		allocationsPerHit = 0;
+	double		impactP50 = 0;		// Microseconds, 0 for batched impacts
+	double		impactP99 = 0;
+};
+
+// Decision cost on one impact thread during a frame
+struct DecideStats
+{
+	double		nanoseconds = 0;
+	uint64_t	allocations = 0;
+};
+
+// Work of a side effect, only its size matters here
+struct SideEffect
+{
+	uint32_t	rule = 0;
+	float		experience = 0;
+};
+
+class Simulation
+{
+public:
+	Simulation( const StressOptions& a_options ) :
+		options( a_options ),
+		rules( Fixtures::MakeRules( a_options.rules, a_options.seed ) ),
+		evaluator( *rules, ruleOptions, &code ),
+		random( a_options.seed )
+	{
+		auto& world = Fixtures::GetWorld();
+		code.Compile( rules->locations, world.GetForms() );
+
+		for( int type = 0; type < (int)Fixtures::SkeletonType::kTotal; ++type )
+			skeletons.push_back( Fixtures::MakeSkeletonSnapshot( (Fixtures::SkeletonType)type ) );
+
+		// Actors of the fight. Most are humanoids, a few mounts and dragons.
+		std::vector<ActorSnapshot> actors;
+		std::vector<uint32_t> actorSkeletons;
+		for( uint32_t i = 0; i < options.actors; ++i )
+		{
+			actors.push_back( Fixtures::MakeActor( world, 4 + random() % 60, random() % 8, random() % 24, random() ) );
+			actorSkeletons.push_back( random() % 10 < 8 ? 0 : 1 + random() % 2 );
+		}
+
+		actors[ 0 ].isPlayer = true;
+
+		// Decisions are evaluated into their hit slot, sized for the worst case so their vectors never grow
+		size_t maxEffects = 0;
+		for( auto& location : rules->locations )
+			maxEffects += location.effects.size();
+
+		// One hit slot per arrow of a frame. The shooter and target of a slot stay, the impact changes every frame.
+		hits.resize( options.actors * options.projectiles );
+		for( size_t i = 0; i < hits.size(); ++i )
+		{
+			auto& hit		= hits[ i ];
+			auto shooter	= (uint32_t)( i / options.projectiles );
+			auto target		= options.actors > 1 ? ( shooter + 1 + random() % ( options.actors - 1 ) ) % options.actors : shooter;
+
+			hit.skeleton	= skeletons[ actorSkeletons[ target ] ];
+			hit.target		= actors[ target ];
+			hit.shooter		= actors[ shooter ];
+			hit.hasShooter	= true;
+			hit.projectile	= Fixtures::MakeProjectile( world, random() );
+			hit.projectile.shot = Fixtures::MakeShots( 1, random() )[ 0 ];
+		}
+
+		decisions.resize( hits.size() );
+		for( auto& decision : decisions )
+		{
+			decision.rules.reserve( rules->locations.size() );
+			decision.effects.reserve( maxEffects );
+		}
+
+		// Every node name already matched, as after the first fights of a session: the steady state does not match patterns
+		for( auto& skeleton : skeletons )
+		{
+			for( auto& node : skeleton.nodes )
+				rules->MatchNode( node.name );
+		}
+	}
+
+	StressResult Run()
+	{
+		uint32_t threadCount = std::max<uint32_t>( 1, options.threads );
+		std::barrier frameBarrier( options.isBatched ? 1 : threadCount );
+		std::atomic<bool> isDone = false;
+		std::vector<DecideStats> decideStats( threadCount );
+
+		impactTimes.assign( threadCount, {} );
+		for( auto& times : impactTimes )
+			times.reserve( ( hits.size() / threadCount + 1 ) * options.frames );
+
+		std::optional<WorkPool> pool;
+		if( options.isBatched )
+			pool.emplace( threadCount );
+
+		std::vector<std::thread> workers;
+		for( uint32_t i = 1; i < threadCount && !options.isBatched; ++i )
+		{
+			workers.emplace_back( [ &, i ]()
+			{
+				while( true )
+				{
+					frameBarrier.arrive_and_wait();
+					if( isDone )
+						break;
+
+					ImpactSlice( i, threadCount, decideStats[ i ] );
+					frameBarrier.arrive_and_wait();
+				}
+			});
+		}
+
+		StressResult result;
+		result.hitsPerFrame	= (uint32_t)hits.size();
+		result.orderHash	= HashFNV1a( nullptr, 0 );
+
+		std::vector<double> frameTimes;
+		double evaluateTotal = 0;
+		for( uint32_t frame = 0; frame < options.frames; ++frame )
+		{
+			NextFrame( frame );
+			std::fill( decideStats.begin(), decideStats.end(), DecideStats() );
+
+			auto start = Clock::now();
+
+			// Impacts
+			if( pool )
+				ImpactBatch( *pool, decideStats );
+			else
+			{
+				frameBarrier.arrive_and_wait();
+				ImpactSlice( 0, threadCount, decideStats[ 0 ] );
+				frameBarrier.arrive_and_wait();
+			}
+
+			result.maxOverrides	= std::max<size_t>( result.maxOverrides, pendingOverrides.size() );
+			result.maxTasks		= std::max<size_t>( result.maxTasks, tasks.size() );
+
+			// Attacks take back the overrides of their impact, then the leftovers expire
+			for( auto& hit : hits )
+			{
+				std::lock_guard<MeasuredMutex> lock( overrideMutex );
+
+				HitOverride hitOverride;
+				pendingOverrides.Take( &hit.shooter, &hit.target, hit.impact, hitOverride );
+				pendingOverrides.Expire( frame );
+			}
+
+			// Main thread tasks
+			{
+				std::lock_guard<MeasuredMutex> lock( taskMutex );
+				result.triggered += tasks.size();
+				for( auto& task : tasks )
+				{
+					if( !options.isInlineEffects )
+						FormatSideEffect( task );
+
+					result.orderHash = HashFNV1a( &task, sizeof( task ), result.orderHash );
+				}
+
+				tasks.clear();
+			}
+
+			double frameTime = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+			frameTimes.push_back( frameTime );
+			if( frameTime > options.budgetMs )
+				++result.overBudget;
+
+			for( auto& stats : decideStats )
+			{
+				evaluateTotal += stats.nanoseconds;
+
+				// The first frame fills the arenas and the lazily built caches
+				if( frame > 0 )
+					result.allocations += stats.allocations;
+			}
+		}
+
+		isDone = true;
+		frameBarrier.arrive_and_wait();
+		for( auto& worker : workers )
+			worker.join();
+
+		double frameTotal = 0;
+		for( auto value : frameTimes )
+			frameTotal += value;
+
+		std::sort( frameTimes.begin(), frameTimes.end() );
+		result.frameMean	= frameTotal / frameTimes.size();
+		result.frameP99		= frameTimes[ (size_t)( 0.99 * ( frameTimes.size() - 1 ) ) ];
+		result.frameMax		= frameTimes.back();
+		result.evaluateMean	= evaluateTotal / 1e6 / frameTimes.size();
+
+		if( options.frames > 1 )
+			result.allocationsPerHit = (double)result.allocations / ( (double)hits.size() * ( options.frames - 1 ) );
+
+		std::vector<float> allImpacts;
+		for( auto& times : impactTimes )
+			allImpacts.insert( allImpacts.end(), times.begin(), times.end() );
+
+		if( !allImpacts.empty() )
+		{
+			std::sort( allImpacts.begin(), allImpacts.end() );
+			result.impactP50 = allImpacts[ allImpacts.size() / 2 ];
+			result.impactP99 = allImpacts[ (size_t)( 0.99 * ( allImpacts.size() - 1 ) ) ];
+		}
+
+		auto contention = []( const MeasuredMutex& a_mutex ) { return a_mutex.acquired ? (double)a_mutex.contended / a_mutex.acquired : 0; };
+		result.overrideContention	= contention( overrideMutex );
+		result.overrideWaitUs		= overrideMutex.waitNanoseconds / 1e3 / frameTimes.size();
+		result.taskContention		= contention( taskMutex );
+		result.taskWaitUs			= taskMutex.waitNanoseconds / 1e3 / frameTimes.size();
+
+		return result;
+	}
+
+private:
+	// Arrows land on a random node of the target, a third of them without engine impact data
+	void NextFrame( uint32_t a_frame )
+	{
+		std::uniform_real_distribution<float> jitter( -4, 4 );
+		for( auto& hit : hits )
+		{
+			auto& nodes		= hit.skeleton.nodes;
+			auto node		= random() % nodes.size();
+			hit.impact		= { nodes[ node ].position.x + jitter( random ), nodes[ node ].position.y + jitter( random ), nodes[ node ].position.z + jitter( random ) };
+			hit.impactNode	= random() % 3 ? (int32_t)node : -1;
+			hit.damage		= 5.0f + random() % 60;
+			hit.timestamp	= a_frame;
+		}
+	}
+
+	const HitDecision& Decide( size_t a_index, DecideStats& a_stats )
+	{
+		auto& hit = hits[ a_index ];
+		std::minstd_rand hitRandom( (uint32_t)( hit.timestamp * hits.size() + a_index + 1 ) );
+
+		auto allocations	= AllocationCounter::GetCount();
+		auto start			= Clock::now();
+		evaluator.Evaluate( hit, hitRandom, decisions[ a_index ] );
+		a_stats.nanoseconds += std::chrono::duration<double, std::nano>( Clock::now() - start ).count();
+		a_stats.allocations += AllocationCounter::GetCount() - allocations;
+
+		return decisions[ a_index ];
+	}
+
+	void Apply( const HitRecord& a_hit, const HitDecision& a_decision )
+	{
+		if( a_decision.rules.empty() )
+			return;
+
+		HitOverride hitOverride;
+		hitOverride.aggressor		= &a_hit.shooter;
+		hitOverride.target			= &a_hit.target;
+		hitOverride.location		= a_hit.impact;
+		hitOverride.damageMult		= a_decision.damageMult;
+		hitOverride.expireTimestamp	= a_hit.timestamp + 1;	// Timestamps count frames, an override not taken expires during the next frame
+
+		{
+			std::lock_guard<MeasuredMutex> lock( overrideMutex );
+			pendingOverrides.Add( hitOverride );
+		}
+
+		SideEffect sideEffect = { a_decision.rules.front(), a_decision.expMult };
+		if( options.isInlineEffects )
+			FormatSideEffect( sideEffect );
+
+		std::lock_guard<MeasuredMutex> lock( taskMutex );
+		tasks.push_back( sideEffect );
+	}
+
+	// Text of HitSideEffects::Run: the rule notification by its shooter and the shot difficulty report
+	void FormatSideEffect( const SideEffect& a_sideEffect ) const
+	{
+		auto& location = rules->locations[ a_sideEffect.rule ];
+
+		char buffer[ 512 ];
+		std::snprintf( buffer, sizeof( buffer ), "%s by %s", location.message.c_str(), location.id.c_str() );
+		std::snprintf( buffer, sizeof( buffer ), "Shot difficulty: %0.1f", a_sideEffect.experience );
+	}
+
+	void ImpactSlice( uint32_t a_thread, uint32_t a_threadCount, DecideStats& a_stats )
+	{
+		for( size_t i = a_thread; i < hits.size(); i += a_threadCount )
+		{
+			auto start = Clock::now();
+			Apply( hits[ i ], Decide( i, a_stats ) );
+
+			if( hits[ i ].timestamp > 0 )
+				impactTimes[ a_thread ].push_back( std::chrono::duration<float, std::micro>( Clock::now() - start ).count() );
+		}
+	}
+
+	// Decisions in parallel into the slot of their hit, then applied in impact order by the calling thread
+	void ImpactBatch( WorkPool& a_pool, std::vector<DecideStats>& a_stats )
+	{
+		a_pool.ParallelFor( hits.size(), [ & ]( size_t a_index, uint32_t a_thread )
+		{
+			Decide( a_index, a_stats[ a_thread ] );
+		}, 4 );
+
+		for( size_t i = 0; i < hits.size(); ++i )
+			Apply( hits[ i ], decisions[ i ] );
+	}
+
+	const StressOptions&		options;
+	RuleCompiler::Options		ruleOptions;
+	std::unique_ptr<RuleData>	rules;
+	FilterCode					code;
+	HitEvaluator				evaluator;
+	std::mt19937				random;
+
+	std::vector<SkeletonSnapshot>	skeletons;
+	std::vector<HitRecord>			hits;
+	std::vector<HitDecision>		decisions;
+
+	MeasuredMutex				overrideMutex;
+	HitOverrideList				pendingOverrides;
+	MeasuredMutex				taskMutex;
+	std::vector<SideEffect>		tasks;
+
+	std::vector<std::vector<float>>	impactTimes;	// Microseconds per impact, per impact thread
+};
+
+static const char* kCSVHeader = "actors,projectiles,threads,rules,hits_per_frame,frame_mean_ms,frame_p99_ms,frame_max_ms,budget_ms,over_budget,evaluate_ms,override_contention,override_wait_us,task_contention,task_wait_us,max_overrides,max_tasks,batched,order_hash,allocs_per_hit,impact_p50_us,impact_p99_us,inline_effects";
+
+static void PrintResult( const StressOptions& a_options, const StressResult& a_result, FILE* a_csv )
+{
+	std::printf( "%7u %6u %7u | %8.3f %8.3f %8.3f %6.1f%% %5u | %8.3f | %5.1f%% %8.1f | %5.1f%% %8.1f | %6zu %6zu | %016llx %9.3f | %8.2f %8.2f\n",
+		a_options.actors, a_options.projectiles, a_result.hitsPerFrame,
+		a_result.frameMean, a_result.frameP99, a_result.frameMax, 100 * a_result.frameMean / a_options.budgetMs, a_result.overBudget,
+		a_result.evaluateMean,
+		100 * a_result.overrideContention, a_result.overrideWaitUs, 100 * a_result.taskContention, a_result.taskWaitUs,
+		a_result.maxOverrides, a_result.maxTasks, (unsigned long long)a_result.orderHash, a_result.allocationsPerHit,
+		a_result.impactP50, a_result.impactP99 );
+
+	if( a_csv )
+	{
+		std::fprintf( a_csv, "%u,%u,%u,%u,%u,%.4f,%.4f,%.4f,%.2f,%u,%.4f,%.4f,%.2f,%.4f,%.2f,%zu,%zu,%d,%016llx,%.4f,%.3f,%.3f,%d\n",
+			a_options.actors, a_options.projectiles, a_options.threads, a_options.rules, a_result.hitsPerFrame,
+			a_result.frameMean, a_result.frameP99, a_result.frameMax, a_options.budgetMs, a_result.overBudget, a_result.evaluateMean,
+			a_result.overrideContention, a_result.overrideWaitUs, a_result.taskContention, a_result.taskWaitUs,
+			a_result.maxOverrides, a_result.maxTasks, (int)a_options.isBatched, (unsigned long long)a_result.orderHash, a_result.allocationsPerHit,
+			a_result.impactP50, a_result.impactP99, (int)a_options.isInlineEffects );
+	}
+}
+
+static int PrintUsage()
+{
+	std::printf( "usage: ArcheryLocationalDamageStress [--actors <n>] [--projectiles <m>] [--frames <f>] [--rules <r>] [--threads <t>]\n" );
+	std::printf( "                                     [--budget-ms <ms>] [--seed <s>] [--batched] [--inline-effects] [--sweep] [--csv <file>]\n" );
+	std::printf( "                                     [--zero-alloc]\n" );
+	return 2;
+}
+
+int main( int a_argc, char** a_argv )
+{
+	StressOptions options;
+	bool isSweep		= false;
+	bool isZeroAlloc	= false;
+	const char* csvPath	= nullptr;
+	for( int i = 1; i < a_argc; ++i )
+	{
+		std::string_view arg = a_argv[ i ];
+		auto next = [ & ]() { return i + 1 < a_argc ? a_argv[ ++i ] : nullptr; };
+		auto nextInt = [ & ]( uint32_t& a_value )
+		{
+			auto value = next();
+			if( value )
+				a_value = std::max<uint32_t>( 1, (uint32_t)std::strtoul( value, nullptr, 10 ) );
+
+			return value != nullptr;
+		};
+
+		bool isValid = true;
+		if( arg == "--actors" )
+			isValid = nextInt( options.actors );
+		else if( arg == "--projectiles" )
+			isValid = nextInt( options.projectiles );
+		else if( arg == "--frames" )
+			isValid = nextInt( options.frames );
+		else if( arg == "--rules" )
+			isValid = nextInt( options.rules );
+		else if( arg == "--threads" )
+			isValid = nextInt( options.threads );
+		else if( arg == "--seed" )
+			isValid = nextInt( options.seed );
+		else if( arg == "--budget-ms" )
+		{
+			auto value = next();
+			isValid = value != nullptr;
+			if( value )
+				options.budgetMs = std::max<float>( 0.001f, std::strtof( value, nullptr ) );
+		}
+		else if( arg == "--csv" )
+			isValid = ( csvPath = next() ) != nullptr;
+		else if( arg == "--batched" )
+			options.isBatched = true;
+		else if( arg == "--inline-effects" )
+			options.isInlineEffects = true;
+		else if( arg == "--sweep" )
+			isSweep = true;
+		else if( arg == "--zero-alloc" )
+			isZeroAlloc = true;
+		else
+			isValid = false;
+
+		if( !isValid )
+			return PrintUsage();
+	}
+
+	if( isZeroAlloc && !AllocationCounter::kIsEnabled )
+	{
+		std::printf( "--zero-alloc needs a debug build, allocations are not counted\n" );
+		return 2;
+	}
+
+	FILE* csv = nullptr;
+	if( csvPath )
+	{
+		bool isNew = !std::filesystem::exists( csvPath );
+		csv = std::fopen( csvPath, "a" );
+		if( !csv )
+		{
+			std::printf( "Cannot open %s\n", csvPath );
+			return 2;
+		}
+
+		if( isNew )
+			std::fprintf( csv, "%s\n", kCSVHeader );
+	}
+
+	std::printf( "%u rules, %u threads%s%s, %u frames, budget %.2f ms\n", options.rules, options.threads, options.isBatched ? " batched" : "",
+		options.isInlineEffects ? ", inline effects" : "", options.frames, options.budgetMs );
+	std::printf( "%7s %6s %7s | %8s %8s %8s %7s %5s | %8s | %6s %8s | %6s %8s | %6s %6s | %16s %9s | %8s %8s\n",
+		"actors", "arrows", "hits", "mean ms", "p99 ms", "max ms", "budget", "over", "eval ms", "ovr", "wait us", "task", "wait us", "ovrs", "tasks", "order hash", "alloc/hit",
+		"imp p50", "imp p99" );
+
+	std::vector<std::pair<uint32_t, uint32_t>> configurations;
+	if( isSweep )
+	{
+		for( uint32_t actors : { 10, 25, 50, 100, 200 } )
+		{
+			for( uint32_t projectiles : { 1, 2, 4 } )
+				configurations.emplace_back( actors, projectiles );
+		}
+	}
+	else
+		configurations.emplace_back( options.actors, options.projectiles );
+
+	uint64_t allocations = 0;
+	for( auto [ actors, projectiles ] : configurations )
+	{
+		options.actors		= actors;
+		options.projectiles	= projectiles;
+
+		Simulation simulation( options );
+		auto result = simulation.Run();
+		PrintResult( options, result, csv );
+
+		allocations += result.allocations;
+	}
+
+	if( csv )
+		std::fclose( csv );
+
+	if( isZeroAlloc && allocations > 0 )
+	{
+		std::printf( "%llu global heap allocations in steady state decisions\n", (unsigned long long)allocations );
+		return 1;
+	}
+
+	return 0;
+}